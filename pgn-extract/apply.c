@@ -43,6 +43,10 @@
 #include "fenmatcher.h"
 #include "zobrist.h"
 #include "end.h"
+#include "evaluator.h"
+#include "positionset.h"
+#include "bitboard.h"
+#include "see.h"
 
 /* Define a positional search depth that should look at the
  * full length of a game.  This is used in play_moves().
@@ -53,6 +57,7 @@
 static Boolean check_move_validity(Game *game_details, Board *board, Move *moves, Boolean mainline);
 static Boolean check_variation_validity(const Game *game_details, const Board *board, Variation *variation);
 static const char *position_matches(const Board *board);
+static Boolean position_match_reachable(MaterialSignature material);
 static Boolean play_moves(Game *game_details, Board *board, Move *moves,
         unsigned max_depth, Boolean check_move_validity,
         Boolean mainline);
@@ -166,23 +171,6 @@ void set_output_piece_characters(const char *letters)
     }
 }
 
-/* Return a fresh copy of the given string. */
-char *
-copy_string(const char *str)
-{
-    char *result;
-    if(str != NULL) {
-        size_t len = strlen(str);
-
-        result = (char *) malloc_or_die(len + 1);
-        strcpy(result, str);
-    }
-    else {
-        result = NULL;
-    }
-    return result;
-}
-
 /* Allocate space for a new board. */
 static Board *
 allocate_new_board(void)
@@ -641,6 +629,9 @@ new_fen_board(const char *fen)
         report_details(GlobalState.logfile);
 	print_error_context(GlobalState.logfile);
     }
+    if(new_board != NULL) {
+        new_board->material_signature = board_material_signature(new_board);
+    }
     return new_board;
 }
 
@@ -684,6 +675,32 @@ void add_fen_castling(Game *game_details, Board *board)
     }
 }
 
+/* Return the weak hash value of the pieces on board. */
+HashCode
+board_weak_hash_value(const Board *board)
+{
+    HashCode hash_value = 0;
+    /* Iterate over the columns. */
+    Col col;
+
+    for (col = FIRSTCOL; col <= LASTCOL; col++) {
+        Rank rank;
+
+        for (rank = FIRSTRANK; rank <= LASTRANK; rank++) {
+            /* Find the basic components. */
+            Piece coloured_piece = board->board[
+                    RankConvert(rank)][ColConvert(col)];
+            Piece piece = EXTRACT_PIECE(coloured_piece);
+            Colour colour = EXTRACT_COLOUR(coloured_piece);
+
+            if (coloured_piece != EMPTY) {
+                hash_value ^= hash_lookup(col, rank, piece, colour);
+            }
+        }
+    }
+    return hash_value;
+}
+
 /* Set up a board structure for a new game.
  * This involves placing the pieces in their initial positions,
  * setting up castling and en-passant rights, and initialising
@@ -730,9 +747,6 @@ new_game_board(const char *fen)
         /* half-move_clock */
         0,
     };
-    /* Iterate over the columns. */
-    Col col;
-
     if (fen != NULL) {
         new_board = new_fen_board(fen);
     }
@@ -746,21 +760,8 @@ new_game_board(const char *fen)
     }
 
     /* Generate the hash value for the initial position. */
-    for (col = FIRSTCOL; col <= LASTCOL; col++) {
-        Rank rank;
-
-        for (rank = FIRSTRANK; rank <= LASTRANK; rank++) {
-            /* Find the basic components. */
-            Piece coloured_piece = new_board->board[
-                    RankConvert(rank)][ColConvert(col)];
-            Piece piece = EXTRACT_PIECE(coloured_piece);
-            Colour colour = EXTRACT_COLOUR(coloured_piece);
-
-            if (coloured_piece != EMPTY) {
-                new_board->weak_hash_value ^= hash_lookup(col, rank, piece, colour);
-            }
-        }
-    }
+    new_board->weak_hash_value ^= board_weak_hash_value(new_board);
+    new_board->material_signature = board_material_signature(new_board);
     return new_board;
 }
 
@@ -942,6 +943,14 @@ apply_move(Move *move_details, Board *board)
                 build_FEN_components(board, epd, fen_suffix);
                 move_details->epd = copy_string(epd);
                 move_details->fen_suffix = copy_string(fen_suffix);
+                if (GlobalState.quiet_positions_only) {
+                    uint64_t pieces[NUM_BITBOARDS];
+
+                    board_to_bitboards(board, pieces);
+                    move_details->quiet = quiet_position(pieces,
+                            board->to_move == WHITE ? 0 : 1,
+                            board_ep_square(board));
+                }
             }
 
         }
@@ -973,6 +982,8 @@ play_moves(Game *game_details, Board *board, Move *moves, unsigned max_depth,
     Move *next_move = moves;
     /* Keep track of the final ECO match. */
     EcoLog *eco_match = NULL;
+    /* Whether an ECO line might still be matched. */
+    Boolean eco_reachable = TRUE;
     Boolean null_move_in_main_line = FALSE;
     /* Whether the fifty-move rule was available in the main line. */
     Boolean N_move_rule_applies = FALSE;
@@ -980,6 +991,13 @@ play_moves(Game *game_details, Board *board, Move *moves, unsigned max_depth,
     unsigned plies = board->move_number * 2 - (board->to_move == WHITE ? 1 : 0);
     /* Whether there has been an underpromotion. */
     Boolean underpromotion = FALSE;
+    /* Whether a position of interest could still be reached.
+     * Once it could not, the game cannot match and replay can stop
+     * just as it does when max_depth is exceeded.
+     */
+    Boolean match_reachable = TRUE;
+    /* The material when match_reachable was last decided. */
+    MaterialSignature material_checked = board->material_signature;
     
     const char *match_label = NULL;
     
@@ -1008,12 +1026,12 @@ play_moves(Game *game_details, Board *board, Move *moves, unsigned max_depth,
     }
 
     /* Keep going while the game is ok, and we have some more
-     * moves and we haven't exceeded the search depth without finding
-     * a match.
+     * moves and we haven't exceeded the search depth, or lost the
+     * material required, without finding a match.
      */
     while (game_ok &&
               (next_move != NULL) &&
-              (game_matches || (plies <= max_depth))) {
+              (game_matches || (plies <= max_depth && match_reachable))) {
         if (*(next_move->move) != '\0') {
             /* There might be a restriction on when to start checking for a match. */
             Boolean check_for_match = plies >= GlobalState.startply;
@@ -1044,6 +1062,10 @@ play_moves(Game *game_details, Board *board, Move *moves, unsigned max_depth,
                             append_comments_to_move(next_move, comment);
                         }
                     }
+                    if (!game_matches && board->material_signature != material_checked) {
+                        material_checked = board->material_signature;
+                        match_reachable = position_match_reachable(material_checked);
+                    }
                     /* Combine this hash value with the cumulative one. */
                     game_details->cumulative_hash_value += board->weak_hash_value;
                     if (check_for_match && GlobalState.fuzzy_match_duplicates) {
@@ -1193,12 +1215,16 @@ play_moves(Game *game_details, Board *board, Move *moves, unsigned max_depth,
                         }
                     }
 
-                    if (GlobalState.add_ECO && mainline && !GlobalState.parsing_ECO_file) {
+                    if (GlobalState.add_ECO && mainline && !GlobalState.parsing_ECO_file && eco_reachable) {
                         int half_moves = half_moves_played(board);
-                        EcoLog *entry = eco_matches(
-                                board,
-                                game_details->cumulative_hash_value,
-                                half_moves);
+                        EcoLog *entry = NULL;
+                        /* Stop looking once the game can no longer reach any line. */
+                        eco_reachable = eco_line_reachable(board, half_moves);
+                        if (eco_reachable) {
+                            entry = eco_matches(board,
+                                    game_details->cumulative_hash_value,
+                                    half_moves);
+                        }
                         if (entry != NULL) {
                             /* Consider keeping the match.
                              * Could try to avoid spurious matches which become
@@ -1378,6 +1404,8 @@ check_move_validity(Game *game_details, Board *board, Move *moves, Boolean mainl
     Move *next_move = moves;
     Boolean null_move_in_main_line = FALSE;
     EcoLog *eco_match = NULL;
+    /* Whether an ECO line might still be matched. */
+    Boolean eco_reachable = TRUE;
     
     /* Ensure that the RESULT_TAG (if present) is valid. */
     if(game_details->tags[RESULT_TAG] != NULL &&
@@ -1512,12 +1540,16 @@ check_move_validity(Game *game_details, Board *board, Move *moves, Boolean mainl
                     }
                 }
 
-                if (GlobalState.add_ECO && mainline && !GlobalState.parsing_ECO_file) {
+                if (GlobalState.add_ECO && mainline && !GlobalState.parsing_ECO_file && eco_reachable) {
                     int half_moves = half_moves_played(board);
-                    EcoLog *entry = eco_matches(
-                            board,
-                            game_details->cumulative_hash_value,
-                            half_moves);
+                    EcoLog *entry = NULL;
+                    /* Stop looking once the game can no longer reach any line. */
+                    eco_reachable = eco_line_reachable(board, half_moves);
+                    if (eco_reachable) {
+                        entry = eco_matches(board,
+                                game_details->cumulative_hash_value,
+                                half_moves);
+                    }
                     if (entry != NULL) {
                         /* Consider keeping the match.
                          * Could try to avoid spurious matches which become
@@ -2190,7 +2222,13 @@ rewrite_moves(Game *game, Board *board, Move *moves)
                 }
 
                 if (GlobalState.output_evaluation) {
-                    move_details->evaluation = evaluate(board);
+                    if (GlobalState.eval_plugin != NULL) {
+                        /* Evaluated in a batch at the end of the game. */
+                        queue_evaluation(move_details, board);
+                    }
+                    else {
+                        move_details->evaluation = evaluate(board);
+                    }
                 }
 
                 if (GlobalState.add_hashcode_comments) {
@@ -2251,6 +2289,12 @@ rewrite_moves(Game *game, Board *board, Move *moves)
             game_ok = FALSE;
         }
     }
+    if (game != NULL && GlobalState.eval_plugin != NULL) {
+        /* Evaluate the queued positions of the main line and its
+         * variations before any of their moves are dropped.
+         */
+        flush_evaluations();
+    }
     if (!game_ok) {
         if(GlobalState.keep_broken_games && move_details != NULL) {
             /* Try to place the remaining moves into a comment. */
@@ -2450,19 +2494,20 @@ drop_plies_from_start(Game *game, Move *moves, int plies_to_drop)
     return game_ok;
 }
 
-/* Define a table to hold the positional hash codes of interest.
- * Size should be a prime number for collision avoidance.
- */
-#define MAX_NON_POLYGLOT_CODE 541
-static HashLog *non_polyglot_codes_of_interest[MAX_NON_POLYGLOT_CODE];
+/* The positional hash codes of interest. */
+static PositionSet non_polyglot_codes_of_interest;
 /* Whether or not the non-polyglot hashcodes are in use. */
-Boolean using_non_polyglot = FALSE;
+static Boolean using_non_polyglot = FALSE;
+/* Bounds on the material of the positions of interest. */
+static MaterialSignature non_polyglot_lower, non_polyglot_upper;
 
 /* move_details is either the start of a variation in which we are interested
  * or it is NULL.
  * fen is either a position we are interested in or it is NULL.
  * Generate and store the hash value for the variation, or the FEN
  * position in non_polyglot_codes_of_interest.
+ * We don't include the cumulative hash value as the sequence
+ * of moves to reach the position is not important.
  */
 void
 store_hash_value(Move *move_details, const char *fen)
@@ -2491,18 +2536,7 @@ store_hash_value(Move *move_details, const char *fen)
     }
 
     if (Ok) {
-        HashLog *entry = (HashLog *) malloc_or_die(sizeof (*entry));
-        unsigned ix = board->weak_hash_value % MAX_NON_POLYGLOT_CODE;
-
-        /* We don't include the cumulative hash value as the sequence
-         * of moves to reach this position is not important.
-         */
-        entry->cumulative_hash_value = 0;
-        entry->final_hash_value = board->weak_hash_value;
-        /* Link it into the head at this index. */
-        entry->next = non_polyglot_codes_of_interest[ix];
-        non_polyglot_codes_of_interest[ix] = entry;
-        using_non_polyglot = TRUE;
+        add_hash_value_of_interest(board->weak_hash_value, board->material_signature);
     }
     else {
         exit(1);
@@ -2510,14 +2544,52 @@ store_hash_value(Move *move_details, const char *fen)
     free_board(board);
 }
 
-/* Define a table to hold the positional hash codes of interest.
- * Size should be a prime number for collision avoidance.
+/* Record weak_hash_value, of a position with the given material,
+ * as a position of interest.
  */
-#define MAX_POLYGLOT_CODE 541
-static HashLog *polyglot_codes_of_interest[MAX_POLYGLOT_CODE];
+void
+add_hash_value_of_interest(HashCode weak_hash_value, MaterialSignature material)
+{
+    position_set_add(&non_polyglot_codes_of_interest, weak_hash_value);
+    if(using_non_polyglot) {
+        non_polyglot_lower = material_signature_bound(non_polyglot_lower, material, TRUE);
+        non_polyglot_upper = material_signature_bound(non_polyglot_upper, material, FALSE);
+    }
+    else {
+        non_polyglot_lower = non_polyglot_upper = material;
+    }
+    using_non_polyglot = TRUE;
+}
+
+/* The polyglot hash codes of interest. */
+static PositionSet polyglot_codes_of_interest;
 /* Whether or not the polyglot hashcodes are in use. */
 static Boolean using_polyglot = FALSE;
 
+/* Record hash as the polyglot code of a position of interest. */
+void
+add_polyglot_hashcode_of_interest(uint64_t hash)
+{
+    position_set_add(&polyglot_codes_of_interest, hash);
+    using_polyglot = TRUE;
+}
+
+/* Make room for the given numbers of positions of interest
+ * ahead of adding them.
+ */
+void
+reserve_positions_of_interest(size_t non_polyglot, size_t polyglot)
+{
+    if(non_polyglot > 0) {
+        position_set_reserve(&non_polyglot_codes_of_interest,
+                non_polyglot_codes_of_interest.count + non_polyglot);
+    }
+    if(polyglot > 0) {
+        position_set_reserve(&polyglot_codes_of_interest,
+                polyglot_codes_of_interest.count + polyglot);
+    }
+}
+
 /**
  * Convert the given hex string to an int and save it
  * for position matching. 
@@ -2539,18 +2611,7 @@ Boolean save_polyglot_hashcode(const char *value)
             hash = strtoull(value, &end, 16);
             Ok = (errno == 0 && *end == '\0');
             if (Ok) {
-                HashLog *entry = (HashLog *) malloc_or_die(sizeof (*entry));
-                unsigned ix = hash % MAX_POLYGLOT_CODE;
-
-                /* We don't include the cumulative hash value as the sequence
-                 * of moves to reach this position is not important.
-                 */
-                entry->cumulative_hash_value = 0;
-                entry->final_hash_value = hash;
-                /* Link it into the head at this index. */
-                entry->next = polyglot_codes_of_interest[ix];
-                polyglot_codes_of_interest[ix] = entry;
-                using_polyglot = TRUE;
+                add_polyglot_hashcode_of_interest(hash);
             }
             else {
                 fprintf(GlobalState.logfile, "Unrecognised hash value %s\n", value);
@@ -2577,27 +2638,16 @@ position_matches(const Board *board)
 {
     Boolean found = FALSE;
     
-    if(using_non_polyglot) {
-        HashCode current_hash_value = board->weak_hash_value;
-        unsigned ix = current_hash_value % MAX_NON_POLYGLOT_CODE;
-        for (HashLog *entry = non_polyglot_codes_of_interest[ix]; !found && (entry != NULL);
-                entry = entry->next) {
-            /* We can test against just the position value. */
-            if (entry->final_hash_value == current_hash_value) {
-                found = TRUE;
-            }
-        }
+    if(using_non_polyglot &&
+            MATERIAL_WITHIN(board->material_signature,
+                            non_polyglot_lower, non_polyglot_upper)) {
+        /* We can test against just the position value. */
+        found = position_set_contains(&non_polyglot_codes_of_interest,
+                                      board->weak_hash_value);
     }
     if(!found && using_polyglot) {
-        uint64_t current_hash_value = generate_zobrist_hash_from_board(board);
-        unsigned ix = current_hash_value % MAX_POLYGLOT_CODE;
-        for (HashLog *entry = polyglot_codes_of_interest[ix]; !found && (entry != NULL);
-                entry = entry->next) {
-            /* We can test against just the position value. */
-            if (entry->final_hash_value == current_hash_value) {
-                found = TRUE;
-            }
-        }
+        found = position_set_contains(&polyglot_codes_of_interest,
+                                      generate_zobrist_hash_from_board(board));
     }
     if(found && GlobalState.whose_move != EITHER_TO_MOVE) {
         if(board->to_move == WHITE && GlobalState.whose_move == BLACK_TO_MOVE) {
@@ -2624,6 +2674,24 @@ position_matches(const Board *board)
     }
 }
 
+/* Could a position that position_matches would accept still arise
+ * from one with the given material?
+ * The material of a polyglot position of interest is not known.
+ */
+static Boolean
+position_match_reachable(MaterialSignature material)
+{
+    if (using_polyglot) {
+        return TRUE;
+    }
+    else if (using_non_polyglot && material_reachable(material, non_polyglot_lower)) {
+        return TRUE;
+    }
+    else {
+        return pattern_match_reachable(material);
+    }
+}
+
 /* Build a basic EPD string from the given board. */
 void
 build_basic_EPD_string(const Board *board, char *epd)
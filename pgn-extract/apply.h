@@ -23,9 +23,12 @@
 #define APPLY_H
 
 void add_fen_castling(Game *game_details, Board *board);
+void add_hash_value_of_interest(HashCode weak_hash_value, MaterialSignature material);
+void add_polyglot_hashcode_of_interest(uint64_t hash);
 Boolean apply_move_list(Game *game_details,unsigned *plycount, unsigned max_depth, Boolean check_for_a_match);
 Boolean apply_move(Move *move_details, Board *board);
 Board *apply_eco_move_list(Game *game_details,unsigned *number_of_half_moves);
+HashCode board_weak_hash_value(const Board *board);
 void build_basic_EPD_string(const Board *board,char *fen);
 char coloured_piece_to_SAN_letter(Piece coloured_piece);
 Piece convert_FEN_char_to_piece(char c);
@@ -36,6 +39,7 @@ char *get_FEN_string(const Board *board);
 Board *new_fen_board(const char *fen);
 Board *new_game_board(const char *fen);
 const char *piece_str(Piece piece);
+void reserve_positions_of_interest(size_t non_polyglot, size_t polyglot);
 Board *rewrite_game(Game *game_details);
 char SAN_piece_letter(Piece piece);
 Boolean save_polyglot_hashcode(const char *value);
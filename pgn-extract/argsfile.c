@@ -40,6 +40,8 @@
 #include "lists.h"
 #include "mymalloc.h"
 #include "fenmatcher.h"
+#include "packed.h"
+#include "positionfile.h"
 
 #define CURRENT_VERSION "v25-01"
 #define URL "https://www.cs.kent.ac.uk/people/staff/djb/pgn-extract/"
@@ -183,6 +185,8 @@ usage_and_exit(void)
         "      -Wxlalg is enhanced long algebraic with x for captures and - for non capture moves.",
         "      -Wxolalg is -Wxlalg but with O-O and O-O-O for castling.",
         "      -Wuci is output compatible with the UCI protocol.",
+        "      -Wbitboards is bitboard CSV (with --fencsv).",
+        "      -Wpacked is packed binary records (with --fencsv).",
         "-xvariations -- the file variations contains the lines resulting in",
         "                positions of interest.",
         "-yfile -- file contains a material balance of interest.",
@@ -200,9 +204,11 @@ usage_and_exit(void)
         "--addmatchtag - output a MaterialMatch tag with -z",
         "--allownullmoves - allow NULL moves in the main line",
         "--append - see -a",
+        "--augment flip|mirror|flip,mirror - add the colour-flipped and mirrored forms of each --fencsv position",
 	"--btm - match position only if Black is to move (see -t)",
         "--checkfile - see -c",
         "--checkmate - see -M",
+        "--checkpoint file - record progress in file, and resume from it if it exists",
         "--commented - only match games with at least one comment",
         "--commentlines - output each comment on a separate line",
         "--deletesamesetup - suppress games with the same initial position as one already processed",
@@ -210,8 +216,11 @@ usage_and_exit(void)
         "--dropbefore - drop opening ply before a matching comment string",
         "--dropply - drop the given number of ply from the beginning of the game",
         "--duplicates - see -d",
+        "--ecocache file - save the table built for -e in file, and load it from there if it is up to date",
+        "--evalplugin lib - use the shared library lib for --evaluation",
         "--evaluation - include a position evaluation after each move",
         "--fencomments - include a FEN string after each move",
+        "--fencsv - the input is fen,depth,score[,pv] CSV rows to be converted (see -Wbitboards and -Wpacked)",
         "--fenpattern pattern - match games reaching a position matching the given FEN pattern",
         "--fenpatterni pattern - match games reaching a position matching the given FEN pattern for either side",
         "--fifty - only output games that include fifty moves with no capture or pawn move.",
@@ -224,6 +233,7 @@ usage_and_exit(void)
         "--help - see -h",
         "--higherratedwinner - match only if the winner has the higher rating",
         "--insufficient - only output games that end with insufficient mating material.",
+        "--jobs N - use N processes for --fencsv, --ucilines and --positionfile (default 1)",
         "--json - output the game in JSON format",
         "--keepbroken - retain games with errors",
         "--lichesscommentfix - move comments at the start of a variation to after the first move of the variation.",
@@ -256,14 +266,19 @@ usage_and_exit(void)
         "--output - see -o",
         "--plycount - include a PlyCount tag.",
         "--plylimit - limit the number of plies output.",
+        "--positionfile file - match positions given as FEN strings or hexadecimal polyglot hash codes, one per line",
+        "--pvdepth N - include N principal-variation moves in --fencsv output (default 0)",
         "--quiescent N - position quiescence length (default 0)",
         "--quiet - No status processing output (see, also, -s).",
+        "--quietpositions - output only quiet positions with -Wfen, -Wepd and --fencsv",
         "--repetition - only output games that include 3-fold repetition.",
         "--repetition5 - only output games that include 5-fold repetition.",
         "--selectonly range[,range ...] - only output the selected matched game(s)",
         "--seven - see -7",
         "--seventyfive - only output games that include seventy-five moves with no capture or pawn move.",
         "--skipmatching range[,range ...] - don't output the selected matched game(s)",
+        "--split fraction:file - write the given fraction of games (or --fencsv positions) to file, chosen by a hash of the game or position",
+        "--splitseed N - vary which games or positions --split selects (default 0)",
         "--splitvariants [depth] - output each variation (to the given depth) as a separate game.",
         "--stalemate - only output games that end in stalemate.",
         "--startply N - only start matching after N ply (N >= 1).",
@@ -271,6 +286,7 @@ usage_and_exit(void)
         "--suppressmatched - don't output matched games (see -n).",
         "--tagsubstr - match in any part of a tag (see -T and -t).",
         "--totalplycount - include a tag with the total number of plies in a game.",
+        "--ucilines - the input is lines of a FEN and UCI moves separated by ;, each treated as a game",
         "--underpromotion - match only games that contain an underpromotion.",
         "--version - print the current version number and exit.",
         "--vanywhere - apply variation matching (-v) through the whole game.",
@@ -1065,6 +1081,17 @@ process_long_form_argument(const char *argument, const char *associated_value)
         process_argument(MATCH_CHECKMATE_ARGUMENT, "");
         return 1;
     }
+    else if (stringcompare(argument, "checkpoint") == 0) {
+        if (*associated_value != '\0') {
+            GlobalState.checkpoint_file = copy_string(associated_value);
+        }
+        else {
+            fprintf(GlobalState.logfile,
+                    "--%s requires a file name following it.\n", argument);
+            exit(1);
+        }
+        return 2;
+    }
     else if (stringcompare(argument, "commented") == 0) {
         if(! GlobalState.keep_comments) {
             fprintf(GlobalState.logfile, "--%s clashes with -%c\n",
@@ -1126,6 +1153,31 @@ process_long_form_argument(const char *argument, const char *associated_value)
         process_argument(DUPLICATES_FILE_ARGUMENT, associated_value);
         return 2;
     }
+    else if (stringcompare(argument, "ecocache") == 0) {
+        /* The table of ECO lines is to be cached. */
+        if (*associated_value != '\0') {
+            GlobalState.eco_cache_file = copy_string(associated_value);
+        }
+        else {
+            fprintf(GlobalState.logfile,
+                    "--%s requires a file name following it.\n", argument);
+            exit(1);
+        }
+        return 2;
+    }
+    else if (stringcompare(argument, "evalplugin") == 0) {
+        /* Evaluations are to come from a shared library. */
+        if (*associated_value != '\0') {
+            GlobalState.eval_plugin = copy_string(associated_value);
+            GlobalState.output_evaluation = TRUE;
+        }
+        else {
+            fprintf(GlobalState.logfile,
+                    "--%s requires a library name following it.\n", argument);
+            exit(1);
+        }
+        return 2;
+    }
     else if (stringcompare(argument, "evaluation") == 0) {
         /* Output an evaluation is required with each move. */
         GlobalState.output_evaluation = TRUE;
@@ -1144,6 +1196,10 @@ process_long_form_argument(const char *argument, const char *associated_value)
         }
         return 1;
     }
+    else if (stringcompare(argument, "fencsv") == 0) {
+        GlobalState.fen_csv_input = TRUE;
+        return 1;
+    }
     else if (stringcompare(argument, "fenpattern") == 0) {
         if(*associated_value != '\0') {
             add_fen_pattern(associated_value, FALSE, "");
@@ -1266,6 +1322,19 @@ process_long_form_argument(const char *argument, const char *associated_value)
         }
         return 1;
     }
+    else if (stringcompare(argument, "jobs") == 0) {
+        int jobs = 0;
+
+        if (sscanf(associated_value, "%d", &jobs) == 1 && jobs > 0) {
+            GlobalState.num_jobs = jobs;
+        }
+        else {
+            fprintf(GlobalState.logfile,
+                    "--%s requires a number greater than zero following it.\n", argument);
+            exit(1);
+        }
+        return 2;
+    }
     else if (stringcompare(argument, "json") == 0) {
         GlobalState.json_format = TRUE;
         return 1;
@@ -1555,6 +1624,48 @@ process_long_form_argument(const char *argument, const char *associated_value)
         }
         return 2;
     }
+    else if (stringcompare(argument, "augment") == 0) {
+        int augment = packed_augmentation(associated_value);
+
+        if (augment >= 0) {
+            GlobalState.augment = augment;
+        }
+        else {
+            fprintf(GlobalState.logfile,
+                    "--%s requires flip, mirror, flip,mirror or none following it.\n",
+                    argument);
+            exit(1);
+        }
+        return 2;
+    }
+    else if (stringcompare(argument, "positionfile") == 0) {
+        if(*associated_value != '\0') {
+            /* The file is loaded once all arguments are known. */
+            add_position_file(copy_string(associated_value));
+            GlobalState.positional_variations = TRUE;
+        }
+        else {
+            fprintf(GlobalState.logfile,
+                    "--%s requires a file name following it.\n", argument);
+            exit(1);
+        }
+        return 2;
+    }
+    else if (stringcompare(argument, "pvdepth") == 0) {
+        int depth = 0;
+
+        if (sscanf(associated_value, "%d", &depth) == 1 &&
+                depth >= 0 && depth <= PACKED_MAX_PV_DEPTH) {
+            GlobalState.pv_depth = depth;
+        }
+        else {
+            fprintf(GlobalState.logfile,
+                    "--%s requires a number between 0 and %d following it.\n",
+                    argument, PACKED_MAX_PV_DEPTH);
+            exit(1);
+        }
+        return 2;
+    }
     else if (stringcompare(argument, "quiescent") == 0) {
         int threshold = 0;
 
@@ -1581,6 +1692,10 @@ process_long_form_argument(const char *argument, const char *associated_value)
         GlobalState.verbosity = 0;
         return 1;
     }
+    else if (stringcompare(argument, "quietpositions") == 0) {
+        GlobalState.quiet_positions_only = TRUE;
+        return 1;
+    }
     else if (stringcompare(argument, "repetition") == 0) {
         if(GlobalState.check_for_repetition == 0) {
             GlobalState.check_for_repetition = 3;
@@ -1653,6 +1768,40 @@ process_long_form_argument(const char *argument, const char *associated_value)
         }
         return 2;
     }
+    else if (stringcompare(argument, "split") == 0) {
+        double ratio;
+        int filename_start = 0;
+
+        if (sscanf(associated_value, "%lf:%n", &ratio, &filename_start) == 1 &&
+                filename_start > 0 && associated_value[filename_start] != '\0' &&
+                ratio > 0.0 && ratio <= 1.0) {
+            if (GlobalState.split_file != NULL) {
+                (void) fclose(GlobalState.split_file);
+            }
+            GlobalState.split_ratio = ratio;
+            GlobalState.split_file = must_open_file(&associated_value[filename_start], "w");
+        }
+        else {
+            fprintf(GlobalState.logfile,
+                    "--%s requires a fraction between 0 and 1 and a file name, as in 0.1:file\n",
+                    argument);
+            exit(1);
+        }
+        return 2;
+    }
+    else if (stringcompare(argument, "splitseed") == 0) {
+        unsigned long seed;
+
+        if (sscanf(associated_value, "%lu", &seed) == 1) {
+            GlobalState.split_seed = seed;
+        }
+        else {
+            fprintf(GlobalState.logfile,
+                    "--%s requires a number following it.\n", argument);
+            exit(1);
+        }
+        return 2;
+    }
     else if (stringcompare(argument, "splitvariants") == 0) {
         if(GlobalState.keep_variations) {
             GlobalState.split_variants = TRUE;
@@ -1753,6 +1902,10 @@ process_long_form_argument(const char *argument, const char *associated_value)
         GlobalState.output_total_plycount = TRUE;
         return 1;
     }
+    else if (stringcompare(argument, "ucilines") == 0) {
+        GlobalState.uci_lines_input = TRUE;
+        return 1;
+    }
     else if (stringcompare(argument, "underpromotion") == 0) {
         GlobalState.match_underpromotion = TRUE;
         return 1;
@@ -0,0 +1,182 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bool.h"
+#include "defs.h"
+#include "typedef.h"
+#include "taglist.h"
+#include "apply.h"
+#include "output.h"
+#include "bitboard.h"
+
+/* FEN letters for the bitboards, in BITBOARD_INDEX order. */
+static const char bitboard_letters[NUM_BITBOARDS] = {
+    'P', 'N', 'B', 'R', 'Q', 'K',
+    'p', 'n', 'b', 'r', 'q', 'k',
+};
+
+/* Fill bitboards with the piece positions on board. */
+void
+board_to_bitboards(const Board *board, uint64_t bitboards[NUM_BITBOARDS])
+{
+    Rank rank;
+    Col col;
+
+    memset(bitboards, 0, NUM_BITBOARDS * sizeof (*bitboards));
+    for (rank = FIRSTRANK; rank <= LASTRANK; rank++) {
+        int r = RankConvert(rank);
+        for (col = FIRSTCOL; col <= LASTCOL; col++) {
+            Piece occupant = board->board[r][ColConvert(col)];
+            if (occupant != EMPTY) {
+                Piece piece = EXTRACT_PIECE(occupant);
+                Colour colour = EXTRACT_COLOUR(occupant);
+                bitboards[BITBOARD_INDEX(colour, piece)] |=
+                        ((uint64_t) 1) << SQUARE_INDEX(col, rank);
+            }
+        }
+    }
+}
+
+/* Return the castling rights of board as a combination of
+ * the CASTLE_ bits.
+ */
+unsigned
+board_castling_rights(const Board *board)
+{
+    unsigned castling = 0;
+
+    if (board->WKingCastle != '\0') {
+        castling |= CASTLE_WHITE_KINGSIDE;
+    }
+    if (board->WQueenCastle != '\0') {
+        castling |= CASTLE_WHITE_QUEENSIDE;
+    }
+    if (board->BKingCastle != '\0') {
+        castling |= CASTLE_BLACK_KINGSIDE;
+    }
+    if (board->BQueenCastle != '\0') {
+        castling |= CASTLE_BLACK_QUEENSIDE;
+    }
+    return castling;
+}
+
+/* Return the square number of the en-passant target square of board,
+ * or -1 if there is none.
+ * As with FEN output, the square is omitted if --nofauxep is in force
+ * and the capture is not possible.
+ */
+int
+board_ep_square(const Board *board)
+{
+    if (!board->EnPassant) {
+        return -1;
+    }
+    else if (GlobalState.suppress_redundant_ep_info && ep_is_redundant(board)) {
+        return -1;
+    }
+    else {
+        return SQUARE_INDEX(board->ep_col, board->ep_rank);
+    }
+}
+
+/* Return a new board with the position described by bitboards.
+ * The result is NULL if the position is not a legal one.
+ */
+Board *
+new_bitboard_board(const uint64_t bitboards[NUM_BITBOARDS],
+                   Colour to_move, unsigned castling, int ep_square)
+{
+    char fen[FEN_SPACE];
+    int ix = 0;
+    int rank_index, col_index;
+
+    for (rank_index = BOARDSIZE - 1; rank_index >= 0; rank_index--) {
+        int empty = 0;
+        for (col_index = 0; col_index < BOARDSIZE; col_index++) {
+            uint64_t bit = ((uint64_t) 1) << (rank_index * BOARDSIZE + col_index);
+            int b;
+            for (b = 0; b < NUM_BITBOARDS && (bitboards[b] & bit) == 0; b++) {
+            }
+            if (b < NUM_BITBOARDS) {
+                if (empty > 0) {
+                    fen[ix++] = '0' + empty;
+                    empty = 0;
+                }
+                fen[ix++] = bitboard_letters[b];
+            }
+            else {
+                empty++;
+            }
+        }
+        if (empty > 0) {
+            fen[ix++] = '0' + empty;
+        }
+        if (rank_index > 0) {
+            fen[ix++] = '/';
+        }
+    }
+    fen[ix++] = ' ';
+    fen[ix++] = to_move == WHITE ? 'w' : 'b';
+    fen[ix++] = ' ';
+    if (castling == 0) {
+        fen[ix++] = '-';
+    }
+    else {
+        if (castling & CASTLE_WHITE_KINGSIDE) {
+            fen[ix++] = 'K';
+        }
+        if (castling & CASTLE_WHITE_QUEENSIDE) {
+            fen[ix++] = 'Q';
+        }
+        if (castling & CASTLE_BLACK_KINGSIDE) {
+            fen[ix++] = 'k';
+        }
+        if (castling & CASTLE_BLACK_QUEENSIDE) {
+            fen[ix++] = 'q';
+        }
+    }
+    fen[ix++] = ' ';
+    if (ep_square >= 0 && ep_square < BOARDSIZE * BOARDSIZE) {
+        fen[ix++] = FIRSTCOL + ep_square % BOARDSIZE;
+        fen[ix++] = FIRSTRANK + ep_square / BOARDSIZE;
+    }
+    else {
+        fen[ix++] = '-';
+    }
+    strcpy(&fen[ix], " 0 1");
+    return new_fen_board(fen);
+}
+
+/* Return the number of squares set in bitboard. */
+unsigned
+bitboard_popcount(uint64_t bitboard)
+{
+    unsigned count = 0;
+
+    while (bitboard != 0) {
+        bitboard &= bitboard - 1;
+        count++;
+    }
+    return count;
+}
@@ -0,0 +1,53 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+/* Conversion between a Board and a set of twelve bitboards,
+ * one for each coloured piece.
+ * Squares are numbered from a1 (0) to h8 (63), rank by rank.
+ * The bitboards are ordered White pawn, knight, bishop, rook, queen, king,
+ * followed by the Black pieces in the same order.
+ */
+
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#define NUM_BITBOARDS 12
+
+/* Bits of the value returned by board_castling_rights. */
+#define CASTLE_WHITE_KINGSIDE  0x01
+#define CASTLE_WHITE_QUEENSIDE 0x02
+#define CASTLE_BLACK_KINGSIDE  0x04
+#define CASTLE_BLACK_QUEENSIDE 0x08
+
+/* Square number of col,rank. */
+#define SQUARE_INDEX(col, rank) ((((rank) - FIRSTRANK) * BOARDSIZE) + ((col) - FIRSTCOL))
+/* Index into a bitboard array of a piece of the given colour. */
+#define BITBOARD_INDEX(colour, piece) \
+        (((colour) == WHITE ? 0 : 6) + (piece) - PAWN)
+
+void board_to_bitboards(const Board *board, uint64_t bitboards[NUM_BITBOARDS]);
+unsigned board_castling_rights(const Board *board);
+int board_ep_square(const Board *board);
+Board *new_bitboard_board(const uint64_t bitboards[NUM_BITBOARDS],
+                          Colour to_move, unsigned castling, int ep_square);
+unsigned bitboard_popcount(uint64_t bitboard);
+
+#endif	// BITBOARD_H
@@ -0,0 +1,119 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "bool.h"
+#include "mymalloc.h"
+#include "checkpoint.h"
+
+/* Read the values of fields from filename.
+ * Every field must be present.
+ */
+CheckpointStatus
+read_checkpoint(const char *filename, CheckpointField fields[], unsigned num_fields)
+{
+    FILE *fp = fopen(filename, "r");
+    CheckpointStatus status = CHECKPOINT_READ;
+    unsigned long found = 0;
+    char name[64];
+    unsigned long value;
+    unsigned f;
+
+    if (fp == NULL) {
+        return errno == ENOENT ? CHECKPOINT_ABSENT : CHECKPOINT_INVALID;
+    }
+    while (status == CHECKPOINT_READ && fscanf(fp, "%63s %lu", name, &value) == 2) {
+        for (f = 0; f < num_fields && strcmp(fields[f].name, name) != 0; f++) {
+        }
+        if (f < num_fields) {
+            fields[f].value = value;
+            found |= 1ul << f;
+        }
+        else {
+            status = CHECKPOINT_INVALID;
+        }
+    }
+    if (!feof(fp) || found != (1ul << num_fields) - 1) {
+        status = CHECKPOINT_INVALID;
+    }
+    (void) fclose(fp);
+    return status;
+}
+
+/* Replace filename with the values of fields.
+ * The new contents are written to a temporary file that is
+ * synced and then renamed over the old.
+ */
+Boolean
+write_checkpoint(const char *filename, const CheckpointField fields[], unsigned num_fields)
+{
+    char *temp_name = (char *) malloc_or_die(strlen(filename) + 5);
+    FILE *fp;
+    Boolean ok;
+    unsigned f;
+
+    sprintf(temp_name, "%s.tmp", filename);
+    fp = fopen(temp_name, "w");
+    ok = fp != NULL;
+    for (f = 0; ok && f < num_fields; f++) {
+        ok = fprintf(fp, "%s %lu\n", fields[f].name, fields[f].value) > 0;
+    }
+    if (fp != NULL) {
+        ok = sync_file(fp) && ok;
+        ok = fclose(fp) == 0 && ok;
+    }
+    if (ok) {
+        ok = rename(temp_name, filename) == 0;
+    }
+    (void) free((void *) temp_name);
+    return ok;
+}
+
+/* Make sure that everything written to fp is on disk. */
+Boolean
+sync_file(FILE *fp)
+{
+    return fflush(fp) == 0 && fsync(fileno(fp)) == 0;
+}
+
+/* Discard everything in fp from length onwards and position
+ * fp at the new end.
+ * Fail if fp is shorter than length.
+ */
+Boolean
+truncate_file(FILE *fp, unsigned long length)
+{
+    long current_length;
+
+    if (fflush(fp) != 0 || fseek(fp, 0L, SEEK_END) != 0 ||
+            (current_length = ftell(fp)) < 0 ||
+            (unsigned long) current_length < length) {
+        return FALSE;
+    }
+    return ftruncate(fileno(fp), (off_t) length) == 0 &&
+            fseek(fp, 0L, SEEK_END) == 0;
+}
@@ -0,0 +1,48 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+/* Durable progress records that allow a long run to be resumed
+ * (pgn-extract --checkpoint and uci-pool -c).
+ * A checkpoint file holds one "name value" pair per line.
+ * It is replaced atomically, so an interrupted run always leaves
+ * either the previous checkpoint or the new one.
+ */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+typedef struct {
+    const char *name;
+    unsigned long value;
+} CheckpointField;
+
+typedef enum {
+    CHECKPOINT_ABSENT, CHECKPOINT_READ, CHECKPOINT_INVALID
+} CheckpointStatus;
+
+CheckpointStatus read_checkpoint(const char *filename,
+                                 CheckpointField fields[], unsigned num_fields);
+Boolean write_checkpoint(const char *filename,
+                         const CheckpointField fields[], unsigned num_fields);
+Boolean sync_file(FILE *fp);
+Boolean truncate_file(FILE *fp, unsigned long length);
+
+#endif	// CHECKPOINT_H
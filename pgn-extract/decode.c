@@ -141,6 +141,7 @@ new_move_structure(void)
     move->check_status = NOCHECK;
     move->epd = NULL;
     move->fen_suffix = NULL;
+    move->quiet = FALSE;
     move->zobrist = ~0;
     move->evaluation = 0;
     move->NAGs = NULL;
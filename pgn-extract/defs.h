@@ -85,6 +85,44 @@ typedef char Col;
  */
 typedef uint64_t HashCode;
 
+/* A material signature packs the number of each coloured piece
+ * on a board into a field of MATERIAL_FIELD_BITS, in the order of the
+ * bitboards of bitboard.h: White pawn ... king, then Black.
+ * A count never exceeds MATERIAL_MAX_COUNT in a legal position, which
+ * leaves the top bit of each field clear as a guard, so that all of the
+ * fields of two signatures can be compared at once by a subtraction;
+ * see MATERIAL_COVERS.
+ * A count in an impossible position is held at MATERIAL_MAX_COUNT,
+ * and a signature with such a saturated count cannot be bounded.
+ */
+typedef uint64_t MaterialSignature;
+
+#define MATERIAL_FIELD_BITS 5
+#define MATERIAL_MAX_COUNT 15
+/* The field of colour's piece. */
+#define MATERIAL_FIELD(colour, piece) \
+        ((((colour) == WHITE ? 0 : 6) + (piece) - PAWN) * MATERIAL_FIELD_BITS)
+/* The signature of a single piece. */
+#define MATERIAL_UNIT(colour, piece) \
+        (((MaterialSignature) 1) << MATERIAL_FIELD(colour, piece))
+/* The number of colour's piece in signature. */
+#define MATERIAL_COUNT(signature, colour, piece) \
+        ((int) (((signature) >> MATERIAL_FIELD(colour, piece)) & MATERIAL_MAX_COUNT))
+/* The guard bit of every field. */
+#define MATERIAL_GUARD_BITS UINT64_C(0x0842108421084210)
+/* The largest count in every field. */
+#define MATERIAL_NO_LIMIT (MATERIAL_GUARD_BITS - (MATERIAL_GUARD_BITS >> 4))
+/* Whether every count of signature a is at least that of signature b. */
+#define MATERIAL_COVERS(a, b) \
+        (((((a) | MATERIAL_GUARD_BITS) - (b)) & MATERIAL_GUARD_BITS) == MATERIAL_GUARD_BITS)
+/* Whether any count of signature has reached MATERIAL_MAX_COUNT. */
+#define MATERIAL_SATURATED(signature) \
+        ((((signature) + (MATERIAL_GUARD_BITS >> 4)) & MATERIAL_GUARD_BITS) != 0)
+/* Whether signature might lie between the bounds lower and upper. */
+#define MATERIAL_WITHIN(signature, lower, upper) \
+        (MATERIAL_SATURATED(signature) || \
+         (MATERIAL_COVERS(signature, lower) && MATERIAL_COVERS(upper, signature)))
+
 typedef struct {
     Piece board[HEDGE+BOARDSIZE+HEDGE][HEDGE+BOARDSIZE+HEDGE];
     /* Who has the next move. */
@@ -119,6 +157,8 @@ typedef struct {
     uint64_t zobrist;
     /* The half-move clock since the last pawn move or capture. */
     unsigned halfmove_clock;
+    /* The number of each piece on the board. */
+    MaterialSignature material_signature;
 } Board;
 
 /* Define a type that can be used to create a list of possible source
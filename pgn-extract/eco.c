@@ -23,6 +23,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <limits.h>
 #include "bool.h"
 #include "mymalloc.h"
 #include "defs.h"
@@ -39,18 +40,35 @@
  * where the line could still be active.
  */
 #define ECO_HALF_MOVE_LIMIT 6
-/* Keep track of the longest ECO line, in half moves, plus
- * ECO_HALF_MOVE_LIMIT.
- * If a line exceeds this length, don't bother attempting
- * a match.
+
+/* The entries of EcoTable whose positions share a hash value. */
+typedef struct {
+    HashCode hash_value;
+    /* The entries, most recently added first, or NULL if the slot
+     * is unused.
+     */
+    EcoLog *entries;
+} EcoSlot;
+
+/* Define an open-addressing table to hold hash values of the
+ * ECO positions.  It doubles in size whenever it becomes more than
+ * half full.
  */
-static unsigned maximum_half_moves = ECO_HALF_MOVE_LIMIT;
+#define INITIAL_ECO_TABLE_SIZE 1024
+static EcoSlot *EcoTable = NULL;
+static unsigned eco_table_size = 0;
+static unsigned eco_table_used = 0;
 
-/* Define a table to hold hash values of the ECO positions.
- * This is used to enable duplicate detection.
+/* The number of combinations of pawns on their starting squares. */
+#define NUM_HOME_PAWN_SETS (1 << 16)
+/* For each set of pawns on their starting squares, one more than the
+ * greatest half_moves of an entry whose home pawns are all within
+ * that set, or 0 if there is no such entry.
+ * A pawn never returns to its starting square, so this bounds
+ * the depth of the lines that a game might still match.
+ * Built when first required, and discarded when an entry is added.
  */
-#define ECO_TABLE_SIZE 4096
-static EcoLog **EcoTable;
+static unsigned short *book_horizon = NULL;
 
 #if INCLUDE_UNUSED_FUNCTIONS
 
@@ -58,10 +76,10 @@ static void
 dumpEcoTable(void)
 {
     unsigned ix;
-    for (ix = 0; ix < ECO_TABLE_SIZE; ix++) {
-        if (EcoTable[ix] != NULL) {
+    for (ix = 0; ix < eco_table_size; ix++) {
+        if (EcoTable[ix].entries != NULL) {
             EcoLog *entry = NULL;
-            for (entry = EcoTable[ix]; entry != NULL; entry = entry->next) {
+            for (entry = EcoTable[ix].entries; entry != NULL; entry = entry->next) {
                 fprintf(stderr, "%s %lu %lu ", entry->ECO_tag,
                         entry->required_hash_value,
                         entry->cumulative_hash_value);
@@ -132,21 +150,129 @@ void initEcoTable(void)
 {
     /* Avoid multiple calls. */
     if (EcoTable == NULL) {
-        int i;
-        EcoTable = (EcoLog **) malloc_or_die(ECO_TABLE_SIZE * sizeof (EcoLog *));
+        unsigned i;
+        eco_table_size = INITIAL_ECO_TABLE_SIZE;
+        EcoTable = (EcoSlot *) malloc_or_die(eco_table_size * sizeof (EcoSlot));
+
+        for (i = 0; i < eco_table_size; i++) {
+            EcoTable[i].entries = NULL;
+        }
+    }
+}
+
+/* Return the slot of EcoTable for hash_value: either the one in use
+ * for it or the unused one where it belongs.
+ */
+static EcoSlot *
+eco_slot(HashCode hash_value)
+{
+    unsigned mask = eco_table_size - 1;
+    /* Mix the bits, as those of hash values are not evenly spread. */
+    unsigned ix = (unsigned) ((hash_value * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
 
-        for (i = 0; i < ECO_TABLE_SIZE; i++) {
-            EcoTable[i] = NULL;
+    while (EcoTable[ix].entries != NULL && EcoTable[ix].hash_value != hash_value) {
+        ix = (ix + 1) & mask;
+    }
+    return &EcoTable[ix];
+}
+
+/* Double the size of EcoTable. */
+static void
+grow_eco_table(void)
+{
+    EcoSlot *old_table = EcoTable;
+    unsigned old_size = eco_table_size;
+    unsigned i;
+
+    eco_table_size *= 2;
+    EcoTable = (EcoSlot *) malloc_or_die(eco_table_size * sizeof (EcoSlot));
+    for (i = 0; i < eco_table_size; i++) {
+        EcoTable[i].entries = NULL;
+    }
+    for (i = 0; i < old_size; i++) {
+        if (old_table[i].entries != NULL) {
+            *eco_slot(old_table[i].hash_value) = old_table[i];
+        }
+    }
+    (void) free((void *) old_table);
+}
+
+/* Return the set of pawns on their starting squares:
+ * bit col for a White pawn on the second rank and
+ * bit 8 + col for a Black pawn on the seventh.
+ */
+static unsigned
+home_pawns(const Board *board)
+{
+    unsigned pawns = 0;
+    Col col;
+
+    for (col = FIRSTCOL; col <= LASTCOL; col++) {
+        if (board->board[RankConvert(FIRSTRANK + 1)][ColConvert(col)] == W(PAWN)) {
+            pawns |= 1u << (col - FIRSTCOL);
+        }
+        if (board->board[RankConvert(LASTRANK - 1)][ColConvert(col)] == B(PAWN)) {
+            pawns |= 1u << (8 + col - FIRSTCOL);
+        }
+    }
+    return pawns;
+}
+
+/* Build book_horizon from the entries of EcoTable. */
+static void
+build_book_horizon(void)
+{
+    unsigned ix, bit, set;
+
+    book_horizon = (unsigned short *) malloc_or_die(NUM_HOME_PAWN_SETS *
+                                                    sizeof (*book_horizon));
+    for (set = 0; set < NUM_HOME_PAWN_SETS; set++) {
+        book_horizon[set] = 0;
+    }
+    for (ix = 0; ix < eco_table_size; ix++) {
+        const EcoLog *entry;
+        for (entry = EcoTable[ix].entries; entry != NULL; entry = entry->next) {
+            unsigned depth = entry->half_moves + 1;
+            if (depth > USHRT_MAX) {
+                depth = USHRT_MAX;
+            }
+            if (depth > book_horizon[entry->home_pawns]) {
+                book_horizon[entry->home_pawns] = depth;
+            }
+        }
+    }
+    /* Extend each set's value to all of its supersets. */
+    for (bit = 1; bit < NUM_HOME_PAWN_SETS; bit <<= 1) {
+        for (set = 0; set < NUM_HOME_PAWN_SETS; set++) {
+            if ((set & bit) != 0 && book_horizon[set ^ bit] > book_horizon[set]) {
+                book_horizon[set] = book_horizon[set ^ bit];
+            }
         }
     }
 }
 
+/* Could board, after half_moves_played, lead to a position that
+ * eco_matches would accept?
+ * Once it could not, no later position of the same game could either.
+ */
+Boolean
+eco_line_reachable(const Board *board, unsigned half_moves_played)
+{
+    if (book_horizon == NULL) {
+        build_book_horizon();
+    }
+    /* A match requires an entry no more than ECO_HALF_MOVE_LIMIT
+     * half moves shorter than the game.
+     */
+    return half_moves_played <
+            (unsigned) book_horizon[home_pawns(board)] + ECO_HALF_MOVE_LIMIT;
+}
+
 /* Enter the ECO details of game into EcoTable.
  */
 void
 save_eco_details(const Game *game_details, const Board *final_position, unsigned number_of_half_moves)
 {
-    unsigned ix = game_details->final_hash_value % ECO_TABLE_SIZE;
     EcoLog *entry = NULL;
     /* Assume that it can be saved: that there is no collision. */
     Boolean can_save = TRUE;
@@ -157,7 +283,8 @@ save_eco_details(const Game *game_details, const Board *final_position, unsigned
      */
     static EcoLog *last_entry = NULL;
 
-    for (entry = EcoTable[ix]; (entry != NULL) && can_save; entry = entry->next) {
+    for (entry = eco_slot(game_details->final_hash_value)->entries;
+            (entry != NULL) && can_save; entry = entry->next) {
         if ((entry->required_hash_value == game_details->final_hash_value) &&
                 (entry->half_moves == number_of_half_moves) &&
                 (entry->cumulative_hash_value == game_details->cumulative_hash_value)) {
@@ -205,10 +332,7 @@ save_eco_details(const Game *game_details, const Board *final_position, unsigned
          * check on matches.
          */
         entry->half_moves = number_of_half_moves;
-        /* Check for a new greater depth. */
-        if (number_of_half_moves + ECO_HALF_MOVE_LIMIT > maximum_half_moves) {
-            maximum_half_moves = number_of_half_moves + ECO_HALF_MOVE_LIMIT;
-        }
+        entry->home_pawns = home_pawns(final_position);
         if (game_details->tags[ECO_TAG] != NULL) {
             if ((last_entry != NULL) && (last_entry->ECO_tag != NULL) &&
                     (strcmp(last_entry->ECO_tag, game_details->tags[ECO_TAG]) == 0)) {
@@ -249,14 +373,61 @@ save_eco_details(const Game *game_details, const Board *final_position, unsigned
         else {
             entry->Sub_Variation_tag = NULL;
         }
-        /* Link it into the head at this index. */
-        entry->next = EcoTable[ix];
-        EcoTable[ix] = entry;
+        add_eco_entry(entry);
         /* Keep this one for next time around. */
         last_entry = entry;
     }
 }
 
+/* Link a completed entry into EcoTable. */
+void
+add_eco_entry(EcoLog *entry)
+{
+    EcoSlot *slot = eco_slot(entry->required_hash_value);
+
+    if (slot->entries == NULL) {
+        if (2 * (eco_table_used + 1) > eco_table_size) {
+            grow_eco_table();
+            slot = eco_slot(entry->required_hash_value);
+        }
+        slot->hash_value = entry->required_hash_value;
+        eco_table_used++;
+    }
+    /* Link it into the head of the slot's entries. */
+    entry->next = slot->entries;
+    slot->entries = entry;
+    if (book_horizon != NULL) {
+        (void) free((void *) book_horizon);
+        book_horizon = NULL;
+    }
+}
+
+/* Pass chain to visit, oldest entry first. */
+static void
+visit_eco_chain(const EcoLog *chain,
+                void (*visit)(const EcoLog *entry, void *context), void *context)
+{
+    if (chain != NULL) {
+        visit_eco_chain(chain->next, visit, context);
+        visit(chain, context);
+    }
+}
+
+/* Pass each entry of EcoTable to visit.
+ * The entries of a slot are passed in the order in which
+ * they were added, so adding them in that order to an empty table
+ * rebuilds EcoTable exactly.
+ */
+void
+visit_eco_entries(void (*visit)(const EcoLog *entry, void *context), void *context)
+{
+    unsigned ix;
+
+    for (ix = 0; ix < eco_table_size; ix++) {
+        visit_eco_chain(EcoTable[ix].entries, visit, context);
+    }
+}
+
 /* Look in EcoTable for current_hash_value.
  * Use cumulative_hash_value to refine the match.
  * An exact match is preferable to a partial match.
@@ -268,28 +439,21 @@ eco_matches(const Board *board, HashCode cumulative_hash_value,
     HashCode current_hash_value = board->weak_hash_value;
     EcoLog *possible = NULL;
 
-    /* Don't bother trying if we are too far on in the game.  */
-    if (half_moves_played <= maximum_half_moves) {
-        /* Where to look. */
-        unsigned ix = current_hash_value % ECO_TABLE_SIZE;
-        EcoLog *entry;
-
-        for (entry = EcoTable[ix]; entry != NULL; entry = entry->next) {
-            if (entry->required_hash_value == current_hash_value) {
-                /* See if we have a full match. */
-                if (half_moves_played == entry->half_moves &&
-                        entry->cumulative_hash_value == cumulative_hash_value) {
-                    return entry;
-                }
-                else if ((half_moves_played - entry->half_moves) <=
-                        ECO_HALF_MOVE_LIMIT) {
-                    /* Retain this as a possible. */
-                    possible = entry;
-                }
-                else {
-                    /* Ignore it, as the lines are too distant. */
-                }
-            }
+    EcoLog *entry;
+
+    for (entry = eco_slot(current_hash_value)->entries; entry != NULL; entry = entry->next) {
+        /* See if we have a full match. */
+        if (half_moves_played == entry->half_moves &&
+                entry->cumulative_hash_value == cumulative_hash_value) {
+            return entry;
+        }
+        else if ((half_moves_played - entry->half_moves) <=
+                ECO_HALF_MOVE_LIMIT) {
+            /* Retain this as a possible. */
+            possible = entry;
+        }
+        else {
+            /* Ignore it, as the lines are too distant. */
         }
     }
     return possible;
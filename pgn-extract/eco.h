@@ -33,6 +33,8 @@ typedef struct EcoLog {
      * the board when the line is played out.
      */
     unsigned half_moves;
+    /* The pawns on their starting squares in the line's final position. */
+    unsigned home_pawns;
     const char *ECO_tag;
     const char *Opening_tag;
     const char *Variation_tag;
@@ -42,10 +44,13 @@ typedef struct EcoLog {
 
 EcoLog *eco_matches(const Board *board, HashCode cumulative_hash_value,
                     unsigned half_moves_played);
+Boolean eco_line_reachable(const Board *board, unsigned half_moves_played);
 Boolean add_ECO(Game game_details);
 FILE *open_eco_output_file(EcoDivision ECO_level,const char *eco);
 void initEcoTable(void);
 void save_eco_details(const Game *game_details, const Board *final_position, unsigned number_of_moves);
+void add_eco_entry(EcoLog *entry);
+void visit_eco_entries(void (*visit)(const EcoLog *entry, void *context), void *context);
 
 #endif	// ECO_H
 
@@ -0,0 +1,387 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+/* The binary cache of an ECO table (--ecocache); see ecocache.h.
+ * A cache file starts with a header of ECO_CACHE_HEADER_SIZE bytes:
+ *     offset  0: magic, ECO_CACHE_MAGIC (8 bytes, no terminator)
+ *     offset  8: uint32 version, ECO_CACHE_VERSION
+ *     offset 12: uint32 number of entries
+ *     offset 16: uint64 size of the ECO file
+ *     offset 24: uint64 checksum of the ECO file
+ *     offset 32: uint64 hash value of the initial position
+ *     offset 40: uint64 size of the string area
+ * followed by the entries, each of ECO_CACHE_ENTRY_SIZE bytes:
+ *     offset  0: uint64 required_hash_value
+ *     offset  8: uint64 cumulative_hash_value
+ *     offset 16: uint32 half_moves
+ *     offset 20: uint32 offsets of the ECO, Opening, Variation and
+ *                SubVariation strings in the string area, or
+ *                ECO_CACHE_NO_STRING
+ *     offset 36: uint32 home_pawns
+ * and then the string area of terminated strings.
+ * All values are little-endian.
+ * The entries are in the order in which they were added to the
+ * table, so that adding them again rebuilds it exactly.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "bool.h"
+#include "mymalloc.h"
+#include "defs.h"
+#include "typedef.h"
+#include "apply.h"
+#include "eco.h"
+#include "ecocache.h"
+
+#define ECO_CACHE_MAGIC "PGNXECO\n"
+#define ECO_CACHE_VERSION 2
+#define ECO_CACHE_HEADER_SIZE 48
+#define ECO_CACHE_ENTRY_SIZE 40
+#define ECO_CACHE_NO_STRING 0xFFFFFFFFu
+
+/* The size and checksum of an ECO file. */
+typedef struct {
+    uint64_t size;
+    uint64_t checksum;
+} EcoFingerprint;
+
+/* A cache file being built in memory. */
+typedef struct {
+    unsigned char *entries;
+    size_t entries_length, entries_space;
+    char *strings;
+    size_t strings_length, strings_space;
+    uint32_t num_entries;
+} EcoCacheImage;
+
+static uint32_t
+read_uint32(const unsigned char *bytes)
+{
+    return (uint32_t) bytes[0] | ((uint32_t) bytes[1] << 8) |
+           ((uint32_t) bytes[2] << 16) | ((uint32_t) bytes[3] << 24);
+}
+
+static uint64_t
+read_uint64(const unsigned char *bytes)
+{
+    return (uint64_t) read_uint32(bytes) | ((uint64_t) read_uint32(bytes + 4) << 32);
+}
+
+static void
+write_uint32(uint32_t value, unsigned char *bytes)
+{
+    unsigned i;
+
+    for (i = 0; i < 4; i++) {
+        bytes[i] = (unsigned char) (value >> (8 * i));
+    }
+}
+
+static void
+write_uint64(uint64_t value, unsigned char *bytes)
+{
+    write_uint32((uint32_t) value, bytes);
+    write_uint32((uint32_t) (value >> 32), bytes + 4);
+}
+
+/* Set *fingerprint from the contents of filename.
+ * Return FALSE if it cannot be read.
+ */
+static Boolean
+fingerprint_eco_file(const char *filename, EcoFingerprint *fingerprint)
+{
+    FILE *fp = fopen(filename, "rb");
+    unsigned char buffer[BUFSIZ];
+    size_t length;
+    /* 64-bit FNV-1a. */
+    uint64_t checksum = 0xcbf29ce484222325ULL;
+    uint64_t size = 0;
+    Boolean ok;
+
+    if (fp == NULL) {
+        return FALSE;
+    }
+    while ((length = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
+        size_t i;
+
+        for (i = 0; i < length; i++) {
+            checksum = (checksum ^ buffer[i]) * 0x100000001b3ULL;
+        }
+        size += length;
+    }
+    ok = !ferror(fp);
+    (void) fclose(fp);
+    fingerprint->size = size;
+    fingerprint->checksum = checksum;
+    return ok;
+}
+
+/* The hash value of the initial position, which ties a cache to
+ * the hash values of the program that built it.
+ */
+static uint64_t
+initial_hash_value(void)
+{
+    Board *board = new_game_board(NULL);
+    uint64_t hash_value = board->weak_hash_value;
+
+    free_board(board);
+    return hash_value;
+}
+
+/* Decode the string at offset in a string area of the given length. */
+static Boolean
+decode_cache_string(const char *strings, uint64_t length, uint32_t offset,
+                    const char **str)
+{
+    if (offset == ECO_CACHE_NO_STRING) {
+        *str = NULL;
+        return TRUE;
+    }
+    else if (offset < length) {
+        /* The area is known to end with a terminator. */
+        *str = strings + offset;
+        return TRUE;
+    }
+    else {
+        return FALSE;
+    }
+}
+
+/* Add the entries of cache_file to the ECO table if it is a cache of
+ * eco_file. The file remains mapped for the strings of the entries.
+ * Return FALSE, with the table unchanged, if it is absent or not
+ * a cache of the current contents of eco_file.
+ */
+Boolean
+load_eco_cache(const char *cache_file, const char *eco_file)
+{
+    EcoFingerprint fingerprint;
+    struct stat status;
+    const unsigned char *data;
+    void *mapping;
+    size_t length;
+    uint32_t num_entries = 0;
+    uint64_t strings_length = 0;
+    const char *strings = NULL;
+    EcoLog *entries = NULL;
+    Boolean ok;
+    int fd;
+
+    fd = open(cache_file, O_RDONLY);
+    if (fd < 0) {
+        return FALSE;
+    }
+    if (fstat(fd, &status) != 0 || !S_ISREG(status.st_mode) ||
+            status.st_size < ECO_CACHE_HEADER_SIZE) {
+        (void) close(fd);
+        return FALSE;
+    }
+    length = (size_t) status.st_size;
+    mapping = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+    (void) close(fd);
+    if (mapping == MAP_FAILED) {
+        return FALSE;
+    }
+    data = (const unsigned char *) mapping;
+
+    ok = memcmp(data, ECO_CACHE_MAGIC, 8) == 0 &&
+         read_uint32(data + 8) == ECO_CACHE_VERSION &&
+         fingerprint_eco_file(eco_file, &fingerprint) &&
+         read_uint64(data + 16) == fingerprint.size &&
+         read_uint64(data + 24) == fingerprint.checksum &&
+         read_uint64(data + 32) == initial_hash_value();
+    if (ok) {
+        num_entries = read_uint32(data + 12);
+        strings_length = read_uint64(data + 40);
+        ok = (length - ECO_CACHE_HEADER_SIZE) / ECO_CACHE_ENTRY_SIZE >= num_entries &&
+             length - ECO_CACHE_HEADER_SIZE -
+                (size_t) num_entries * ECO_CACHE_ENTRY_SIZE == strings_length;
+    }
+    if (ok) {
+        strings = (const char *) data + ECO_CACHE_HEADER_SIZE +
+                  (size_t) num_entries * ECO_CACHE_ENTRY_SIZE;
+        ok = strings_length == 0 || strings[strings_length - 1] == '\0';
+    }
+    if (ok && num_entries > 0) {
+        uint32_t i;
+
+        entries = (EcoLog *) malloc_or_die(num_entries * sizeof(*entries));
+        for (i = 0; i < num_entries && ok; i++) {
+            const unsigned char *record = data + ECO_CACHE_HEADER_SIZE +
+                                          (size_t) i * ECO_CACHE_ENTRY_SIZE;
+            EcoLog *entry = &entries[i];
+
+            entry->required_hash_value = read_uint64(record);
+            entry->cumulative_hash_value = read_uint64(record + 8);
+            entry->half_moves = read_uint32(record + 16);
+            entry->home_pawns = read_uint32(record + 36);
+            entry->next = NULL;
+            ok = decode_cache_string(strings, strings_length,
+                                     read_uint32(record + 20), &entry->ECO_tag) &&
+                 decode_cache_string(strings, strings_length,
+                                     read_uint32(record + 24), &entry->Opening_tag) &&
+                 decode_cache_string(strings, strings_length,
+                                     read_uint32(record + 28), &entry->Variation_tag) &&
+                 decode_cache_string(strings, strings_length,
+                                     read_uint32(record + 32), &entry->Sub_Variation_tag);
+        }
+        if (ok) {
+            for (i = 0; i < num_entries; i++) {
+                add_eco_entry(&entries[i]);
+            }
+        }
+        else {
+            (void) free((void *) entries);
+        }
+    }
+    if (ok) {
+        if (GlobalState.verbosity > 1) {
+            fprintf(GlobalState.logfile, "%lu ECO lines loaded from %s.\n",
+                    (unsigned long) num_entries, cache_file);
+        }
+    }
+    else {
+        (void) munmap(mapping, length);
+    }
+    return ok;
+}
+
+/* Append str to the string area of image.
+ * Return its offset, or ECO_CACHE_NO_STRING if it is NULL.
+ */
+static uint32_t
+add_cache_string(EcoCacheImage *image, const char *str)
+{
+    if (str == NULL) {
+        return ECO_CACHE_NO_STRING;
+    }
+    else {
+        size_t length = strlen(str) + 1;
+        size_t offset = image->strings_length;
+
+        if (offset + length > image->strings_space) {
+            image->strings_space = 2 * (offset + length);
+            image->strings = (char *) realloc_or_die((void *) image->strings,
+                                                     image->strings_space);
+        }
+        memcpy(image->strings + offset, str, length);
+        image->strings_length += length;
+        return (uint32_t) offset;
+    }
+}
+
+/* Append entry to the image in context. */
+static void
+add_cache_entry(const EcoLog *entry, void *context)
+{
+    EcoCacheImage *image = (EcoCacheImage *) context;
+    unsigned char *record;
+
+    if (image->entries_length + ECO_CACHE_ENTRY_SIZE > image->entries_space) {
+        image->entries_space = 2 * (image->entries_length + ECO_CACHE_ENTRY_SIZE);
+        image->entries = (unsigned char *) realloc_or_die((void *) image->entries,
+                                                          image->entries_space);
+    }
+    record = image->entries + image->entries_length;
+    write_uint64(entry->required_hash_value, record);
+    write_uint64(entry->cumulative_hash_value, record + 8);
+    write_uint32(entry->half_moves, record + 16);
+    write_uint32(add_cache_string(image, entry->ECO_tag), record + 20);
+    write_uint32(add_cache_string(image, entry->Opening_tag), record + 24);
+    write_uint32(add_cache_string(image, entry->Variation_tag), record + 28);
+    write_uint32(add_cache_string(image, entry->Sub_Variation_tag), record + 32);
+    write_uint32(entry->home_pawns, record + 36);
+    image->entries_length += ECO_CACHE_ENTRY_SIZE;
+    image->num_entries++;
+}
+
+/* Write the ECO table, built from eco_file, to cache_file.
+ * The cache is written to a temporary file that then replaces
+ * cache_file, so that concurrent runs never see a partial cache.
+ * Failure is reported but is not fatal.
+ */
+void
+save_eco_cache(const char *cache_file, const char *eco_file)
+{
+    EcoCacheImage image = { NULL, 0, 0, NULL, 0, 0, 0 };
+    EcoFingerprint fingerprint;
+    unsigned char header[ECO_CACHE_HEADER_SIZE];
+    char *temp_file;
+    Boolean ok;
+    FILE *fp = NULL;
+    int fd;
+
+    if (!fingerprint_eco_file(eco_file, &fingerprint)) {
+        fprintf(GlobalState.logfile, "Unable to read the ECO file %s.\n", eco_file);
+        return;
+    }
+    visit_eco_entries(add_cache_entry, &image);
+
+    memset(header, 0, sizeof(header));
+    memcpy(header, ECO_CACHE_MAGIC, 8);
+    write_uint32(ECO_CACHE_VERSION, header + 8);
+    write_uint32(image.num_entries, header + 12);
+    write_uint64(fingerprint.size, header + 16);
+    write_uint64(fingerprint.checksum, header + 24);
+    write_uint64(initial_hash_value(), header + 32);
+    write_uint64(image.strings_length, header + 40);
+
+    temp_file = (char *) malloc_or_die(strlen(cache_file) + sizeof(".XXXXXX"));
+    sprintf(temp_file, "%s.XXXXXX", cache_file);
+    fd = mkstemp(temp_file);
+    ok = fd >= 0 && fchmod(fd, 0644) == 0 && (fp = fdopen(fd, "wb")) != NULL;
+    if (ok) {
+        ok = fwrite(header, 1, sizeof(header), fp) == sizeof(header) &&
+             fwrite(image.entries, 1, image.entries_length, fp) == image.entries_length &&
+             fwrite(image.strings, 1, image.strings_length, fp) == image.strings_length;
+        ok = fclose(fp) == 0 && ok;
+    }
+    else if (fd >= 0) {
+        (void) close(fd);
+    }
+    if (ok) {
+        ok = rename(temp_file, cache_file) == 0;
+    }
+    if (!ok) {
+        fprintf(GlobalState.logfile, "Unable to write the ECO cache %s.\n", cache_file);
+        if (fd >= 0) {
+            (void) unlink(temp_file);
+        }
+    }
+    else if (GlobalState.verbosity > 1) {
+        fprintf(GlobalState.logfile, "%lu ECO lines saved in %s.\n",
+                (unsigned long) image.num_entries, cache_file);
+    }
+    (void) free((void *) temp_file);
+    (void) free((void *) image.entries);
+    (void) free((void *) image.strings);
+}
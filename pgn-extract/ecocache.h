@@ -0,0 +1,35 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+/* A binary cache of the table built from an ECO file (--ecocache).
+ * Parsing the ECO file dominates the start-up time of -e runs on
+ * small inputs, so the table can be saved once and mapped on later runs.
+ * A cache is used only if it was built from an ECO file of the same
+ * size and checksum, and with the same position hash values.
+ */
+
+#ifndef ECOCACHE_H
+#define ECOCACHE_H
+
+Boolean load_eco_cache(const char *cache_file, const char *eco_file);
+void save_eco_cache(const char *cache_file, const char *eco_file);
+
+#endif	// ECOCACHE_H
@@ -352,6 +352,68 @@ decompose_line(const char *line, Material_details *details)
     return Ok;
 }
 
+/* Set the bounds on the material of a position that could match
+ * details, for each way around that the colours might be matched.
+ * Only requirements on absolute numbers of pieces give bounds.
+ */
+static void
+set_material_bounds(Material_details *details)
+{
+    Colour orientation;
+
+    for (orientation = BLACK; orientation <= WHITE; orientation++) {
+        MaterialSignature lower = 0, upper = 0;
+        Colour piece_set_colour;
+
+        for (piece_set_colour = BLACK; piece_set_colour <= WHITE; piece_set_colour++) {
+            /* The colour of the pieces matched against this set. */
+            Colour colour = orientation == WHITE ?
+                    piece_set_colour : OPPOSITE_COLOUR(piece_set_colour);
+            /* Individual minor pieces need not match if there is a
+             * requirement on the number of minor pieces.
+             */
+            Boolean minor_requirement =
+                    details->num_minor_pieces[piece_set_colour] > 0 ||
+                    details->minor_occurs[piece_set_colour] != EXACTLY;
+            Piece piece;
+
+            /* No need to bound KING. */
+            for (piece = PAWN; piece < KING; piece++) {
+                int num = details->num_pieces[piece_set_colour][piece];
+                int least = 0, most = MATERIAL_MAX_COUNT;
+
+                if (num > MATERIAL_MAX_COUNT) {
+                    num = MATERIAL_MAX_COUNT;
+                }
+                if ((piece == KNIGHT || piece == BISHOP) && minor_requirement) {
+                    /* Unbounded. */
+                }
+                else {
+                    switch (details->occurs[piece_set_colour][piece]) {
+                        case EXACTLY:
+                            least = most = num;
+                            break;
+                        case NUM_OR_MORE:
+                            least = num;
+                            break;
+                        case NUM_OR_LESS:
+                            most = num;
+                            break;
+                        default:
+                            /* Relative to the opponent. */
+                            break;
+                    }
+                }
+                lower += least * MATERIAL_UNIT(colour, piece);
+                upper += most * MATERIAL_UNIT(colour, piece);
+            }
+            upper += MATERIAL_MAX_COUNT * MATERIAL_UNIT(colour, KING);
+        }
+        details->lower[orientation] = lower;
+        details->upper[orientation] = upper;
+    }
+}
+
 /* A new game to be looked for. Indicate that we have not
  * started matching any yet.
  */
@@ -412,12 +474,12 @@ piece_match(int num_available, int num_to_find, int num_opponents, Occurs occurs
     return match;
 }
 
-/* Try to find a match against one player's pieces in the piece_set_colour
- * set of details_to_find.
+/* Try to find a match against one player's pieces, in material, in
+ * the piece_set_colour set of details_to_find.
  */
 static Boolean
 piece_set_match(const Material_details *details_to_find,
-        int num_pieces[2][NUM_PIECE_VALUES],
+        MaterialSignature material,
         Colour game_colour, Colour piece_set_colour)
 {
     Boolean match = TRUE;
@@ -427,8 +489,8 @@ piece_set_match(const Material_details *details_to_find,
 
     /* No need to check KING. */
     for (piece = PAWN; (piece < KING) && match; piece++) {
-        int num_available = num_pieces[game_colour][piece];
-        int num_opponents = num_pieces[OPPOSITE_COLOUR(game_colour)][piece];
+        int num_available = MATERIAL_COUNT(material, game_colour, piece);
+        int num_opponents = MATERIAL_COUNT(material, OPPOSITE_COLOUR(game_colour), piece);
         int num_to_find = details_to_find->num_pieces[piece_set_colour][piece];
         Occurs occurs = details_to_find->occurs[piece_set_colour][piece];
 
@@ -454,10 +516,11 @@ piece_set_match(const Material_details *details_to_find,
 
         if ((num_to_find > 0) || (occurs != EXACTLY)) {
             int num_available =
-                    num_pieces[game_colour][BISHOP] +
-                    num_pieces[game_colour][KNIGHT];
-            int num_opponents = num_pieces[OPPOSITE_COLOUR(game_colour)][BISHOP] +
-                    num_pieces[OPPOSITE_COLOUR(game_colour)][KNIGHT];
+                    MATERIAL_COUNT(material, game_colour, BISHOP) +
+                    MATERIAL_COUNT(material, game_colour, KNIGHT);
+            int num_opponents =
+                    MATERIAL_COUNT(material, OPPOSITE_COLOUR(game_colour), BISHOP) +
+                    MATERIAL_COUNT(material, OPPOSITE_COLOUR(game_colour), KNIGHT);
 
             match = piece_match(num_available, num_to_find, num_opponents, occurs);
         }
@@ -482,18 +545,25 @@ piece_set_match(const Material_details *details_to_find,
  * as a bug.
  */
 static Boolean
-material_match(Material_details *details_to_find, int num_pieces[2][NUM_PIECE_VALUES],
+material_match(Material_details *details_to_find, MaterialSignature material,
                Colour game_colour)
 {
     Boolean match = TRUE;
     Colour piece_set_colour = WHITE;
 
-    match = piece_set_match(details_to_find, num_pieces, game_colour,
-            piece_set_colour);
+    /* A quick rejection of material outside the bounds of details_to_find. */
+    if (!MATERIAL_WITHIN(material, details_to_find->lower[game_colour],
+                         details_to_find->upper[game_colour])) {
+        match = FALSE;
+    }
+    else {
+        match = piece_set_match(details_to_find, material, game_colour,
+                piece_set_colour);
+    }
     if (match) {
         game_colour = OPPOSITE_COLOUR(game_colour);
         piece_set_colour = OPPOSITE_COLOUR(piece_set_colour);
-        match = piece_set_match(details_to_find, num_pieces, game_colour,
+        match = piece_set_match(details_to_find, material, game_colour,
                 piece_set_colour);
         /* Reset colour to its original value. */
         game_colour = OPPOSITE_COLOUR(game_colour);
@@ -516,27 +586,93 @@ material_match(Material_details *details_to_find, int num_pieces[2][NUM_PIECE_VA
     return match;
 }
 
-/* Extract the numbers of each type of piece from the given board. */
-void extract_pieces_from_board(int num_pieces[2][NUM_PIECE_VALUES], const Board *board)
+/* Return the material signature of the given board.
+ * Counts beyond MATERIAL_MAX_COUNT are held there.
+ */
+MaterialSignature
+board_material_signature(const Board *board)
 {
-    /* Set up num_pieces from the board. */
-    for(int c = 0; c < 2; c++) {
-        for(int p = 0; p < NUM_PIECE_VALUES; p++) {
-            num_pieces[c][p] = 0;
-        }
-    }
+    MaterialSignature signature = 0;
     for(char rank = FIRSTRANK; rank <= LASTRANK; rank++) {
         for(char col = FIRSTCOL; col <= LASTCOL; col++) {
-            int r = RankConvert(rank);
-            int c = ColConvert(col);
-
-            Piece coloured_piece = board->board[r][c];
+            Piece coloured_piece = board->board[RankConvert(rank)][ColConvert(col)];
             if(coloured_piece != EMPTY) {
-                int p = EXTRACT_PIECE(coloured_piece);
-                num_pieces[EXTRACT_COLOUR(coloured_piece)][p]++;
+                Colour colour = EXTRACT_COLOUR(coloured_piece);
+                Piece piece = EXTRACT_PIECE(coloured_piece);
+                /* Guard against an impossible position. */
+                if(MATERIAL_COUNT(signature, colour, piece) < MATERIAL_MAX_COUNT) {
+                    signature += MATERIAL_UNIT(colour, piece);
+                }
             }
         }
     }
+    return signature;
+}
+
+/* Return the signature whose counts are the smaller (if smaller is TRUE)
+ * or larger of those of a and b.
+ */
+MaterialSignature
+material_signature_bound(MaterialSignature a, MaterialSignature b, Boolean smaller)
+{
+    MaterialSignature bound = 0;
+    for(int field = 0; field < 64; field += MATERIAL_FIELD_BITS) {
+        MaterialSignature a_count = (a >> field) & MATERIAL_MAX_COUNT;
+        MaterialSignature b_count = (b >> field) & MATERIAL_MAX_COUNT;
+        if((a_count < b_count) == smaller) {
+            bound |= a_count << field;
+        }
+        else {
+            bound |= b_count << field;
+        }
+    }
+    return bound;
+}
+
+/* Whether a position whose counts are at least those of lower could
+ * still arise from one with the given material.
+ * Pieces are only ever lost, except that a pawn may be promoted.
+ * The true counts of a saturated signature are not known.
+ */
+Boolean
+material_reachable(MaterialSignature material, MaterialSignature lower)
+{
+    Boolean reachable = TRUE;
+    if(MATERIAL_SATURATED(material)) {
+        return TRUE;
+    }
+    for(Colour colour = BLACK; colour <= WHITE && reachable; colour++) {
+        int spare_pawns = MATERIAL_COUNT(material, colour, PAWN) -
+                          MATERIAL_COUNT(lower, colour, PAWN);
+        for(Piece piece = KNIGHT; piece < KING && spare_pawns >= 0; piece++) {
+            int shortfall = MATERIAL_COUNT(lower, colour, piece) -
+                            MATERIAL_COUNT(material, colour, piece);
+            if(shortfall > 0) {
+                /* Only promotions can make up the shortfall. */
+                spare_pawns -= shortfall;
+            }
+        }
+        reachable = spare_pawns >= 0;
+    }
+    return reachable;
+}
+
+/* Could any of the endings to be matched arise from
+ * a position with the given material?
+ */
+static Boolean
+ending_reachable(MaterialSignature material)
+{
+    Material_details *details;
+
+    for (details = endings_to_match; details != NULL; details = details->next) {
+        if (material_reachable(material, details->lower[WHITE]) ||
+                (details->both_colours &&
+                 material_reachable(material, details->lower[BLACK]))) {
+            return TRUE;
+        }
+    }
+    return FALSE;
 }
 
 /* Check to see whether the given moves lead to a position
@@ -551,20 +687,8 @@ look_for_material_match(Game *game_details)
     Boolean match_comment_added = FALSE;
     Move *next_move = game_details->moves;
     Move *move_for_comment = NULL;
-    Colour colour = WHITE;
-    /* The initial game position has the full set of piece details. */
-    int num_pieces[2][NUM_PIECE_VALUES] = {
-        /* Dummies for OFF and EMPTY at the start. */
-        /*     P  N  B  R  Q  K */
-        {0, 0, 8, 2, 2, 2, 1, 1},
-        {0, 0, 8, 2, 2, 2, 1, 1}
-    };
     Board *board = new_game_board(game_details->tags[FEN_TAG]);
 
-    if(game_details->tags[FEN_TAG] != NULL) {
-        extract_pieces_from_board(num_pieces, board);
-        colour = board->to_move;
-    }
     /* Ensure that all previous match indications are cleared. */
     reset_match_depths(endings_to_match);
 
@@ -573,7 +697,11 @@ look_for_material_match(Game *game_details)
      * a match.
      */
     Boolean matches = FALSE;
-    Boolean end_of_game = FALSE;
+    /* Material is only ever lost, so stop once none of the
+     * endings can be reached.
+     */
+    MaterialSignature material = board->material_signature;
+    Boolean end_of_game = !ending_reachable(material);
     Boolean white_matches = FALSE, black_matches = FALSE;
     while (game_ok && !matches && !end_of_game) {
         for (Material_details *details_to_find = endings_to_match; !matches && (details_to_find != NULL);
@@ -584,9 +712,11 @@ look_for_material_match(Game *game_details)
              * then we might miss a match because a full match takes several
              * separate individual match steps.
              */
-            white_matches = material_match(details_to_find, num_pieces, WHITE);
+            white_matches = material_match(details_to_find,
+                    board->material_signature, WHITE);
             if(details_to_find->both_colours) {
-                black_matches = material_match(details_to_find, num_pieces, BLACK);
+                black_matches = material_match(details_to_find,
+                    board->material_signature, BLACK);
             }
             else {
                 black_matches = FALSE;
@@ -623,18 +753,15 @@ look_for_material_match(Game *game_details)
         else if (*(next_move->move) != '\0') {
             /* Try the next position. */
             if (apply_move(next_move, board)) {
-                /* Remove any captured pieces. */
-                if (next_move->captured_piece != EMPTY) {
-                    num_pieces[OPPOSITE_COLOUR(colour)][next_move->captured_piece]--;
-                }
-                if (next_move->promoted_piece != EMPTY) {
-                    num_pieces[colour][next_move->promoted_piece]++;
-                    /* Remove the promoting pawn. */
-                    num_pieces[colour][PAWN]--;
+                /* The board's material is kept up to date by
+                 * captures and promotions.
+                 */
+                if (board->material_signature != material) {
+                    material = board->material_signature;
+                    end_of_game = !ending_reachable(material);
                 }
 
                 move_for_comment = next_move;
-                colour = OPPOSITE_COLOUR(colour);
                 next_move = next_move->next;
             }
             else {
@@ -689,13 +816,13 @@ constraint_material_match(Material_details *details_to_find, const Board *board)
     details_to_find->match_depth[0] = 0;
     details_to_find->match_depth[1] = 0;
 
-    int num_pieces[2][NUM_PIECE_VALUES];
-    extract_pieces_from_board(num_pieces, board);
-    Boolean white_matches = material_match(details_to_find, num_pieces, WHITE);
+    Boolean white_matches = material_match(details_to_find,
+                    board->material_signature, WHITE);
     Boolean black_matches;
 
     if(details_to_find->both_colours) {
-        black_matches = material_match(details_to_find, num_pieces, BLACK);
+        black_matches = material_match(details_to_find,
+                    board->material_signature, BLACK);
     }
     else {
         black_matches = FALSE;
@@ -722,6 +849,7 @@ process_material_description(const char *line, Boolean both_colours, Boolean pat
         details = new_ending_details(both_colours);
 
         if (decompose_line(line, details)) {
+            set_material_bounds(details);
             if(!pattern_constraint) {
                 /* Add it on to the list. */
                 details->next = endings_to_match;
@@ -764,14 +892,14 @@ build_endings(const char *infile, Boolean both_colours)
 Boolean
 insufficient_material(const Board *board)
 {
-    int num_pieces[2][NUM_PIECE_VALUES] = {
-        /* Dummies for OFF and EMPTY at the start. */
-        /*     P  N  B  R  Q  K */
-        {0, 0, 8, 2, 2, 2, 1, 1},
-        {0, 0, 8, 2, 2, 2, 1, 1}
-    };
-
-    extract_pieces_from_board(num_pieces, board);
+    int num_pieces[2][NUM_PIECE_VALUES];
+
+    for(Colour colour = BLACK; colour <= WHITE; colour++) {
+        for(Piece piece = PAWN; piece <= KING; piece++) {
+            num_pieces[colour][piece] =
+                MATERIAL_COUNT(board->material_signature, colour, piece);
+        }
+    }
 
     if(num_pieces[0][PAWN] != 0 || num_pieces[1][PAWN] != 0) {
         return FALSE;
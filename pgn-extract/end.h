@@ -53,6 +53,10 @@ typedef struct material_details {
      * success. A full match is only returned when match_depth == move_depth.
      */
     unsigned match_depth[2];
+    /* Bounds on the material of a matching position, indexed
+     * by the game colour matched against the first set of pieces.
+     */
+    MaterialSignature lower[2], upper[2];
     struct material_details *next;
 } Material_details;
 
@@ -61,12 +65,14 @@ typedef struct material_details {
  */
 #define MATERIAL_CONSTRAINT ':'
 
+MaterialSignature board_material_signature(const Board *board);
 Boolean build_endings(const char *infile, Boolean both_colours);
 Boolean check_for_material_match(Game *game);
 Boolean constraint_material_match(Material_details *details_to_find, const Board *board);
-void extract_pieces_from_board(int num_pieces[2][NUM_PIECE_VALUES], const Board *board);
 Boolean insufficient_material(const Board *board);
 Material_details *process_material_description(const char *line, Boolean both_colours, Boolean pattern_constraint);
+MaterialSignature material_signature_bound(MaterialSignature a, MaterialSignature b, Boolean smaller);
+Boolean material_reachable(MaterialSignature material, MaterialSignature lower);
 
 #endif	// END_H
 
@@ -0,0 +1,111 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+/* The interface between pgn-extract and a shared library of
+ * position evaluation (--evalplugin).
+ * This header is self-contained so that it can be copied into
+ * the source of a plugin that is built separately from pgn-extract.
+ *
+ * A plugin exports a single function, named by EVAL_PLUGIN_ENTRY,
+ * that returns a description of the plugin.  pgn-extract collects the
+ * positions of a game and passes them to the plugin's evaluate
+ * function in batches of up to EVAL_PLUGIN_BATCH_SIZE.
+ */
+
+#ifndef EVALPLUGIN_H
+#define EVALPLUGIN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Increment when the layout of any of the structures changes. */
+#define EVAL_PLUGIN_ABI_VERSION 1
+/* The name of the function exported by a plugin. */
+#define EVAL_PLUGIN_ENTRY "pgn_extract_evaluator"
+/* The maximum number of positions passed in a single call. */
+#define EVAL_PLUGIN_BATCH_SIZE 1024
+
+/* Indices of the bitboards in EvalPosition.pieces. */
+enum {
+    EVAL_WHITE_PAWN, EVAL_WHITE_KNIGHT, EVAL_WHITE_BISHOP,
+    EVAL_WHITE_ROOK, EVAL_WHITE_QUEEN, EVAL_WHITE_KING,
+    EVAL_BLACK_PAWN, EVAL_BLACK_KNIGHT, EVAL_BLACK_BISHOP,
+    EVAL_BLACK_ROOK, EVAL_BLACK_QUEEN, EVAL_BLACK_KING,
+    EVAL_NUM_BITBOARDS
+};
+
+/* Values for EvalPosition.to_move. */
+#define EVAL_WHITE_TO_MOVE 0
+#define EVAL_BLACK_TO_MOVE 1
+
+/* Bits of EvalPosition.castling. */
+#define EVAL_WHITE_KINGSIDE  0x01
+#define EVAL_WHITE_QUEENSIDE 0x02
+#define EVAL_BLACK_KINGSIDE  0x04
+#define EVAL_BLACK_QUEENSIDE 0x08
+
+/* A position to be evaluated.
+ * Squares are numbered from a1 (0) to h8 (63), rank by rank.
+ */
+typedef struct {
+    uint64_t pieces[EVAL_NUM_BITBOARDS];
+    uint8_t to_move;
+    uint8_t castling;
+    /* The en-passant target square, or -1 if there is none. */
+    int8_t ep_square;
+    /* The half-move clock, saturated at 255. */
+    uint8_t halfmove_clock;
+} EvalPosition;
+
+/* Services that pgn-extract offers to a plugin. */
+typedef struct {
+    unsigned abi_version;
+    /* The number of legal moves available to colour
+     * (EVAL_WHITE_TO_MOVE or EVAL_BLACK_TO_MOVE) in position.
+     */
+    unsigned (*count_moves)(const EvalPosition *position, int colour);
+} EvalHost;
+
+/* The description of a plugin returned from its entry point. */
+typedef struct {
+    /* Must be EVAL_PLUGIN_ABI_VERSION. */
+    unsigned abi_version;
+    /* A name for use in diagnostics. */
+    const char *name;
+    /* Prepare the plugin for use.
+     * The returned handle is passed to evaluate and close.
+     * Return NULL on failure.
+     */
+    void *(*open)(const EvalHost *host);
+    /* Write into scores[i] an evaluation of positions[i], for
+     * 0 <= i < count, in pawns from White's point of view.
+     * Return 0 on success, non-zero on failure.
+     */
+    int (*evaluate)(void *handle, const EvalPosition *positions,
+                    size_t count, double *scores);
+    /* Release the resources associated with handle. */
+    void (*close)(void *handle);
+} EvalPlugin;
+
+/* The type of the function named by EVAL_PLUGIN_ENTRY. */
+typedef const EvalPlugin *(*EvalPluginEntry)(void);
+
+#endif	// EVALPLUGIN_H
@@ -0,0 +1,115 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+/* A reference evaluation plugin for pgn-extract (--evalplugin).
+ * It reproduces the built-in evaluation: a simplified version of
+ * Shannon's, in which the value of each side is the weighted sum
+ * of its pieces plus 0.1 times the number of moves available to it.
+ * The mobility counts are obtained from pgn-extract's move generator
+ * via the host services.
+ *
+ * Build with:
+ *     gcc -shared -fPIC -o evalshannon.so evalshannon.c
+ */
+
+#include <stdlib.h>
+#include "evalplugin.h"
+
+/* The weight of each of the pieces in a colour's bitboards. */
+static const int piece_values[EVAL_NUM_BITBOARDS / 2] = {
+    1, 3, 3, 5, 9, 0
+};
+
+static void *shannon_open(const EvalHost *host);
+static int shannon_evaluate(void *handle, const EvalPosition *positions,
+                            size_t count, double *scores);
+static void shannon_close(void *handle);
+const EvalPlugin *pgn_extract_evaluator(void);
+
+static const EvalPlugin shannon_plugin = {
+    EVAL_PLUGIN_ABI_VERSION,
+    "shannon",
+    shannon_open,
+    shannon_evaluate,
+    shannon_close,
+};
+
+/* The plugin's entry point. */
+const EvalPlugin *
+pgn_extract_evaluator(void)
+{
+    return &shannon_plugin;
+}
+
+static unsigned
+popcount(uint64_t bitboard)
+{
+    unsigned count = 0;
+
+    while (bitboard != 0) {
+        bitboard &= bitboard - 1;
+        count++;
+    }
+    return count;
+}
+
+/* The handle is simply the host's services. */
+static void *
+shannon_open(const EvalHost *host)
+{
+    if (host == NULL || host->abi_version != EVAL_PLUGIN_ABI_VERSION) {
+        return NULL;
+    }
+    return (void *) host;
+}
+
+static int
+shannon_evaluate(void *handle, const EvalPosition *positions,
+                 size_t count, double *scores)
+{
+    const EvalHost *host = (const EvalHost *) handle;
+    size_t ix;
+
+    for (ix = 0; ix < count; ix++) {
+        const EvalPosition *position = &positions[ix];
+        int white_material = 0, black_material = 0;
+        int white_moves, black_moves;
+        int p;
+
+        for (p = 0; p < EVAL_NUM_BITBOARDS / 2; p++) {
+            white_material += piece_values[p] *
+                    popcount(position->pieces[EVAL_WHITE_PAWN + p]);
+            black_material += piece_values[p] *
+                    popcount(position->pieces[EVAL_BLACK_PAWN + p]);
+        }
+        white_moves = (*host->count_moves)(position, EVAL_WHITE_TO_MOVE);
+        black_moves = (*host->count_moves)(position, EVAL_BLACK_TO_MOVE);
+        scores[ix] = (white_material - black_material) +
+                (white_moves - black_moves) * 0.1;
+    }
+    return 0;
+}
+
+static void
+shannon_close(void *handle)
+{
+    (void) handle;
+}
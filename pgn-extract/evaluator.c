@@ -0,0 +1,189 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dlfcn.h>
+#include "bool.h"
+#include "mymalloc.h"
+#include "defs.h"
+#include "typedef.h"
+#include "apply.h"
+#include "map.h"
+#include "bitboard.h"
+#include "evalplugin.h"
+#include "evaluator.h"
+
+static unsigned count_moves(const EvalPosition *position, int colour);
+
+/* The services offered to the plugin. */
+static const EvalHost host = {
+    EVAL_PLUGIN_ABI_VERSION,
+    count_moves,
+};
+
+/* The loaded library, its description and the handle
+ * returned from its open function.
+ */
+static void *library = NULL;
+static const EvalPlugin *plugin = NULL;
+static void *plugin_handle = NULL;
+
+/* Positions waiting to be evaluated, and the moves
+ * whose evaluation field is to receive the result.
+ */
+static EvalPosition *pending_positions = NULL;
+static Move **pending_moves = NULL;
+static double *scores = NULL;
+static size_t num_pending = 0;
+
+/* Load the evaluation plugin in filename.
+ * Any failure is fatal.
+ */
+void
+load_evaluator(const char *filename)
+{
+    EvalPluginEntry entry;
+
+    library = dlopen(filename, RTLD_NOW | RTLD_LOCAL);
+    if (library == NULL) {
+        fprintf(GlobalState.logfile, "Unable to load evaluation plugin %s: %s\n",
+                filename, dlerror());
+        exit(1);
+    }
+    /* Conversion via a union avoids the object-to-function pointer
+     * warning from -pedantic.
+     */
+    {
+        union {
+            void *object;
+            EvalPluginEntry function;
+        } symbol;
+        symbol.object = dlsym(library, EVAL_PLUGIN_ENTRY);
+        entry = symbol.function;
+    }
+    if (entry == NULL) {
+        fprintf(GlobalState.logfile, "%s does not define %s.\n",
+                filename, EVAL_PLUGIN_ENTRY);
+        exit(1);
+    }
+    plugin = (*entry)();
+    if (plugin == NULL || plugin->abi_version != EVAL_PLUGIN_ABI_VERSION) {
+        fprintf(GlobalState.logfile,
+                "Evaluation plugin %s does not support interface version %d.\n",
+                filename, EVAL_PLUGIN_ABI_VERSION);
+        exit(1);
+    }
+    plugin_handle = (*plugin->open)(&host);
+    if (plugin_handle == NULL) {
+        fprintf(GlobalState.logfile, "Failed to initialise evaluation plugin %s.\n",
+                plugin->name != NULL ? plugin->name : filename);
+        exit(1);
+    }
+    pending_positions = (EvalPosition *)
+            malloc_or_die(EVAL_PLUGIN_BATCH_SIZE * sizeof (*pending_positions));
+    pending_moves = (Move **)
+            malloc_or_die(EVAL_PLUGIN_BATCH_SIZE * sizeof (*pending_moves));
+    scores = (double *) malloc_or_die(EVAL_PLUGIN_BATCH_SIZE * sizeof (*scores));
+}
+
+/* Save the position on board for evaluation.
+ * The result will be stored in move_details->evaluation
+ * when the queue is next flushed.
+ */
+void
+queue_evaluation(Move *move_details, const Board *board)
+{
+    EvalPosition *position;
+
+    if (num_pending == EVAL_PLUGIN_BATCH_SIZE) {
+        flush_evaluations();
+    }
+    position = &pending_positions[num_pending];
+    board_to_bitboards(board, position->pieces);
+    position->to_move = board->to_move == WHITE ?
+            EVAL_WHITE_TO_MOVE : EVAL_BLACK_TO_MOVE;
+    position->castling = board_castling_rights(board);
+    position->ep_square = board_ep_square(board);
+    position->halfmove_clock = board->halfmove_clock > 255 ?
+            255 : board->halfmove_clock;
+    pending_moves[num_pending] = move_details;
+    num_pending++;
+}
+
+/* Evaluate all of the queued positions. */
+void
+flush_evaluations(void)
+{
+    if (num_pending > 0) {
+        size_t ix;
+
+        if ((*plugin->evaluate)(plugin_handle, pending_positions,
+                num_pending, scores) != 0) {
+            fprintf(GlobalState.logfile, "Evaluation plugin %s failed.\n",
+                    plugin->name != NULL ? plugin->name : "");
+            exit(1);
+        }
+        for (ix = 0; ix < num_pending; ix++) {
+            pending_moves[ix]->evaluation = scores[ix];
+        }
+        num_pending = 0;
+    }
+}
+
+/* Release the plugin. */
+void
+close_evaluator(void)
+{
+    if (library != NULL) {
+        flush_evaluations();
+        (*plugin->close)(plugin_handle);
+        (void) dlclose(library);
+        library = NULL;
+        plugin = NULL;
+        (void) free((void *) pending_positions);
+        (void) free((void *) pending_moves);
+        (void) free((void *) scores);
+    }
+}
+
+/* Host service: count the moves available to colour in position. */
+static unsigned
+count_moves(const EvalPosition *position, int colour)
+{
+    unsigned count = 0;
+    Board *board = new_bitboard_board(position->pieces,
+            position->to_move == EVAL_WHITE_TO_MOVE ? WHITE : BLACK,
+            position->castling, position->ep_square);
+
+    if (board != NULL) {
+        MovePair *moves = find_all_moves(board,
+                colour == EVAL_WHITE_TO_MOVE ? WHITE : BLACK);
+        MovePair *m;
+        for (m = moves; m != NULL; m = m->next) {
+            count++;
+        }
+        free_move_pair_list(moves);
+        free_board(board);
+    }
+    return count;
+}
@@ -0,0 +1,34 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+/* Position evaluation by a shared library loaded at run time
+ * (--evalplugin).  See evalplugin.h for the plugin interface.
+ */
+
+#ifndef EVALUATOR_H
+#define EVALUATOR_H
+
+void load_evaluator(const char *filename);
+void queue_evaluation(Move *move_details, const Board *board);
+void flush_evaluations(void);
+void close_evaluator(void);
+
+#endif	// EVALUATOR_H
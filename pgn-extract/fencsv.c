@@ -0,0 +1,428 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+/* Batch conversion of evaluated positions (--fencsv); see fencsv.h.
+ * The positions are independent of each other, so a regular input
+ * file is split at row boundaries into --jobs ranges that are
+ * converted by separate processes; see linejobs.h.
+ * With --split, a position is written to the split file rather than
+ * the output according to a hash of the position, so that the same
+ * position never appears in both.
+ * With --augment, the colour-flipped and mirrored forms of each
+ * position follow it, in the same file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "bool.h"
+#include "mymalloc.h"
+#include "defs.h"
+#include "typedef.h"
+#include "tokens.h"
+#include "taglist.h"
+#include "apply.h"
+#include "lex.h"
+#include "bitboard.h"
+#include "packed.h"
+#include "see.h"
+#include "linejobs.h"
+#include "fencsv.h"
+
+/* The fields of an input row. */
+enum { FEN_FIELD, DEPTH_FIELD, SCORE_FIELD, PV_FIELD, MAX_FIELDS };
+
+/* Space for a FEN string with the move counters added. */
+#define FEN_SPACE 128
+/* Space for the text of a score. */
+#define SCORE_SPACE 32
+
+typedef struct {
+    const char *text;
+    size_t length;
+} Field;
+
+typedef struct {
+    unsigned long converted;
+    unsigned long rejected;
+    /* How many of those converted were written to the split file. */
+    unsigned long split;
+    /* The number of records added by --augment. */
+    unsigned long augmented;
+    /* The number of tactical positions dropped by --quietpositions. */
+    unsigned long filtered;
+} ConversionCounts;
+
+static void
+report_rejected_row(const char *row, size_t length, const char *reason)
+{
+    fprintf(GlobalState.logfile, "Skipping row %.*s: %s.\n",
+            (int) length, row, reason);
+}
+
+/* Split row into at most MAX_FIELDS comma-separated fields.
+ * Return the number of fields, or MAX_FIELDS + 1 if there are too many.
+ */
+static unsigned
+split_row(const char *row, size_t length, Field fields[MAX_FIELDS])
+{
+    unsigned num_fields = 0;
+    const char *field_start = row;
+    const char *end = row + length;
+    Boolean more = TRUE;
+
+    while (more) {
+        const char *comma = memchr(field_start, ',', end - field_start);
+        const char *field_end = comma != NULL ? comma : end;
+
+        if (num_fields == MAX_FIELDS) {
+            return MAX_FIELDS + 1;
+        }
+        fields[num_fields].text = field_start;
+        fields[num_fields].length = field_end - field_start;
+        num_fields++;
+        if (comma != NULL) {
+            field_start = comma + 1;
+        }
+        else {
+            more = FALSE;
+        }
+    }
+    return num_fields;
+}
+
+/* Extract the move codes of the first pv_depth moves of pv into moves,
+ * padding with null moves.
+ * Return FALSE if a move is malformed.
+ */
+static Boolean
+extract_pv(const Field *pv, unsigned pv_depth, uint16_t moves[])
+{
+    const char *text = pv->text;
+    const char *end = pv->text + pv->length;
+    unsigned num_moves = 0;
+
+    while (num_moves < pv_depth && text < end) {
+        const char *space = memchr(text, ' ', end - text);
+        const char *move_end = space != NULL ? space : end;
+
+        if (move_end > text) {
+            int code = uci_move_code(text, move_end - text);
+            if (code < 0) {
+                return FALSE;
+            }
+            moves[num_moves] = code;
+            num_moves++;
+        }
+        text = move_end + 1;
+    }
+    while (num_moves < pv_depth) {
+        moves[num_moves] = 0;
+        num_moves++;
+    }
+    return TRUE;
+}
+
+/* Write record as a row of bitboards, with the depth and score of
+ * the input row, the score negated if negate_score is TRUE.
+ */
+static void
+output_bitboard_row(const PackedRecord *record, const Field *depth,
+                    const Field *score, Boolean negate_score, FILE *outfp)
+{
+    const char *score_text = score->text;
+    size_t score_length = score->length;
+    const char *sign = "";
+    char bits[64];
+    unsigned i;
+
+    for (i = 0; i < PACKED_NUM_BITBOARDS; i++) {
+        uint64_t bitboard = record->pieces[i];
+        int bit;
+
+        /* Most significant bit first. */
+        for (bit = 63; bit >= 0; bit--) {
+            bits[63 - bit] = (bitboard >> bit) & 1 ? '1' : '0';
+        }
+        fwrite(bits, 1, sizeof(bits), outfp);
+        putc(',', outfp);
+    }
+    if (negate_score && strtod(score_text, NULL) != 0.0) {
+        if (*score_text == '-' || *score_text == '+') {
+            sign = *score_text == '-' ? "" : "-";
+            score_text++;
+            score_length--;
+        }
+        else {
+            sign = "-";
+        }
+    }
+    fprintf(outfp, "%d,%d,%d,%.*s,%s%.*s",
+            record->side_to_move, record->castling, record->ep_square,
+            (int) depth->length, depth->text,
+            sign, (int) score_length, score_text);
+    for (i = 0; i < GlobalState.pv_depth; i++) {
+        fprintf(outfp, ",%u", (unsigned) record->pv[i]);
+    }
+    putc('\n', outfp);
+}
+
+/* Convert a single row of length bytes, excluding any line terminator,
+ * to outfp, or to splitfp if the position belongs in the split.
+ */
+static void
+convert_row(const char *row, size_t length, FILE *outfp, FILE *splitfp,
+            ConversionCounts *counts)
+{
+    Field fields[MAX_FIELDS];
+    unsigned num_fields;
+    char fen[FEN_SPACE];
+    char score_text[SCORE_SPACE];
+    unsigned spaces = 0;
+    size_t i;
+    double score;
+    char *score_end;
+    PackedRecord record;
+    PackedRecord variants[PACKED_MAX_VARIANTS];
+    unsigned num_variants, v;
+    Board *board;
+
+    if (length == 0) {
+        return;
+    }
+    num_fields = split_row(row, length, fields);
+    if (fields[FEN_FIELD].length == 3 &&
+            strncmp(fields[FEN_FIELD].text, "fen", 3) == 0) {
+        /* A header. */
+        return;
+    }
+    if (num_fields < PV_FIELD || num_fields > MAX_FIELDS) {
+        report_rejected_row(row, length, "expected fen,depth,score[,pv]");
+        counts->rejected++;
+        return;
+    }
+
+    /* Complete a four-field (EPD-style) FEN with the move counters
+     * required by new_fen_board.
+     */
+    if (fields[FEN_FIELD].length + 5 > sizeof(fen)) {
+        report_rejected_row(row, length, "the FEN is too long");
+        counts->rejected++;
+        return;
+    }
+    memcpy(fen, fields[FEN_FIELD].text, fields[FEN_FIELD].length);
+    fen[fields[FEN_FIELD].length] = '\0';
+    for (i = 0; i < fields[FEN_FIELD].length; i++) {
+        if (fen[i] == ' ') {
+            spaces++;
+        }
+    }
+    if (spaces == 3) {
+        strcat(fen, " 0 1");
+    }
+
+    if (fields[SCORE_FIELD].length == 0 ||
+            fields[SCORE_FIELD].length >= sizeof(score_text)) {
+        report_rejected_row(row, length, "invalid score");
+        counts->rejected++;
+        return;
+    }
+    memcpy(score_text, fields[SCORE_FIELD].text, fields[SCORE_FIELD].length);
+    score_text[fields[SCORE_FIELD].length] = '\0';
+    score = strtod(score_text, &score_end);
+    if (*score_end != '\0') {
+        report_rejected_row(row, length, "invalid score");
+        counts->rejected++;
+        return;
+    }
+
+    if (GlobalState.pv_depth > 0) {
+        static const Field no_pv = { "", 0 };
+        const Field *pv = num_fields > PV_FIELD ? &fields[PV_FIELD] : &no_pv;
+
+        if (!extract_pv(pv, GlobalState.pv_depth, record.pv)) {
+            report_rejected_row(row, length, "invalid principal variation");
+            counts->rejected++;
+            return;
+        }
+    }
+
+    board = new_fen_board(fen);
+    if (board == NULL) {
+        report_rejected_row(row, length, "invalid FEN");
+        counts->rejected++;
+        return;
+    }
+    board_to_bitboards(board, record.pieces);
+    record.side_to_move = board->to_move == WHITE ? 0 : 1;
+    record.castling = board_castling_rights(board);
+    record.ep_square = board_ep_square(board);
+    free_board(board);
+
+    if (GlobalState.quiet_positions_only &&
+            !quiet_position(record.pieces, record.side_to_move, record.ep_square)) {
+        counts->filtered++;
+        return;
+    }
+    if (splitfp != NULL &&
+            split_fraction(packed_position_key(&record),
+                           GlobalState.split_seed) < GlobalState.split_ratio) {
+        outfp = splitfp;
+        counts->split++;
+    }
+    record.score = double_to_half(score / 100.0);
+    num_variants = augment_packed_record(&record, GlobalState.pv_depth,
+                                         GlobalState.augment, variants);
+    for (v = 0; v < num_variants; v++) {
+        if (GlobalState.output_format == PACKED) {
+            unsigned char bytes[PACKED_RECORD_SIZE + 2 * PACKED_MAX_PV_DEPTH];
+
+            encode_packed_record(&variants[v], GlobalState.pv_depth, bytes);
+            fwrite(bytes, 1, packed_record_size(GlobalState.pv_depth), outfp);
+        }
+        else {
+            /* The side to move changes when the colours are flipped. */
+            output_bitboard_row(&variants[v], &fields[DEPTH_FIELD], &fields[SCORE_FIELD],
+                                variants[v].side_to_move != record.side_to_move, outfp);
+        }
+    }
+    counts->converted++;
+    counts->augmented += num_variants - 1;
+}
+
+/* Convert a row; outputs are the output and the split file. */
+static Boolean
+convert_line(char *line, size_t length, unsigned long line_number,
+             FILE *outputs[], void *counts)
+{
+    (void) line_number;
+    convert_row(line, length, outputs[0], outputs[1],
+                (ConversionCounts *) counts);
+    return TRUE;
+}
+
+static const LineJob conversion_job = {
+    convert_line, NULL, 2, sizeof(ConversionCounts)
+};
+
+static void
+convert_stream(FILE *fpin, const char *name, ConversionCounts *counts)
+{
+    FILE *outputs[2];
+
+    outputs[0] = GlobalState.outputfile;
+    outputs[1] = GlobalState.split_file;
+    if (!process_line_range(fpin, 0, -1, &conversion_job, outputs, counts)) {
+        fprintf(GlobalState.logfile, "Error reading %s.\n", name);
+        exit(1);
+    }
+}
+
+/* Convert filename, of the given size, with GlobalState.num_jobs
+ * worker processes.
+ */
+static void
+convert_file_in_parallel(const char *filename, off_t size,
+                         ConversionCounts *counts)
+{
+    FILE *outputs[2];
+
+    outputs[0] = GlobalState.outputfile;
+    outputs[1] = GlobalState.split_file;
+    if (!process_lines_in_parallel(filename, size, &conversion_job,
+                                   outputs, counts)) {
+        fprintf(GlobalState.logfile, "Failed to convert %s.\n", filename);
+        exit(1);
+    }
+}
+
+/* Convert each of the input files, or standard input if there are none,
+ * to GlobalState.output_format.
+ */
+void
+process_fen_csv_files(void)
+{
+    ConversionCounts counts = { 0, 0, 0, 0, 0 };
+    unsigned file_number;
+    const char *filename;
+
+    if (input_file_name(0) == NULL) {
+        GlobalState.current_input_file = "stdin";
+        convert_stream(stdin, "stdin", &counts);
+    }
+    for (file_number = 0;
+            (filename = input_file_name(file_number)) != NULL; file_number++) {
+        struct stat status;
+
+        GlobalState.current_input_file = filename;
+        if (GlobalState.verbosity > 1) {
+            fprintf(GlobalState.logfile, "Processing %s\n", filename);
+        }
+        if (stat(filename, &status) != 0) {
+            fprintf(GlobalState.logfile, "Unable to open the file: %s\n",
+                    filename);
+            exit(1);
+        }
+        else if (GlobalState.num_jobs > 1 && S_ISREG(status.st_mode)) {
+            convert_file_in_parallel(filename, status.st_size, &counts);
+        }
+        else {
+            FILE *fpin = fopen(filename, "rb");
+
+            if (fpin == NULL) {
+                fprintf(GlobalState.logfile, "Unable to open the file: %s\n",
+                        filename);
+                exit(1);
+            }
+            convert_stream(fpin, filename, &counts);
+            (void) fclose(fpin);
+        }
+    }
+
+    if (fflush(GlobalState.outputfile) != 0 || ferror(GlobalState.outputfile) ||
+            (GlobalState.split_file != NULL &&
+             (fflush(GlobalState.split_file) != 0 ||
+              ferror(GlobalState.split_file)))) {
+        fprintf(GlobalState.logfile, "Error writing the output.\n");
+        exit(1);
+    }
+    if (GlobalState.verbosity > 1) {
+        fprintf(GlobalState.logfile, "%lu position%s converted, %lu rejected.\n",
+                counts.converted, counts.converted == 1 ? "" : "s",
+                counts.rejected);
+        if (GlobalState.quiet_positions_only) {
+            fprintf(GlobalState.logfile, "%lu tactical position%s dropped.\n",
+                    counts.filtered, counts.filtered == 1 ? "" : "s");
+        }
+        if (GlobalState.augment != 0) {
+            fprintf(GlobalState.logfile, "%lu augmented position%s added.\n",
+                    counts.augmented, counts.augmented == 1 ? "" : "s");
+        }
+        if (GlobalState.split_file != NULL) {
+            fprintf(GlobalState.logfile, "%lu written to the split file.\n",
+                    counts.split);
+        }
+    }
+}
@@ -23,6 +23,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdint.h>
 #include "bool.h"
 #include "mymalloc.h"
 #include "defs.h"
@@ -66,9 +67,49 @@ typedef struct FENPatternMatch {
     struct FENPatternMatch *alternative_rank;
     struct FENPatternMatch *next_rank;
     Material_details *constraint;
+    /* For the first of a list of alternatives, the compiled form
+     * of the list, or NULL if it is yet to be compiled.
+     */
+    struct CompiledRank *alternatives;
+    unsigned num_alternatives;
 } FENPatternMatch;
 
+/* A rank pattern without ZERO_OR_MORE_OF_ANYTHING constrains each square
+ * of the rank separately, so it is compiled into the squares on which
+ * each state of a square is excluded: a byte per state, one bit per
+ * column, with the bytes packed into two words in the same way as
+ * those of RankStates.  A rank of the board then matches if none of its
+ * squares is in an excluded state, which is a pair of ANDs.
+ * A list of alternatives is compiled into an array, so that
+ * it is scanned without following its links.
+ */
+#define NUM_SQUARE_STATES 13
+#define EMPTY_STATE 12
+
+typedef struct CompiledRank {
+    /* Whether rank must be interpreted. */
+    Boolean interpreted;
+    uint64_t excluded[2];
+    FENPatternMatch *pattern;
+} CompiledRank;
+
+/* The states of the squares of a rank of the board, and its text for
+ * the interpreter.  Both are built when first needed.
+ */
+typedef struct {
+    Boolean have_states;
+    uint64_t states[2];
+    char text[BOARDSIZE+1];
+} RankStates;
+
 static FENPatternMatch *pattern_tree = NULL;
+/* Whether any of pattern_tree has been compiled. */
+static Boolean tree_compiled = FALSE;
+/* Bounds on the material of a board matching pattern_tree,
+ * valid when tree_bounded.
+ */
+static Boolean tree_bounded = FALSE;
+static MaterialSignature tree_lower, tree_upper;
 
 static Boolean matchhere(const char *regexp, const char *text);
 static Boolean matchstar(const char *regexp, const char *text);
@@ -79,9 +120,10 @@ static void convert_rank_to_text(const Board *board, Rank rank, char *text);
 static const char *reverse_fen_pattern(const char *pattern);
 static void pattern_tree_insert(char **ranks, const char *label, Material_details *constraint);
 static void insert_pattern(FENPatternMatch *node, FENPatternMatch *next);
+static void discard_compiled_ranks(FENPatternMatch *pattern);
 static const char *pattern_match_rank(const Board *board, 
         FENPatternMatch *pattern, int patternIndex, 
-        char ranks[BOARDSIZE+1][BOARDSIZE+1]);
+        RankStates ranks[BOARDSIZE]);
 
 /*
  * Add a FENPattern to be matched. If add_reverse is TRUE then
@@ -283,6 +325,8 @@ pattern_tree_insert(char **ranks, const char *label, Material_details *constrain
     for(int i = 0; i < BOARDSIZE; i++) {
         next->rank = ranks[i];
         next->alternative_rank = NULL;
+        next->alternatives = NULL;
+        next->num_alternatives = 0;
         if(i != BOARDSIZE - 1) {
             next->next_rank = (FENPatternMatch *) malloc_or_die(sizeof(*match));
             next->optional_label = NULL;
@@ -295,6 +339,12 @@ pattern_tree_insert(char **ranks, const char *label, Material_details *constrain
             next->constraint = constraint;
         }
     }
+    if(tree_compiled) {
+        /* Recompile with the new pattern when next needed. */
+        discard_compiled_ranks(pattern_tree);
+        tree_compiled = FALSE;
+    }
+    tree_bounded = FALSE;
     if(pattern_tree == NULL) {
         pattern_tree = match;
     }
@@ -334,6 +384,274 @@ insert_pattern(FENPatternMatch *node, FENPatternMatch *next)
     }
 }
 
+/* Return the state of a square holding coloured_piece:
+ * the index of bitboard.h for a piece, otherwise EMPTY_STATE.
+ */
+static int
+square_state(Piece coloured_piece)
+{
+    if(coloured_piece == EMPTY) {
+        return EMPTY_STATE;
+    }
+    else {
+        return (EXTRACT_COLOUR(coloured_piece) == WHITE ? 0 : 6) +
+                EXTRACT_PIECE(coloured_piece) - PAWN;
+    }
+}
+
+/* Return the text of a square in the given state, as it
+ * appears to the interpreter.
+ */
+static char
+square_state_text(int state)
+{
+    if(state == EMPTY_STATE) {
+        return EMPTY_SQUARE;
+    }
+    else {
+        Colour colour = state < 6 ? WHITE : BLACK;
+        return coloured_piece_to_SAN_letter(MAKE_COLOURED_PIECE(colour, PAWN + state % 6));
+    }
+}
+
+/* Return the set of square states, one bit per state, matched by
+ * the pattern character regchar.
+ */
+static unsigned
+matching_states(char regchar)
+{
+    unsigned states = 0;
+    for(int state = 0; state < NUM_SQUARE_STATES; state++) {
+        if(matchone(regchar, square_state_text(state))) {
+            states |= 1u << state;
+        }
+    }
+    return states;
+}
+
+/* Compile regexp, a rank pattern, into compiled. */
+static void
+compile_rank(const char *regexp, CompiledRank *compiled)
+{
+    int col = 0;
+
+    compiled->interpreted = FALSE;
+    compiled->excluded[0] = compiled->excluded[1] = 0;
+    while(*regexp != '\0' && !compiled->interpreted) {
+        /* The states allowed on the next square(s). */
+        unsigned allowed = 0;
+        /* The number of squares to which they apply. */
+        int squares = 1;
+
+        if(*regexp == ZERO_OR_MORE_OF_ANYTHING) {
+            compiled->interpreted = TRUE;
+        }
+        else if(*regexp >= '1' && *regexp <= '8') {
+            allowed = 1u << EMPTY_STATE;
+            squares = *regexp - '0';
+            regexp++;
+        }
+        else if(*regexp == CCL_START) {
+            Boolean negated = regexp[1] == NCCL;
+            regexp += negated ? 2 : 1;
+            while(*regexp != CCL_END && *regexp != '\0') {
+                allowed |= matching_states(*regexp);
+                regexp++;
+            }
+            if(*regexp == '\0') {
+                /* Unterminated. */
+                compiled->interpreted = TRUE;
+            }
+            else {
+                regexp++;
+            }
+            if(negated) {
+                allowed = ~allowed & ((1u << NUM_SQUARE_STATES) - 1);
+            }
+        }
+        else {
+            allowed = matching_states(*regexp);
+            regexp++;
+        }
+        for(; squares > 0; squares--) {
+            if(col < BOARDSIZE) {
+                for(int state = 0; state < NUM_SQUARE_STATES; state++) {
+                    if((allowed & (1u << state)) == 0) {
+                        compiled->excluded[state / 8] |=
+                                (uint64_t) 1 << ((state % 8) * BOARDSIZE + col);
+                    }
+                }
+            }
+            col++;
+        }
+    }
+    if(col != BOARDSIZE) {
+        /* The rank can never match. */
+        compiled->excluded[0] = compiled->excluded[1] = ~(uint64_t) 0;
+    }
+}
+
+/* Compile the list of alternatives that starts with pattern. */
+static void
+compile_alternatives(FENPatternMatch *pattern)
+{
+    unsigned num_alternatives = 0;
+    FENPatternMatch *alternative;
+
+    for(alternative = pattern; alternative != NULL;
+            alternative = alternative->alternative_rank) {
+        num_alternatives++;
+    }
+    pattern->alternatives = (CompiledRank *)
+            malloc_or_die(num_alternatives * sizeof(*pattern->alternatives));
+    pattern->num_alternatives = num_alternatives;
+    num_alternatives = 0;
+    for(alternative = pattern; alternative != NULL;
+            alternative = alternative->alternative_rank) {
+        CompiledRank *compiled = &pattern->alternatives[num_alternatives];
+        compile_rank(alternative->rank, compiled);
+        compiled->pattern = alternative;
+        num_alternatives++;
+    }
+    tree_compiled = TRUE;
+}
+
+/* Discard the compiled forms of the tree rooted at pattern. */
+static void
+discard_compiled_ranks(FENPatternMatch *pattern)
+{
+    for(; pattern != NULL; pattern = pattern->alternative_rank) {
+        if(pattern->alternatives != NULL) {
+            free((void *) pattern->alternatives);
+            pattern->alternatives = NULL;
+            pattern->num_alternatives = 0;
+        }
+        discard_compiled_ranks(pattern->next_rank);
+    }
+}
+
+/* Set lower and upper to bounds on the material of a board matching
+ * any of the patterns in the tree rooted at pattern.
+ * The piece states of a square have the same order as the fields
+ * of a MaterialSignature.
+ */
+static void
+pattern_material_bounds(FENPatternMatch *pattern,
+                        MaterialSignature *lower, MaterialSignature *upper)
+{
+    if(pattern->alternatives == NULL) {
+        compile_alternatives(pattern);
+    }
+    for(unsigned i = 0; i < pattern->num_alternatives; i++) {
+        const CompiledRank *compiled = &pattern->alternatives[i];
+        /* The numbers of each piece state on this rank. */
+        int least[EMPTY_STATE] = { 0 }, most[EMPTY_STATE] = { 0 };
+        MaterialSignature rest_lower = 0, rest_upper = 0;
+        MaterialSignature alternative_lower = 0, alternative_upper = 0;
+
+        for(int col = 0; col < BOARDSIZE && !compiled->interpreted; col++) {
+            int num_allowed = 0, allowed_state = EMPTY_STATE;
+            for(int state = 0; state < NUM_SQUARE_STATES; state++) {
+                uint64_t bit = (uint64_t) 1 << ((state % 8) * BOARDSIZE + col);
+                if((compiled->excluded[state / 8] & bit) == 0) {
+                    num_allowed++;
+                    allowed_state = state;
+                    if(state != EMPTY_STATE) {
+                        most[state]++;
+                    }
+                }
+            }
+            if(num_allowed == 1 && allowed_state != EMPTY_STATE) {
+                least[allowed_state]++;
+            }
+        }
+        if(compiled->pattern->next_rank != NULL) {
+            pattern_material_bounds(compiled->pattern->next_rank,
+                                    &rest_lower, &rest_upper);
+        }
+        for(int state = 0; state < EMPTY_STATE; state++) {
+            int field = state * MATERIAL_FIELD_BITS;
+            least[state] += (int) ((rest_lower >> field) & MATERIAL_MAX_COUNT);
+            most[state] += (int) ((rest_upper >> field) & MATERIAL_MAX_COUNT);
+            if(least[state] > MATERIAL_MAX_COUNT) {
+                least[state] = MATERIAL_MAX_COUNT;
+            }
+            if(compiled->interpreted || most[state] > MATERIAL_MAX_COUNT) {
+                most[state] = MATERIAL_MAX_COUNT;
+            }
+            alternative_lower |= (MaterialSignature) least[state] << field;
+            alternative_upper |= (MaterialSignature) most[state] << field;
+        }
+        if(i == 0) {
+            *lower = alternative_lower;
+            *upper = alternative_upper;
+        }
+        else {
+            *lower = material_signature_bound(*lower, alternative_lower, TRUE);
+            *upper = material_signature_bound(*upper, alternative_upper, FALSE);
+        }
+    }
+}
+
+/* Return whether the given rank of board, whose states so far are
+ * in states, matches compiled.
+ */
+static Boolean
+match_rank(const Board *board, Rank rank, const CompiledRank *compiled,
+           RankStates *states)
+{
+    if(!compiled->interpreted) {
+        if(!states->have_states) {
+            const Piece *rankP = board->board[RankConvert(rank)];
+            Col col;
+
+            states->states[0] = states->states[1] = 0;
+            for (col = FIRSTCOL; col <= LASTCOL; col++) {
+                int state = square_state(rankP[ColConvert(col)]);
+                states->states[state / 8] |=
+                        (uint64_t) 1 << ((state % 8) * BOARDSIZE + col - FIRSTCOL);
+            }
+            states->have_states = TRUE;
+        }
+        return ((states->states[0] & compiled->excluded[0]) |
+                (states->states[1] & compiled->excluded[1])) == 0;
+    }
+    else {
+        if(states->text[0] == '\0') {
+            convert_rank_to_text(board, rank, states->text);
+        }
+        return matchhere(compiled->pattern->rank, states->text);
+    }
+}
+
+/* Ensure that tree_lower and tree_upper are set.
+ * Bounding the material compiles the ranks, so this
+ * is left until the first board is matched.
+ */
+static void
+bound_pattern_tree(void)
+{
+    if(!tree_bounded) {
+        pattern_material_bounds(pattern_tree, &tree_lower, &tree_upper);
+        tree_bounded = TRUE;
+    }
+}
+
+/* Could a board matching one of the FEN patterns still arise
+ * from a board with the given material?
+ */
+Boolean
+pattern_match_reachable(MaterialSignature material)
+{
+    if(pattern_tree != NULL) {
+        bound_pattern_tree();
+        return material_reachable(material, tree_lower);
+    }
+    else {
+        return FALSE;
+    }
+}
+
 /*
  * Try to match the board against one of the FEN patterns.
  * Return NULL if no match, otherwise a possible label for the
@@ -345,54 +663,60 @@ pattern_match_board(const Board *board)
 {
     const char *match_label = NULL;
     if(pattern_tree != NULL) {
-        /* Don't convert any ranks of the board until they
-         * are required.
-         */
-        char ranks[BOARDSIZE+1][BOARDSIZE+1];
-        for(int i = 0; i < BOARDSIZE; i++) {
-            ranks[i][0] = '\0';
+        bound_pattern_tree();
+        if(MATERIAL_WITHIN(board->material_signature, tree_lower, tree_upper)) {
+            /* Don't convert any ranks of the board until they
+             * are required.
+             */
+            RankStates ranks[BOARDSIZE];
+            for(int i = 0; i < BOARDSIZE; i++) {
+                ranks[i].have_states = FALSE;
+                ranks[i].text[0] = '\0';
+            }
+            match_label = pattern_match_rank(board, pattern_tree, 0, ranks);
+        }
+        else {
+            /* No pattern can match this material. */
         }
-        match_label = pattern_match_rank(board, pattern_tree, 0, ranks);
     }
     return match_label;
 }
 
 
-/* Match ranks[patternIndex ...] against board.
+/* Match ranks[patternIndex ...] against board, trying pattern and
+ * its alternatives in turn.
  * return the corresponding match label if a match is found.
  * Return NULL if no match is found.
  */
-static const char *pattern_match_rank(const Board *board, FENPatternMatch *pattern, int patternIndex, char ranks[BOARDSIZE+1][BOARDSIZE+1])
+static const char *pattern_match_rank(const Board *board, FENPatternMatch *pattern, int patternIndex, RankStates ranks[BOARDSIZE])
 {
     const char *match_label = NULL;
-    if(ranks[patternIndex][0] == '\0') {
-        /* Convert the required rank.
-         * Convert the others when/if needed.
+    if(pattern->alternatives == NULL) {
+        /* The ranks are compiled once the piece letters
+         * of the output are known.
          */
-        convert_rank_to_text(board, LASTRANK - patternIndex, ranks[patternIndex]);
+        compile_alternatives(pattern);
     }
-    while(match_label == NULL && pattern != NULL) {
-        if(matchhere(pattern->rank, ranks[patternIndex])) {
+    for(unsigned i = 0; match_label == NULL && i < pattern->num_alternatives; i++) {
+        const CompiledRank *compiled = &pattern->alternatives[i];
+        if(match_rank(board, LASTRANK - patternIndex, compiled, &ranks[patternIndex])) {
+            const FENPatternMatch *alternative = compiled->pattern;
             if(patternIndex == BOARDSIZE - 1) {
                 /* The board matches the pattern. */
-                if(pattern->constraint != NULL) {
-                    if(constraint_material_match(pattern->constraint, board)) {
-                        match_label = pattern->optional_label;
+                if(alternative->constraint != NULL) {
+                    if(constraint_material_match(alternative->constraint, board)) {
+                        match_label = alternative->optional_label;
                     }
                 }
                 else {
-                    match_label = pattern->optional_label;
+                    match_label = alternative->optional_label;
                 }
             }
             else {
                 /* Try next rank.*/
-                match_label = pattern_match_rank(board, pattern->next_rank, patternIndex + 1, ranks);
+                match_label = pattern_match_rank(board, alternative->next_rank, patternIndex + 1, ranks);
             }
         }
-        
-        if(match_label == NULL) {
-            pattern = pattern->alternative_rank;
-        }
     }
     return match_label;
 }
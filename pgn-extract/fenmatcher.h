@@ -24,6 +24,7 @@
 
 void add_fen_pattern(const char *fen_pattern, Boolean add_reverse, const char *label);
 const char *pattern_match_board(const Board *board);
+Boolean pattern_match_reachable(MaterialSignature material);
 
 #endif	// FENMATCHER_H
 
@@ -40,6 +40,8 @@
 #include "end.h"
 #include "grammar.h"
 #include "hashing.h"
+#include "checkpoint.h"
+#include "packed.h"
 
 static TokenType current_symbol = NO_TOKEN;
 
@@ -51,6 +53,21 @@ static unsigned RAV_level = 0;
 
 /* How often to report processing rate. */
 static unsigned PROGRESS_RATE = 1000;
+/* How often (in games) to update the --checkpoint file. */
+#define CHECKPOINT_INTERVAL 1000
+
+/* The fields of a --checkpoint file. */
+enum {
+    CK_FILES, CK_FILE, CK_OFFSET, CK_LINE,
+    CK_PROCESSED, CK_MATCHED, CK_NON_MATCHING,
+    CK_OUTPUT, CK_NON_MATCHING_OUTPUT,
+    CK_NUM_FIELDS
+};
+static CheckpointField checkpoint_fields[CK_NUM_FIELDS] = {
+    { "files", 0 }, { "file", 0 }, { "offset", 0 }, { "line", 0 },
+    { "processed", 0 }, { "matched", 0 }, { "nonmatching", 0 },
+    { "output", 0 }, { "nonmatchingoutput", 0 },
+};
 
 /* Retain details of the header of a game.
  * This comprises the Tags and any comment prefixing the
@@ -64,6 +81,8 @@ static struct {
 } GameHeader;
 
 static void parse_opt_game_list(SourceFileType file_type);
+static void save_checkpoint(void);
+static unsigned count_input_files(void);
 static Boolean parse_game(Move **returned_move_list, unsigned long *start_line, unsigned long *end_line);
 Boolean parse_opt_tag_list(void);
 Boolean parse_tag(void);
@@ -83,10 +102,12 @@ static CommentList *append_comment(CommentList *item, CommentList *list);
 static void check_result(char **Tags, const char *terminating_result);
 static Boolean check_for_comments(const Game *game);
 static Boolean check_for_odds(const Game *game);
+static Boolean apply_filters(Game *game, const unsigned *plycount);
 static Boolean chess960_setup(Board *board);
 static void deal_with_ECO_line(Move *move_list);
 static void deal_with_game(Move *move_list, unsigned long start_line, unsigned long end_line);
 static Boolean finished_processing(void);
+static Boolean game_in_split(const Game *game);
 static void free_tags(void);
 static CommentList *merge_comment_lists(CommentList *prefix, CommentList *suffix);
 static void output_game(Game *game,FILE *outputfile);
@@ -276,16 +297,10 @@ check_for_odds(const Game *game)
             /* Compare the piece numbers and types for look for a mismatch. */
             Board *board = new_fen_board(game->tags[FEN_TAG]);
             if(board->move_number == 1 && board->to_move == WHITE) {
-                /* Find the number of pieces for each player. */
-                int num_pieces[2][NUM_PIECE_VALUES] = {
-                    /* Dummies for OFF and EMPTY at the start. */
-                    /*     P  N  B  R  Q  K */
-                    {0, 0, 8, 2, 2, 2, 1, 1},
-                    {0, 0, 8, 2, 2, 2, 1, 1}
-                };
-                extract_pieces_from_board(num_pieces, board);
-                for(int p = PAWN; p <= QUEEN && !odds; p++) {
-                    if(num_pieces[0][p] != num_pieces[1][p]) {
+                /* Compare the number of pieces for each player. */
+                MaterialSignature material = board->material_signature;
+                for(Piece p = PAWN; p <= QUEEN && !odds; p++) {
+                    if(MATERIAL_COUNT(material, WHITE, p) != MATERIAL_COUNT(material, BLACK, p)) {
                         odds = TRUE;
                     }
                 }
@@ -358,6 +373,20 @@ select_output_file(StateInfo *GameState, const char *eco)
     return GameState->outputfile;
 }
 
+/*
+ * Whether game belongs in the --split file.
+ * The choice depends only on the moves of the game, so copies
+ * of a game from different sources always fall on the same side.
+ */
+static Boolean
+game_in_split(const Game *game)
+{
+    HashCode key = game->final_hash_value ^
+            (game->cumulative_hash_value * 0xff51afd7ed558ccdULL);
+
+    return split_fraction(key, GlobalState.split_seed) < GlobalState.split_ratio;
+}
+
 /*
  * Conditions for finishing processing, other than all the input
  * having been processed.
@@ -409,10 +438,149 @@ parse_opt_game_list(SourceFileType file_type)
         }
         move_list = NULL;
         setup_for_new_game();
+        if (GlobalState.checkpoint_file != NULL &&
+                GlobalState.current_file_type == NORMALFILE &&
+                (GlobalState.num_games_processed % CHECKPOINT_INTERVAL == 0 ||
+                 finished_processing())) {
+            save_checkpoint();
+        }
     }
     if(move_list != NULL) {
         free_move_list(move_list);
     }
+    if (GlobalState.checkpoint_file != NULL && file_type == NORMALFILE &&
+            !finished_processing()) {
+        save_checkpoint();
+    }
+}
+
+/* Return the number of input files. */
+static unsigned
+count_input_files(void)
+{
+    unsigned num_files = 0;
+
+    while (input_file_name(num_files) != NULL) {
+        num_files++;
+    }
+    return num_files;
+}
+
+/* Record in the --checkpoint file how far processing has got.
+ * Nothing is recorded if the input cannot be resumed at the
+ * current point; the previous checkpoint then remains valid.
+ */
+static void
+save_checkpoint(void)
+{
+    unsigned file_number;
+    long offset;
+    unsigned long line;
+    long output_length, non_matching_length = 0;
+
+    if (!input_resume_point(&file_number, &offset, &line)) {
+        return;
+    }
+    if (!sync_file(GlobalState.outputfile) ||
+            (GlobalState.non_matching_file != NULL &&
+             !sync_file(GlobalState.non_matching_file))) {
+        fprintf(GlobalState.logfile, "Unable to flush the output for %s\n",
+                GlobalState.checkpoint_file);
+        exit(1);
+    }
+    output_length = ftell(GlobalState.outputfile);
+    if (GlobalState.non_matching_file != NULL) {
+        non_matching_length = ftell(GlobalState.non_matching_file);
+    }
+    if (output_length < 0 || non_matching_length < 0) {
+        fprintf(GlobalState.logfile,
+                "--checkpoint requires output to regular files.\n");
+        exit(1);
+    }
+    checkpoint_fields[CK_FILES].value = count_input_files();
+    checkpoint_fields[CK_FILE].value = file_number;
+    checkpoint_fields[CK_OFFSET].value = offset;
+    checkpoint_fields[CK_LINE].value = line;
+    checkpoint_fields[CK_PROCESSED].value = GlobalState.num_games_processed;
+    checkpoint_fields[CK_MATCHED].value = GlobalState.num_games_matched;
+    checkpoint_fields[CK_NON_MATCHING].value = GlobalState.num_non_matching_games;
+    checkpoint_fields[CK_OUTPUT].value = output_length;
+    checkpoint_fields[CK_NON_MATCHING_OUTPUT].value = non_matching_length;
+    if (!write_checkpoint(GlobalState.checkpoint_file,
+                          checkpoint_fields, CK_NUM_FIELDS)) {
+        fprintf(GlobalState.logfile, "Unable to write the checkpoint file %s\n",
+                GlobalState.checkpoint_file);
+        exit(1);
+    }
+}
+
+/* Continue a run from the point recorded in the --checkpoint file.
+ * Return FALSE if there is no checkpoint, in which case processing
+ * starts from the beginning.
+ * Otherwise, the output files are truncated to their recorded
+ * lengths, the game counts restored and the input positioned
+ * after the last game recorded. *input_remains is set to
+ * indicate whether there is any input left to process.
+ */
+Boolean
+resume_from_checkpoint(Boolean *input_remains)
+{
+    CheckpointStatus status = read_checkpoint(GlobalState.checkpoint_file,
+                                              checkpoint_fields, CK_NUM_FIELDS);
+    game_number **range;
+    game_number **ranges[2];
+    unsigned r;
+
+    if (status == CHECKPOINT_ABSENT) {
+        return FALSE;
+    }
+    else if (status == CHECKPOINT_INVALID) {
+        fprintf(GlobalState.logfile, "The checkpoint file %s is not valid.\n",
+                GlobalState.checkpoint_file);
+        exit(1);
+    }
+    else if (checkpoint_fields[CK_FILES].value != count_input_files()) {
+        fprintf(GlobalState.logfile,
+                "The checkpoint file %s was written for %lu input files, not %u.\n",
+                GlobalState.checkpoint_file, checkpoint_fields[CK_FILES].value,
+                count_input_files());
+        exit(1);
+    }
+    if (fseek(GlobalState.outputfile, 0, SEEK_END) != 0 ||
+            ftell(GlobalState.outputfile) < (long) checkpoint_fields[CK_OUTPUT].value ||
+            (GlobalState.non_matching_file != NULL &&
+             (fseek(GlobalState.non_matching_file, 0, SEEK_END) != 0 ||
+              ftell(GlobalState.non_matching_file) <
+                    (long) checkpoint_fields[CK_NON_MATCHING_OUTPUT].value))) {
+        fprintf(GlobalState.logfile,
+                "The output is shorter than recorded in %s: use -a rather than -o to resume.\n",
+                GlobalState.checkpoint_file);
+        exit(1);
+    }
+    if (!truncate_file(GlobalState.outputfile, checkpoint_fields[CK_OUTPUT].value) ||
+            (GlobalState.non_matching_file != NULL &&
+             !truncate_file(GlobalState.non_matching_file,
+                            checkpoint_fields[CK_NON_MATCHING_OUTPUT].value))) {
+        fprintf(GlobalState.logfile, "Unable to truncate the output to resume from %s\n",
+                GlobalState.checkpoint_file);
+        exit(1);
+    }
+    GlobalState.num_games_processed = checkpoint_fields[CK_PROCESSED].value;
+    GlobalState.num_games_matched = checkpoint_fields[CK_MATCHED].value;
+    GlobalState.num_non_matching_games = checkpoint_fields[CK_NON_MATCHING].value;
+    /* Skip the game-number ranges that have already been dealt with. */
+    ranges[0] = &GlobalState.next_game_number_to_output;
+    ranges[1] = &GlobalState.next_game_number_to_skip;
+    for (r = 0; r < 2; r++) {
+        range = ranges[r];
+        while (*range != NULL && (*range)->max <= GlobalState.num_games_matched) {
+            *range = (*range)->next;
+        }
+    }
+    *input_remains = resume_input(checkpoint_fields[CK_FILE].value,
+                                  checkpoint_fields[CK_OFFSET].value,
+                                  checkpoint_fields[CK_LINE].value);
+    return TRUE;
 }
 
 /* Parse a game and return a pointer to any valid list of moves
@@ -1159,6 +1327,202 @@ static Boolean consistent_FEN_tags(Game *current_game)
     return consistent;
 }
 
+/* What a filter of games needs in order to be applied. */
+typedef enum {
+    FILTER_ON_TAGS, FILTER_ON_MOVE_TEXT, FILTER_ON_REPLAY
+} FilterDependency;
+
+/* A selection criterion applied to a game once its tags have been
+ * checked.  Those that do not need the game to have been replayed
+ * are applied first, before apply_move_list, in order of their
+ * observed rejections for their cost.  Those that do are applied
+ * afterwards in a fixed order, as some of them annotate the game.
+ * plycount is NULL before the game is replayed.
+ */
+typedef struct {
+    Boolean (*accepts)(Game *game, const unsigned *plycount);
+    FilterDependency dependency;
+    /* A rough relative cost of applying the filter. */
+    unsigned cost;
+    unsigned long applied, rejected;
+} GameFilter;
+
+/* How many games between reorderings of the filters applied before replay. */
+#define FILTER_REORDER_INTERVAL 1024
+
+/* The length of a game without a FEN tag is known from its moves. */
+static Boolean
+filter_move_bounds_from_moves(Game *game, const unsigned *plycount)
+{
+    if (GlobalState.check_move_bounds && game->tags[FEN_TAG] == NULL) {
+        unsigned num_moves = 0;
+        for (const Move *move = game->moves; move != NULL; move = move->next) {
+            num_moves++;
+        }
+        return check_move_bounds(num_moves);
+    }
+    else {
+        return TRUE;
+    }
+}
+
+/* The length of a game with a FEN tag depends on its starting position. */
+static Boolean
+filter_move_bounds_from_replay(Game *game, const unsigned *plycount)
+{
+    if (game->tags[FEN_TAG] != NULL) {
+        return check_move_bounds(*plycount);
+    }
+    else {
+        return TRUE;
+    }
+}
+
+static Boolean
+filter_odds(Game *game, const unsigned *plycount)
+{
+    return check_for_odds(game);
+}
+
+static Boolean
+filter_textual_variations(Game *game, const unsigned *plycount)
+{
+    return check_textual_variations(game);
+}
+
+static Boolean
+filter_material_match(Game *game, const unsigned *plycount)
+{
+    return check_for_material_match(game);
+}
+
+static Boolean
+filter_checkmate(Game *game, const unsigned *plycount)
+{
+    return check_for_only_checkmate(game);
+}
+
+static Boolean
+filter_repetition(Game *game, const unsigned *plycount)
+{
+    return check_for_only_repetition(game->position_counts);
+}
+
+static Boolean
+filter_ECO_tag(Game *game, const unsigned *plycount)
+{
+    return check_ECO_tag(game->tags, TRUE);
+}
+
+static Boolean
+filter_comments(Game *game, const unsigned *plycount)
+{
+    return check_for_comments(game);
+}
+
+/* The filters, in the order in which they were originally applied.
+ * The dependency of filter_ECO_tag is FILTER_ON_REPLAY if ECO
+ * classification is being added.
+ * Comments are checked after replay because matches can add them.
+ */
+static GameFilter game_filters[] = {
+    { filter_move_bounds_from_moves, FILTER_ON_MOVE_TEXT, 2, 0, 0 },
+    { filter_move_bounds_from_replay, FILTER_ON_REPLAY, 1, 0, 0 },
+    { filter_odds, FILTER_ON_TAGS, 8, 0, 0 },
+    { filter_textual_variations, FILTER_ON_MOVE_TEXT, 4, 0, 0 },
+    { filter_material_match, FILTER_ON_REPLAY, 1, 0, 0 },
+    { filter_checkmate, FILTER_ON_REPLAY, 1, 0, 0 },
+    { filter_repetition, FILTER_ON_REPLAY, 1, 0, 0 },
+    { filter_ECO_tag, FILTER_ON_TAGS, 1, 0, 0 },
+    { filter_comments, FILTER_ON_REPLAY, 1, 0, 0 },
+};
+#define NUM_GAME_FILTERS (sizeof(game_filters) / sizeof(game_filters[0]))
+
+/* The filters applied before replay, in their current order. */
+static GameFilter *filters_before_replay[NUM_GAME_FILTERS];
+static unsigned num_filters_before_replay = 0;
+static Boolean filters_ready = FALSE;
+
+static void
+set_up_filters(void)
+{
+    for (unsigned i = 0; i < NUM_GAME_FILTERS; i++) {
+        GameFilter *filter = &game_filters[i];
+        if (filter->accepts == filter_ECO_tag && GlobalState.add_ECO) {
+            filter->dependency = FILTER_ON_REPLAY;
+        }
+        if (filter->dependency != FILTER_ON_REPLAY) {
+            filters_before_replay[num_filters_before_replay] = filter;
+            num_filters_before_replay++;
+        }
+    }
+    filters_ready = TRUE;
+}
+
+/* The expected number of rejections per unit of cost of filter. */
+static double
+filter_value(const GameFilter *filter)
+{
+    return (filter->rejected + 1.0) / (filter->applied + 2.0) / filter->cost;
+}
+
+/* Order the filters applied before replay so that those that
+ * reject most games for their cost come first.
+ */
+static void
+reorder_filters(void)
+{
+    for (unsigned i = 1; i < num_filters_before_replay; i++) {
+        GameFilter *filter = filters_before_replay[i];
+        unsigned j = i;
+        while (j > 0 && filter_value(filters_before_replay[j - 1]) < filter_value(filter)) {
+            filters_before_replay[j] = filters_before_replay[j - 1];
+            j--;
+        }
+        filters_before_replay[j] = filter;
+    }
+}
+
+/* Apply the filters whose dependencies are met to game:
+ * those applied before replay if plycount is NULL, otherwise
+ * those that need replay.
+ * Return TRUE if game passes all of them.
+ */
+static Boolean
+apply_filters(Game *game, const unsigned *plycount)
+{
+    Boolean wanted = TRUE;
+
+    if (!filters_ready) {
+        set_up_filters();
+    }
+    if (plycount == NULL) {
+        static unsigned long games_filtered = 0;
+
+        games_filtered++;
+        if (games_filtered % FILTER_REORDER_INTERVAL == 0) {
+            reorder_filters();
+        }
+        for (unsigned i = 0; i < num_filters_before_replay && wanted; i++) {
+            GameFilter *filter = filters_before_replay[i];
+            filter->applied++;
+            if (!filter->accepts(game, plycount)) {
+                filter->rejected++;
+                wanted = FALSE;
+            }
+        }
+    }
+    else {
+        for (unsigned i = 0; i < NUM_GAME_FILTERS && wanted; i++) {
+            GameFilter *filter = &game_filters[i];
+            if (filter->dependency == FILTER_ON_REPLAY) {
+                wanted = filter->accepts(game, plycount);
+            }
+        }
+    }
+    return wanted;
+}
+
 static void
 deal_with_game(Move *move_list, unsigned long start_line, unsigned long end_line)
 {
@@ -1203,6 +1567,9 @@ deal_with_game(Move *move_list, unsigned long start_line, unsigned long end_line
      * eliminate most games without going through the lengthy
      * process of game matching.
      *
+     * Likewise, the other criteria that do not need the game
+     * to be replayed are checked before apply_move_list.
+     *
      * If ECO adding is done, the order of checking may cause
      * a conflict here since it won't be possible to reject a game
      * based on its ECO code unless it already has one.
@@ -1213,17 +1580,11 @@ deal_with_game(Move *move_list, unsigned long start_line, unsigned long end_line
         check_tag_details_not_ECO(current_game.tags, current_game.tags_length, TRUE) &&
         check_setup_tag(current_game.tags) &&
         check_duplicate_setup(&current_game) &&
+        apply_filters(&current_game, NULL) &&
 
         apply_move_list(&current_game, &plycount, GlobalState.depth_of_positional_search, TRUE) &&
 
-        check_move_bounds(plycount) &&
-        check_for_odds(&current_game) &&
-        check_textual_variations(&current_game) &&
-        check_for_material_match(&current_game) &&
-        check_for_only_checkmate(&current_game) &&
-        check_for_only_repetition(current_game.position_counts) &&
-        check_ECO_tag(current_game.tags, TRUE) &&
-        check_for_comments(&current_game)) {
+        apply_filters(&current_game, &plycount)) {
         /* If there is no original filename then the game is not a
          * duplicate.
          */
@@ -1296,6 +1657,10 @@ deal_with_game(Move *move_list, unsigned long start_line, unsigned long end_line
                         terminate_line(outputfile);
                     }
                 }
+                else if (GlobalState.split_file != NULL &&
+                        game_in_split(&current_game)) {
+                    outputfile = GlobalState.split_file;
+                }
                 if(! GlobalState.suppress_matched) {
                     /* Now output what we have. */
                     output_game(&current_game, outputfile);
@@ -1357,6 +1722,40 @@ deal_with_game(Move *move_list, unsigned long start_line, unsigned long end_line
     }
 }
 
+/* Process a game made from a FEN string and a list of moves, rather
+ * than one parsed from the input (--ucilines).
+ * line_number is the line of the input that the game came from.
+ * Return FALSE if no further games are wanted.
+ */
+Boolean
+deal_with_constructed_game(const char *fen, Move *move_list, unsigned long line_number)
+{
+    if (finished_processing()) {
+        free_move_list(move_list);
+        return FALSE;
+    }
+    GameHeader.Tags[FEN_TAG] = copy_string(fen);
+    GameHeader.Tags[SETUP_TAG] = copy_string("1");
+    if (move_list != NULL) {
+        Move *last_move = move_list;
+
+        while (last_move->next != NULL) {
+            last_move = last_move->next;
+        }
+        last_move->terminating_result = copy_string("*");
+    }
+    else {
+        /* There is no move to carry the result.
+         * Otherwise the Result tag is left unset, as a line of moves
+         * is not a complete game, and a line ending in mate would
+         * be reported as inconsistent with a result of *.
+         */
+        GameHeader.Tags[RESULT_TAG] = copy_string("*");
+    }
+    deal_with_game(move_list, line_number, line_number);
+    return !finished_processing();
+}
+
 /*
  * Output the given game to the output file.
  * If GlobalState.split_variants then this will involve outputting 
@@ -31,6 +31,8 @@ void append_comments_to_move(Move *move,CommentList *Comment);
 /* The following function is used for linking list items together. */
 StringList *save_string_list_item(StringList *list,const char *str);
 void free_comment_list(CommentList *comment_list);
+Boolean resume_from_checkpoint(Boolean *input_remains);
+Boolean deal_with_constructed_game(const char *fen, Move *move_list, unsigned long line_number);
 
 #endif	// GRAMMAR_H
 
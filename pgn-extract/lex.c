@@ -64,6 +64,10 @@ static void terminate_input(void);
 
 static unsigned long line_number = 0;
 static unsigned long line_position = 0;
+/* The part of the current line not yet tokenised, NULL if there is none. */
+static const unsigned char *unread_text = NULL;
+/* Offset in the input file of the line following the current line. */
+static long next_line_offset = 0;
 /* Keep track of the Recursive Annotation Variation level. */
 static unsigned RAV_level = 0;
 /* Keep track of the last move found. */
@@ -1180,6 +1184,7 @@ get_next_symbol(void)
             }
         }
         line_position = linep - (unsigned char *) line;
+        unread_text = line != NULL ? linep : NULL;
     } while (token == NO_TOKEN);
     return token;
 }
@@ -1310,10 +1315,13 @@ current_file_number(void)
 static size_t input_buffer_index = 0;
 static size_t input_buffer_limit = 0;
 static char input_buffer[INPUT_BUFFER_LEN];
+/* Offset in the input file of input_buffer[0]. */
+static long input_buffer_base = 0;
 
 /* Fill the input buffer to its limit, if possible. */
 static void fill_input_buffer(FILE *fpin)
 {
+    input_buffer_base += input_buffer_limit;
     if(! feof(fpin)) {
         input_buffer_limit = fread(input_buffer, sizeof(*input_buffer), INPUT_BUFFER_LEN, fpin);
     }
@@ -1508,6 +1516,7 @@ open_input(const char *infile)
 {
     yyin = fopen(infile, "rb");
     if (yyin != NULL) {
+        input_buffer_base = next_line_offset = 0;
         GlobalState.current_input_file = infile;
         if (GlobalState.verbosity > 1) {
             fprintf(GlobalState.logfile, "Processing %s\n",
@@ -1621,10 +1630,64 @@ next_input_line(FILE *fp)
     if (line != NULL) {
         line_number++;
         line_position = 0;
+        next_line_offset = input_buffer_base + input_buffer_index;
     }
     return line;
 }
 
+/* Determine where reading of the input could be resumed
+ * if processing were to stop now: the number of the file, and the offset
+ * and line number of the next line to be read.
+ * Return FALSE if that is not possible, either because the input is stdin
+ * or because the current line has not been completely consumed.
+ */
+Boolean
+input_resume_point(unsigned *file_number, long *offset, unsigned long *line)
+{
+    if (list_of_files.num_files == 0) {
+        return FALSE;
+    }
+    if (unread_text != NULL) {
+        const unsigned char *text = unread_text;
+        while (*text != '\0' && isspace(*text)) {
+            text++;
+        }
+        if (*text != '\0') {
+            return FALSE;
+        }
+    }
+    *file_number = current_file_num;
+    *offset = next_line_offset;
+    *line = line_number;
+    return TRUE;
+}
+
+/* Resume reading the input at a point given by input_resume_point.
+ * Return FALSE if there is no input left.
+ */
+Boolean
+resume_input(unsigned file_number, long offset, unsigned long line)
+{
+    current_file_num = file_number;
+    if (input_file_name(file_number) == NULL) {
+        return FALSE;
+    }
+    else if (!open_input_file(file_number)) {
+        fprintf(GlobalState.logfile, "Unable to open the PGN file: %s\n",
+                input_file_name(file_number));
+        exit(1);
+    }
+    else if (fseek(yyin, offset, SEEK_SET) != 0) {
+        fprintf(GlobalState.logfile, "Unable to resume %s at offset %ld\n",
+                input_file_name(file_number), offset);
+        exit(1);
+    }
+    input_buffer_base = next_line_offset = offset;
+    input_buffer_index = input_buffer_limit = 0;
+    line_number = line;
+    return TRUE;
+}
+
 /* Handle the end of a file. */
 int
 yywrap(void)
@@ -1686,6 +1749,16 @@ reset_line_number(void)
     line_position = 0;
 }
 
+/* Set the line number reported in diagnostics for input that is
+ * not read by the lexer (--ucilines).
+ */
+void
+set_line_number(unsigned long line)
+{
+    line_number = line;
+    line_position = 0;
+}
+
 static void
 terminate_input(void)
 {
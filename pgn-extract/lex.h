@@ -83,9 +83,12 @@ char *next_input_line(FILE *fp);
 TokenType next_token(void);
 Boolean open_eco_file(const char *eco_file);
 Boolean open_first_file(void);
+Boolean input_resume_point(unsigned *file_number, long *offset, unsigned long *line);
+Boolean resume_input(unsigned file_number, long offset, unsigned long line);
 void print_error_context(FILE *fp);
 char *read_line(FILE *fpin);
 void reset_line_number(void);
+void set_line_number(unsigned long line);
 void restart_lex_for_new_game(void);
 void save_assessment(const char *assess);
 TokenType skip_to_next_game(TokenType token);
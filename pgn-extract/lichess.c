@@ -0,0 +1,787 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+/* packtool lichess: convert the lichess evaluation database
+ * (lichess_db_eval.jsonl.zst) to the CSV written by
+ * dataset-generation/convert_lichess_dataset.py:
+ *     fen,depth,score[,pv]
+ * or directly to packed records (-b).
+ *
+ * For each position the deepest evaluation is used (the first, if several
+ * are equally deep), and from it the first principal variation.
+ * Its score is in centipawns, or +/-PACKED_MATE_SCORE for a mate.
+ *
+ * Decompression runs on its own thread, and the lines of each
+ * decompressed chunk are converted in parallel by a fixed-purpose scanner
+ * that extracts only fen, evals, depth and pvs from each object.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <zstd.h>
+#include "bool.h"
+#include "mymalloc.h"
+#include "packed.h"
+#include "pipeline.h"
+#include "packtool.h"
+
+/* The amount of input in each chunk handed to a worker. */
+#define CHUNK_SIZE (4 * 1024 * 1024)
+/* Nesting depth beyond which an object is rejected. */
+#define MAX_JSON_NESTING 64
+/* The longest FEN accepted. */
+#define MAX_FEN_LENGTH 100
+
+typedef struct {
+    FILE *input;
+    const char *input_name;
+    /* Non-NULL if the input is zstd compressed. */
+    ZSTD_DStream *stream;
+    ZSTD_inBuffer compressed;
+    char *compressed_space;
+    size_t compressed_size;
+    /* The last result of ZSTD_decompressStream: 0 at the end of a frame. */
+    size_t frame_remaining;
+    LineSource lines;
+
+    unsigned pv_depth;
+    Boolean packed;
+    FILE *output;
+    const char *output_name;
+    Boolean verbose;
+    unsigned long records, errors;
+} LichessContext;
+
+/* The parts of an object that are used. */
+typedef struct {
+    const char *fen;
+    size_t fen_length;
+    Boolean have_fen;
+    /* The deepest evaluation so far. */
+    Boolean have_eval;
+    long depth;
+    Boolean have_cp, have_mate, have_line;
+    long cp, mate;
+    const char *line;
+    size_t line_length;
+} LichessEntry;
+
+/* The state of a scan of one line. */
+typedef struct {
+    const char *p, *end;
+    const char *error;
+} Scanner;
+
+static void usage_and_exit(void);
+static size_t fill_raw_input(void *source, char *space, size_t size);
+static Boolean read_lichess_chunk(void *arg, Chunk *chunk);
+static void process_lichess_chunk(void *arg, Chunk *chunk);
+static void write_lichess_chunk(void *arg, Chunk *chunk);
+static Boolean convert_line(const LichessContext *context, const char *line,
+                            size_t length, Chunk *chunk);
+static Boolean scan_entry(Scanner *scanner, LichessEntry *entry);
+static Boolean scan_evals(Scanner *scanner, LichessEntry *entry);
+static Boolean scan_eval(Scanner *scanner, LichessEntry *entry);
+static Boolean scan_pvs(Scanner *scanner, LichessEntry *candidate);
+static Boolean scan_pv(Scanner *scanner, LichessEntry *candidate);
+static Boolean scan_string(Scanner *scanner, const char **start, size_t *length);
+static Boolean scan_integer(Scanner *scanner, long *value);
+static Boolean skip_value(Scanner *scanner, unsigned nesting);
+static Boolean expect(Scanner *scanner, char c);
+static Boolean accept_char(Scanner *scanner, char c);
+static Boolean key_is(const char *key, size_t length, const char *name);
+static void skip_space(Scanner *scanner);
+static void output_csv_field(Chunk *chunk, const char *field, size_t length);
+
+static void
+usage_and_exit(void)
+{
+    fprintf(stderr,
+            "Usage: packtool lichess [options] input output\n"
+            "Convert lichess_db_eval.jsonl[.zst] to fen,depth,score[,pv] CSV.\n"
+            "Either file may be - for the standard input or output.\n"
+            "    -b      write packed records rather than CSV\n"
+            "    -p N    include the first N moves of the principal variation\n"
+            "    -j N    number of worker threads (default %u)\n"
+            "    -q      no progress report\n",
+            default_thread_count());
+    exit(1);
+}
+
+/* Read up to size bytes of the input, decompressing if necessary.
+ * Return the number of bytes read, 0 at the end of the input.
+ */
+static size_t
+fill_raw_input(void *source, char *space, size_t size)
+{
+    LichessContext *context = (LichessContext *) source;
+    ZSTD_outBuffer out;
+
+    if (context->stream == NULL) {
+        /* Anything read when checking for compression comes first. */
+        size_t pending = context->compressed.size - context->compressed.pos;
+        if (pending > 0) {
+            if (pending > size) {
+                pending = size;
+            }
+            memcpy(space, context->compressed_space + context->compressed.pos, pending);
+            context->compressed.pos += pending;
+            return pending;
+        }
+        return fread(space, 1, size, context->input);
+    }
+    out.dst = space;
+    out.size = size;
+    out.pos = 0;
+    while (out.pos < out.size) {
+        if (context->compressed.pos == context->compressed.size) {
+            context->compressed.size = fread(context->compressed_space, 1,
+                                             context->compressed_size, context->input);
+            context->compressed.pos = 0;
+            if (context->compressed.size == 0) {
+                if (context->frame_remaining != 0) {
+                    fprintf(stderr, "packtool: %s is truncated\n", context->input_name);
+                    exit(1);
+                }
+                break;
+            }
+        }
+        context->frame_remaining = ZSTD_decompressStream(context->stream, &out,
+                                                         &context->compressed);
+        if (ZSTD_isError(context->frame_remaining)) {
+            fprintf(stderr, "packtool: %s: %s\n", context->input_name,
+                    ZSTD_getErrorName(context->frame_remaining));
+            exit(1);
+        }
+    }
+    return out.pos;
+}
+
+/* Fill chunk with whole lines of input. */
+static Boolean
+read_lichess_chunk(void *arg, Chunk *chunk)
+{
+    LichessContext *context = (LichessContext *) arg;
+
+    return read_line_chunk(&context->lines, chunk, CHUNK_SIZE);
+}
+
+static void
+process_lichess_chunk(void *arg, Chunk *chunk)
+{
+    const LichessContext *context = (const LichessContext *) arg;
+    const char *line = chunk->input;
+    const char *end = chunk->input + chunk->input_length;
+
+    while (line < end) {
+        const char *next = memchr(line, '\n', end - line);
+        size_t length;
+        size_t blank;
+
+        if (next == NULL) {
+            next = end;
+        }
+        length = next - line;
+        for (blank = 0; blank < length && strchr(" \t\r\f\v", line[blank]) != NULL; blank++) {
+        }
+        if (blank < length) {
+            if (convert_line(context, line, length, chunk)) {
+                chunk->records++;
+            }
+            else {
+                chunk->errors++;
+            }
+        }
+        line = next + 1;
+    }
+}
+
+static void
+write_lichess_chunk(void *arg, Chunk *chunk)
+{
+    LichessContext *context = (LichessContext *) arg;
+    unsigned long before = context->records;
+
+    if (fwrite(chunk->output, 1, chunk->output_length, context->output) !=
+            chunk->output_length) {
+        fprintf(stderr, "packtool: error writing %s\n", context->output_name);
+        exit(1);
+    }
+    context->records += chunk->records;
+    context->errors += chunk->errors;
+    if (context->verbose &&
+            before / PROGRESS_INTERVAL != context->records / PROGRESS_INTERVAL) {
+        fprintf(stderr, "\rProcessed: %lu rows", context->records);
+    }
+}
+
+/* Convert one line of input to chunk's output.
+ * Return FALSE, after reporting the problem, if it cannot be converted.
+ */
+static Boolean
+convert_line(const LichessContext *context, const char *line, size_t length,
+             Chunk *chunk)
+{
+    Scanner scanner;
+    LichessEntry entry;
+    long score;
+
+    scanner.p = line;
+    scanner.end = line + length;
+    scanner.error = NULL;
+    memset(&entry, 0, sizeof (entry));
+    if (!scan_entry(&scanner, &entry)) {
+    }
+    else if (!entry.have_fen) {
+        scanner.error = "no fen";
+    }
+    else if (!entry.have_eval) {
+        scanner.error = "no evals";
+    }
+    else if (!entry.have_line) {
+        scanner.error = "no principal variation";
+    }
+    else if (!entry.have_cp && !entry.have_mate) {
+        scanner.error = "undefined score";
+    }
+    else if (entry.fen_length > MAX_FEN_LENGTH) {
+        scanner.error = "fen too long";
+    }
+    if (scanner.error != NULL) {
+        fprintf(stderr, "packtool: skipping %.*s: %s\n",
+                (int) (length > 80 ? 80 : length), line, scanner.error);
+        return FALSE;
+    }
+    score = entry.have_mate ? (entry.mate < 0 ? -PACKED_MATE_SCORE : PACKED_MATE_SCORE)
+                            : entry.cp;
+
+    if (context->packed) {
+        PackedRecord record;
+        char fen[MAX_FEN_LENGTH + 1];
+        const char *move = entry.line;
+        const char *line_end = entry.line + entry.line_length;
+        unsigned m;
+
+        memcpy(fen, entry.fen, entry.fen_length);
+        fen[entry.fen_length] = '\0';
+        if (!fen_to_packed(fen, &record)) {
+            fprintf(stderr, "packtool: skipping invalid FEN %s\n", fen);
+            return FALSE;
+        }
+        record.score = double_to_half(score / 100.0);
+        for (m = 0; m < context->pv_depth; m++) {
+            int code = 0;
+            if (move <= line_end) {
+                const char *space = memchr(move, ' ', line_end - move);
+                size_t move_length = (space != NULL ? space : line_end) - move;
+                code = uci_move_code(move, move_length);
+                if (code < 0) {
+                    fprintf(stderr, "packtool: skipping %s: invalid move %.*s\n",
+                            fen, (int) move_length, move);
+                    return FALSE;
+                }
+                move += move_length + 1;
+            }
+            record.pv[m] = (uint16_t) code;
+        }
+        encode_packed_record(&record, context->pv_depth,
+                             (unsigned char *) chunk_output_space(chunk,
+                                     packed_record_size(context->pv_depth)));
+    }
+    else {
+        char number[64];
+
+        output_csv_field(chunk, entry.fen, entry.fen_length);
+        sprintf(number, ",%ld,%ld", entry.depth, score);
+        chunk_output(chunk, number, strlen(number));
+        if (context->pv_depth > 0) {
+            /* As Python's ' '.join(line.split(' ')[:pv_depth]), padded with
+             * null moves.
+             */
+            unsigned moves = 1;
+            size_t prefix;
+            char *pv;
+
+            for (prefix = 0; prefix < entry.line_length; prefix++) {
+                if (entry.line[prefix] == ' ') {
+                    if (moves == context->pv_depth) {
+                        break;
+                    }
+                    moves++;
+                }
+            }
+            pv = (char *) malloc_or_die(prefix + 5 * (context->pv_depth - moves) + 1);
+            memcpy(pv, entry.line, prefix);
+            for (; moves < context->pv_depth; moves++) {
+                memcpy(pv + prefix, " 0000", 5);
+                prefix += 5;
+            }
+            chunk_output(chunk, ",", 1);
+            output_csv_field(chunk, pv, prefix);
+            (void) free((void *) pv);
+        }
+        /* The csv module's line terminator. */
+        chunk_output(chunk, "\r\n", 2);
+    }
+    return TRUE;
+}
+
+/* Write field, quoted as the csv module would if necessary. */
+static void
+output_csv_field(Chunk *chunk, const char *field, size_t length)
+{
+    size_t i;
+
+    for (i = 0; i < length && strchr(",\"\r\n", field[i]) == NULL; i++) {
+    }
+    if (i == length) {
+        chunk_output(chunk, field, length);
+        return;
+    }
+    chunk_output(chunk, "\"", 1);
+    for (i = 0; i < length; i++) {
+        if (field[i] == '"') {
+            chunk_output(chunk, "\"", 1);
+        }
+        chunk_output(chunk, &field[i], 1);
+    }
+    chunk_output(chunk, "\"", 1);
+}
+
+static void
+skip_space(Scanner *scanner)
+{
+    while (scanner->p < scanner->end && strchr(" \t\r\n", *scanner->p) != NULL) {
+        scanner->p++;
+    }
+}
+
+/* Consume c, which must be next. */
+static Boolean
+expect(Scanner *scanner, char c)
+{
+    skip_space(scanner);
+    if (scanner->p < scanner->end && *scanner->p == c) {
+        scanner->p++;
+        return TRUE;
+    }
+    else {
+        scanner->error = "malformed JSON";
+        return FALSE;
+    }
+}
+
+/* Consume c if it is next. */
+static Boolean
+accept_char(Scanner *scanner, char c)
+{
+    skip_space(scanner);
+    if (scanner->p < scanner->end && *scanner->p == c) {
+        scanner->p++;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+static Boolean
+key_is(const char *key, size_t length, const char *name)
+{
+    return strlen(name) == length && strncmp(key, name, length) == 0;
+}
+
+/* Scan a string, returning its raw contents in *start and *length.
+ * Escape sequences are not interpreted, since none of the strings that
+ * are used contain them.
+ */
+static Boolean
+scan_string(Scanner *scanner, const char **start, size_t *length)
+{
+    const char *p;
+
+    if (!expect(scanner, '"')) {
+        return FALSE;
+    }
+    for (p = scanner->p; p < scanner->end && *p != '"'; p++) {
+        if (*p == '\\') {
+            p++;
+        }
+    }
+    if (p >= scanner->end) {
+        scanner->error = "unterminated string";
+        return FALSE;
+    }
+    *start = scanner->p;
+    *length = p - scanner->p;
+    scanner->p = p + 1;
+    return TRUE;
+}
+
+static Boolean
+scan_integer(Scanner *scanner, long *value)
+{
+    Boolean negative = FALSE;
+    const char *digits;
+    long n = 0;
+
+    skip_space(scanner);
+    if (scanner->p < scanner->end && *scanner->p == '-') {
+        negative = TRUE;
+        scanner->p++;
+    }
+    digits = scanner->p;
+    while (scanner->p < scanner->end && *scanner->p >= '0' && *scanner->p <= '9' &&
+            scanner->p - digits < 18) {
+        n = n * 10 + (*scanner->p - '0');
+        scanner->p++;
+    }
+    if (scanner->p == digits ||
+            (scanner->p < scanner->end && strchr("0123456789.eE", *scanner->p) != NULL)) {
+        scanner->error = "expected an integer";
+        return FALSE;
+    }
+    *value = negative ? -n : n;
+    return TRUE;
+}
+
+/* Skip over a value of any type. */
+static Boolean
+skip_value(Scanner *scanner, unsigned nesting)
+{
+    const char *start;
+    size_t length;
+
+    skip_space(scanner);
+    if (scanner->p >= scanner->end) {
+        scanner->error = "malformed JSON";
+        return FALSE;
+    }
+    else if (nesting > MAX_JSON_NESTING) {
+        scanner->error = "nested too deeply";
+        return FALSE;
+    }
+    switch (*scanner->p) {
+        case '"':
+            return scan_string(scanner, &start, &length);
+        case '{':
+            scanner->p++;
+            if (accept_char(scanner, '}')) {
+                return TRUE;
+            }
+            do {
+                if (!scan_string(scanner, &start, &length) || !expect(scanner, ':') ||
+                        !skip_value(scanner, nesting + 1)) {
+                    return FALSE;
+                }
+            } while (accept_char(scanner, ','));
+            return expect(scanner, '}');
+        case '[':
+            scanner->p++;
+            if (accept_char(scanner, ']')) {
+                return TRUE;
+            }
+            do {
+                if (!skip_value(scanner, nesting + 1)) {
+                    return FALSE;
+                }
+            } while (accept_char(scanner, ','));
+            return expect(scanner, ']');
+        default:
+            /* A number or literal. */
+            start = scanner->p;
+            while (scanner->p < scanner->end &&
+                    strchr(",}] \t\r\n", *scanner->p) == NULL) {
+                scanner->p++;
+            }
+            if (scanner->p == start) {
+                scanner->error = "malformed JSON";
+                return FALSE;
+            }
+            return TRUE;
+    }
+}
+
+/* Scan a whole object: {"fen": ..., "evals": [...], ...} */
+static Boolean
+scan_entry(Scanner *scanner, LichessEntry *entry)
+{
+    if (!expect(scanner, '{')) {
+        return FALSE;
+    }
+    if (!accept_char(scanner, '}')) {
+        do {
+            const char *key;
+            size_t length;
+
+            if (!scan_string(scanner, &key, &length) || !expect(scanner, ':')) {
+                return FALSE;
+            }
+            if (key_is(key, length, "fen")) {
+                if (!scan_string(scanner, &entry->fen, &entry->fen_length)) {
+                    return FALSE;
+                }
+                entry->have_fen = TRUE;
+            }
+            else if (key_is(key, length, "evals")) {
+                if (!scan_evals(scanner, entry)) {
+                    return FALSE;
+                }
+            }
+            else if (!skip_value(scanner, 1)) {
+                return FALSE;
+            }
+        } while (accept_char(scanner, ','));
+        if (!expect(scanner, '}')) {
+            return FALSE;
+        }
+    }
+    skip_space(scanner);
+    if (scanner->p != scanner->end) {
+        scanner->error = "trailing text";
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static Boolean
+scan_evals(Scanner *scanner, LichessEntry *entry)
+{
+    if (!expect(scanner, '[')) {
+        return FALSE;
+    }
+    if (accept_char(scanner, ']')) {
+        return TRUE;
+    }
+    do {
+        if (!scan_eval(scanner, entry)) {
+            return FALSE;
+        }
+    } while (accept_char(scanner, ','));
+    return expect(scanner, ']');
+}
+
+/* Scan {"pvs": [...], "depth": N, ...} and keep it in entry if it
+ * is deeper than any before it.
+ */
+static Boolean
+scan_eval(Scanner *scanner, LichessEntry *entry)
+{
+    LichessEntry candidate;
+    Boolean have_depth = FALSE, have_pvs = FALSE;
+
+    memset(&candidate, 0, sizeof (candidate));
+    if (!expect(scanner, '{')) {
+        return FALSE;
+    }
+    if (!accept_char(scanner, '}')) {
+        do {
+            const char *key;
+            size_t length;
+
+            if (!scan_string(scanner, &key, &length) || !expect(scanner, ':')) {
+                return FALSE;
+            }
+            if (key_is(key, length, "depth")) {
+                if (!scan_integer(scanner, &candidate.depth)) {
+                    return FALSE;
+                }
+                have_depth = TRUE;
+            }
+            else if (key_is(key, length, "pvs")) {
+                if (!scan_pvs(scanner, &candidate)) {
+                    return FALSE;
+                }
+                have_pvs = TRUE;
+            }
+            else if (!skip_value(scanner, 2)) {
+                return FALSE;
+            }
+        } while (accept_char(scanner, ','));
+        if (!expect(scanner, '}')) {
+            return FALSE;
+        }
+    }
+    if (!have_depth) {
+        scanner->error = "evaluation without depth";
+        return FALSE;
+    }
+    if (!entry->have_eval || candidate.depth > entry->depth) {
+        if (!have_pvs) {
+            scanner->error = "evaluation without pvs";
+            return FALSE;
+        }
+        entry->have_eval = TRUE;
+        entry->depth = candidate.depth;
+        entry->have_cp = candidate.have_cp;
+        entry->cp = candidate.cp;
+        entry->have_mate = candidate.have_mate;
+        entry->mate = candidate.mate;
+        entry->have_line = candidate.have_line;
+        entry->line = candidate.line;
+        entry->line_length = candidate.line_length;
+    }
+    return TRUE;
+}
+
+/* Scan the list of principal variations, keeping the first. */
+static Boolean
+scan_pvs(Scanner *scanner, LichessEntry *candidate)
+{
+    if (!expect(scanner, '[')) {
+        return FALSE;
+    }
+    if (accept_char(scanner, ']')) {
+        return TRUE;
+    }
+    if (!scan_pv(scanner, candidate)) {
+        return FALSE;
+    }
+    while (accept_char(scanner, ',')) {
+        if (!skip_value(scanner, 3)) {
+            return FALSE;
+        }
+    }
+    return expect(scanner, ']');
+}
+
+/* Scan {"cp": N or "mate": N, "line": "..."}. */
+static Boolean
+scan_pv(Scanner *scanner, LichessEntry *candidate)
+{
+    if (!expect(scanner, '{')) {
+        return FALSE;
+    }
+    if (accept_char(scanner, '}')) {
+        return TRUE;
+    }
+    do {
+        const char *key;
+        size_t length;
+
+        if (!scan_string(scanner, &key, &length) || !expect(scanner, ':')) {
+            return FALSE;
+        }
+        if (key_is(key, length, "cp")) {
+            if (!scan_integer(scanner, &candidate->cp)) {
+                return FALSE;
+            }
+            candidate->have_cp = TRUE;
+        }
+        else if (key_is(key, length, "mate")) {
+            if (!scan_integer(scanner, &candidate->mate)) {
+                return FALSE;
+            }
+            candidate->have_mate = TRUE;
+        }
+        else if (key_is(key, length, "line")) {
+            if (!scan_string(scanner, &candidate->line, &candidate->line_length)) {
+                return FALSE;
+            }
+            candidate->have_line = TRUE;
+        }
+        else if (!skip_value(scanner, 4)) {
+            return FALSE;
+        }
+    } while (accept_char(scanner, ','));
+    return expect(scanner, '}');
+}
+
+int
+lichess_command(int argc, char *argv[])
+{
+    LichessContext context;
+    Pipeline pipeline;
+    unsigned threads = default_thread_count();
+    unsigned char magic[4];
+    int option;
+
+    memset(&context, 0, sizeof (context));
+    context.verbose = TRUE;
+    while ((option = getopt(argc, argv, "bp:j:qh")) != -1) {
+        switch (option) {
+            case 'b':
+                context.packed = TRUE;
+                break;
+            case 'p':
+                context.pv_depth = read_pv_depth(optarg);
+                break;
+            case 'j':
+                threads = read_thread_count(optarg);
+                break;
+            case 'q':
+                context.verbose = FALSE;
+                break;
+            default:
+                usage_and_exit();
+        }
+    }
+    if (optind + 2 != argc) {
+        usage_and_exit();
+    }
+    context.input_name = argv[optind];
+    context.output_name = argv[optind + 1];
+    context.input = open_file_or_die(context.input_name, "rb");
+    context.output = open_file_or_die(context.output_name, context.packed ? "wb" : "w");
+
+    /* Recognise compressed input by its magic number. */
+    context.compressed_size = ZSTD_DStreamInSize();
+    context.compressed_space = (char *) malloc_or_die(context.compressed_size);
+    context.compressed.src = context.compressed_space;
+    context.compressed.size = fread(context.compressed_space, 1, sizeof (magic),
+                                    context.input);
+    context.compressed.pos = 0;
+    memcpy(magic, context.compressed_space, context.compressed.size);
+    if (context.compressed.size == sizeof (magic) &&
+            magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) {
+        context.stream = ZSTD_createDStream();
+        if (context.stream == NULL) {
+            fprintf(stderr, "packtool: unable to create a zstd stream\n");
+            exit(1);
+        }
+        ZSTD_initDStream(context.stream);
+    }
+    init_line_source(&context.lines, fill_raw_input, &context);
+
+    if (!context.packed) {
+        fputs("fen,depth,score\r\n", context.output);
+    }
+    pipeline.read = read_lichess_chunk;
+    pipeline.process = process_lichess_chunk;
+    pipeline.write = write_lichess_chunk;
+    pipeline.context = &context;
+    run_pipeline(&pipeline, threads);
+
+    if (context.verbose) {
+        fprintf(stderr, "\rProcessed: %lu rows, %lu skipped\n",
+                context.records, context.errors);
+    }
+    if (context.stream != NULL) {
+        ZSTD_freeDStream(context.stream);
+    }
+    (void) free((void *) context.compressed_space);
+    free_line_source(&context.lines);
+    close_file_or_die(context.input, context.input_name);
+    close_file_or_die(context.output, context.output_name);
+    return 0;
+}
@@ -0,0 +1,225 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+/* The byte-range line reader and the --jobs worker harness;
+ * see linejobs.h.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "bool.h"
+#include "mymalloc.h"
+#include "defs.h"
+#include "typedef.h"
+#include "linejobs.h"
+
+/* The size of the blocks in which worker output is copied. */
+#define COPY_BLOCK_SIZE (1 << 16)
+
+typedef struct {
+    pid_t pid;
+    /* Where the worker writes its results, one for each output
+     * of the job.
+     */
+    FILE *outputs[MAX_LINE_JOB_OUTPUTS];
+    /* The worker returns its counts through this pipe. */
+    int counts_pipe[2];
+} Worker;
+
+/* Process the lines of fpin that start at an offset in the range
+ * [start, end), or all remaining lines if end is negative, with
+ * job->handle_line.
+ * Return FALSE if the input could not be read.
+ */
+Boolean
+process_line_range(FILE *fpin, off_t start, off_t end,
+                   const LineJob *job, FILE *outputs[], void *counts)
+{
+    char *line = NULL;
+    size_t space = 0;
+    ssize_t length;
+    off_t position = start;
+    unsigned long line_number = 0;
+    Boolean more_wanted = TRUE;
+    Boolean ok = TRUE;
+
+    if (start > 0) {
+        /* The line containing offset start - 1 belongs to the
+         * previous range.
+         */
+        if (fseeko(fpin, start - 1, SEEK_SET) != 0) {
+            ok = FALSE;
+        }
+        else if ((length = getline(&line, &space, fpin)) >= 0) {
+            position = start - 1 + length;
+        }
+        else {
+            position = end;
+        }
+    }
+    while (ok && more_wanted && (end < 0 || position < end) &&
+            (length = getline(&line, &space, fpin)) >= 0) {
+        size_t line_length = length;
+
+        position += length;
+        line_number++;
+        while (line_length > 0 &&
+                (line[line_length - 1] == '\n' || line[line_length - 1] == '\r')) {
+            line_length--;
+        }
+        /* getline leaves room for the terminating null. */
+        line[line_length] = '\0';
+        more_wanted = (*job->handle_line)(line, line_length, line_number,
+                                          outputs, counts);
+    }
+    if (ferror(fpin)) {
+        ok = FALSE;
+    }
+    free(line);
+    return ok;
+}
+
+static void
+copy_worker_output(FILE *worker_output, FILE *outfp)
+{
+    char *block = (char *) malloc_or_die(COPY_BLOCK_SIZE);
+    size_t bytes;
+
+    rewind(worker_output);
+    while ((bytes = fread(block, 1, COPY_BLOCK_SIZE, worker_output)) > 0) {
+        fwrite(block, 1, bytes, outfp);
+    }
+    free((void *) block);
+}
+
+/* Process the lines of filename, of the given size, with
+ * GlobalState.num_jobs worker processes, and add their counts to counts.
+ * Line numbers are relative to the start of each worker's range,
+ * as the workers do not read the lines before it.
+ * Return FALSE if a worker failed.
+ */
+Boolean
+process_lines_in_parallel(const char *filename, off_t size,
+                          const LineJob *job, FILE *outputs[], void *counts)
+{
+    unsigned num_jobs = GlobalState.num_jobs;
+    Worker *workers = (Worker *) malloc_or_die(num_jobs * sizeof(*workers));
+    unsigned long *worker_counts =
+            (unsigned long *) malloc_or_die(job->counts_size);
+    size_t num_counts = job->counts_size / sizeof(*worker_counts);
+    Boolean ok = TRUE;
+    unsigned job_number, i;
+
+    /* Nothing buffered must be written twice. */
+    for (i = 0; i < job->num_outputs; i++) {
+        if (outputs[i] != NULL) {
+            fflush(outputs[i]);
+        }
+    }
+    fflush(GlobalState.logfile);
+    for (job_number = 0; job_number < num_jobs; job_number++) {
+        Worker *worker = &workers[job_number];
+        Boolean created = pipe(worker->counts_pipe) == 0;
+
+        for (i = 0; i < job->num_outputs; i++) {
+            worker->outputs[i] = outputs[i] != NULL ? tmpfile() : NULL;
+            if (outputs[i] != NULL && worker->outputs[i] == NULL) {
+                created = FALSE;
+            }
+        }
+        if (!created) {
+            fprintf(GlobalState.logfile,
+                    "Unable to create the output of a --jobs worker.\n");
+            exit(1);
+        }
+        worker->pid = fork();
+        if (worker->pid < 0) {
+            fprintf(GlobalState.logfile, "Unable to start a --jobs worker.\n");
+            exit(1);
+        }
+        else if (worker->pid == 0) {
+            /* Each worker has its own file offset. */
+            FILE *fpin = fopen(filename, "rb");
+            Boolean processed;
+
+            close(worker->counts_pipe[0]);
+            memset(worker_counts, 0, job->counts_size);
+            if (job->start_worker != NULL) {
+                (*job->start_worker)(worker->outputs);
+            }
+            processed = fpin != NULL &&
+                    process_line_range(fpin, size * job_number / num_jobs,
+                                       size * (job_number + 1) / num_jobs,
+                                       job, worker->outputs, worker_counts);
+            for (i = 0; i < job->num_outputs; i++) {
+                if (worker->outputs[i] != NULL &&
+                        (fflush(worker->outputs[i]) != 0 ||
+                         ferror(worker->outputs[i]))) {
+                    processed = FALSE;
+                }
+            }
+            if (write(worker->counts_pipe[1], worker_counts,
+                      job->counts_size) != (ssize_t) job->counts_size) {
+                processed = FALSE;
+            }
+            fflush(GlobalState.logfile);
+            _exit(processed ? 0 : 1);
+        }
+        close(worker->counts_pipe[1]);
+    }
+
+    for (job_number = 0; job_number < num_jobs; job_number++) {
+        Worker *worker = &workers[job_number];
+        int status;
+
+        if (waitpid(worker->pid, &status, 0) != worker->pid ||
+                !WIFEXITED(status) || WEXITSTATUS(status) != 0 ||
+                read(worker->counts_pipe[0], worker_counts,
+                     job->counts_size) != (ssize_t) job->counts_size) {
+            ok = FALSE;
+        }
+        else if (ok) {
+            for (i = 0; i < job->num_outputs; i++) {
+                if (worker->outputs[i] != NULL) {
+                    copy_worker_output(worker->outputs[i], outputs[i]);
+                }
+            }
+            for (i = 0; i < num_counts; i++) {
+                ((unsigned long *) counts)[i] += worker_counts[i];
+            }
+        }
+        close(worker->counts_pipe[0]);
+        for (i = 0; i < job->num_outputs; i++) {
+            if (worker->outputs[i] != NULL) {
+                (void) fclose(worker->outputs[i]);
+            }
+        }
+    }
+    free((void *) worker_counts);
+    free((void *) workers);
+    return ok;
+}
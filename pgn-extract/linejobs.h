@@ -0,0 +1,70 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+/* Parallel processing of a line-oriented input file (--jobs), shared
+ * by --fencsv, --ucilines and --positionfile.
+ * The lines of these inputs are independent of each other, so a
+ * regular file is split at line boundaries into GlobalState.num_jobs
+ * byte ranges that are handled by separate processes.  Each worker
+ * writes to its own temporary files, which are copied to the caller's
+ * outputs in order once every worker has succeeded, so the result is
+ * the same whatever the number of jobs.
+ * Processes rather than threads are used because the board and move
+ * handling of pgn-extract keep their state in static variables.
+ */
+
+#ifndef LINEJOBS_H
+#define LINEJOBS_H
+
+#include <stdio.h>
+#include <sys/types.h>
+
+/* The most outputs that a line may be written to. */
+#define MAX_LINE_JOB_OUTPUTS 2
+
+typedef struct {
+    /* Handle the line of the given length, which has had its line
+     * terminator replaced by a null.  line_number counts from the start
+     * of the range being read.  The results of the line are written to
+     * outputs, any of which may be NULL, and tallied in counts.
+     * Return FALSE if no further lines are wanted.
+     */
+    Boolean (*handle_line)(char *line, size_t length, unsigned long line_number,
+                           FILE *outputs[], void *counts);
+    /* If not NULL, called in each worker, with its outputs, before
+     * its first line.
+     */
+    void (*start_worker)(FILE *outputs[]);
+    /* The number of outputs, at most MAX_LINE_JOB_OUTPUTS. */
+    unsigned num_outputs;
+    /* The size of the counts, a structure of only unsigned long fields,
+     * which are summed over the workers.
+     */
+    size_t counts_size;
+} LineJob;
+
+Boolean process_line_range(FILE *fpin, off_t start, off_t end,
+                           const LineJob *job, FILE *outputs[], void *counts);
+Boolean process_lines_in_parallel(const char *filename, off_t size,
+                                  const LineJob *job, FILE *outputs[],
+                                  void *counts);
+
+#endif	// LINEJOBS_H
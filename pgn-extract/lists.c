@@ -23,6 +23,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdint.h>
 #include <regex.h>
 #include "bool.h"
 #include "mymalloc.h"
@@ -41,6 +42,32 @@ typedef struct tag_selection {
     TagOperator operator;
 } TagSelection;
 
+/* An index of the tag strings of a StringArray that have no operator.
+ * Such a string matches a tag whose value starts with it, so the
+ * strings are held in a hash table and looked up for each prefix of
+ * the tag's value whose length is that of at least one of them.
+ */
+typedef struct {
+    const char *string;
+    size_t length;
+    uint64_t hash;
+} PrefixEntry;
+
+typedef struct {
+    /* Open addressing with linear probing; unused entries have
+     * a NULL string.
+     */
+    PrefixEntry *entries;
+    /* A power of 2. */
+    size_t capacity;
+    size_t count;
+    /* has_length[n] is TRUE if a string of length n is present,
+     * for n <= max_length.
+     */
+    Boolean *has_length;
+    size_t max_length;
+} PrefixIndex;
+
 /* Definitions for maintaining arrays of tag strings.
  * These arrays are used for various purposes:
  *        lists of white/black players to extract on.
@@ -60,6 +87,10 @@ typedef struct {
      * list[num_used_elements] == (char **) NULL once the list is complete.
      */
     TagSelection *tag_strings;
+    /* The strings with operator NONE, or NULL if there are none. */
+    PrefixIndex *prefix_index;
+    /* The numbers of selections with other operators. */
+    unsigned num_regex, num_not_equal, num_relational;
 } StringArray;
 
 typedef struct {
@@ -77,6 +108,7 @@ typedef struct {
 static TagList positive_tags, negative_tags;
 
 static void add_tag_to_list(int tag, const char *tagstr, TagOperator operator, TagList *list);
+static void init_string_array(StringArray *array);
 static Boolean check_Elo_difference(char **tags);
 static Boolean check_list(int tag, const char *tag_string, const StringArray *list);
 static Boolean check_time_period(const char *tag_string, unsigned period, const StringArray *list);
@@ -92,16 +124,24 @@ void init_tag_lists(void)
     positive_tags.list_of_tags = (StringArray *) malloc_or_die(ORIGINAL_NUMBER_OF_TAGS * sizeof (*positive_tags.list_of_tags));
     negative_tags.list_of_tags = (StringArray *) malloc_or_die(ORIGINAL_NUMBER_OF_TAGS * sizeof (*positive_tags.list_of_tags));
     for (i = 0; i < ORIGINAL_NUMBER_OF_TAGS; i++) {
-        positive_tags.list_of_tags[i].num_allocated_elements = 0;
-        positive_tags.list_of_tags[i].num_used_elements = 0;
-        positive_tags.list_of_tags[i].tag_strings = (TagSelection *) NULL;
-
-        negative_tags.list_of_tags[i].num_allocated_elements = 0;
-        negative_tags.list_of_tags[i].num_used_elements = 0;
-        negative_tags.list_of_tags[i].tag_strings = (TagSelection *) NULL;
+        init_string_array(&positive_tags.list_of_tags[i]);
+        init_string_array(&negative_tags.list_of_tags[i]);
     }
 }
 
+/* Initialise array as an empty list. */
+static void
+init_string_array(StringArray *array)
+{
+    array->num_allocated_elements = 0;
+    array->num_used_elements = 0;
+    array->tag_strings = (TagSelection *) NULL;
+    array->prefix_index = NULL;
+    array->num_regex = 0;
+    array->num_not_equal = 0;
+    array->num_relational = 0;
+}
+
 /*
  * Extend the tag list to the new length.
  */
@@ -121,9 +161,7 @@ extend_list_length(TagList *list, int new_length)
         list->list_of_tags = (StringArray *) realloc_or_die((void *) list->list_of_tags,
                 new_length * sizeof (*(list->list_of_tags)));
         for (i = list->list_length; i < new_length; i++) {
-            list->list_of_tags[i].num_allocated_elements = 0;
-            list->list_of_tags[i].num_used_elements = 0;
-            list->list_of_tags[i].tag_strings = (TagSelection *) NULL;
+            init_string_array(&list->list_of_tags[i]);
         }
         list->list_length = new_length;
     }
@@ -154,11 +192,16 @@ add_to_taglist(const char *str, StringArray *list)
             }
         }
         else {
+            /* Grow in proportion to the size of the list, as
+             * tag files can hold many thousands of strings.
+             */
+            unsigned more_space = list->num_allocated_elements > MORE_LIST_SPACE ?
+                    list->num_allocated_elements : MORE_LIST_SPACE;
             list->tag_strings = (TagSelection *) realloc_or_die((void *) list->tag_strings,
-                    (list->num_allocated_elements + MORE_LIST_SPACE + 1) *
+                    (list->num_allocated_elements + more_space + 1) *
                     sizeof (TagSelection));
             if (list->tag_strings != NULL) {
-                list->num_allocated_elements += MORE_LIST_SPACE;
+                list->num_allocated_elements += more_space;
             }
             else {
                 everything_ok = FALSE;
@@ -190,6 +233,143 @@ add_to_taglist(const char *str, StringArray *list)
     }
 }
 
+/* Return the hash of the first length characters of str,
+ * continuing from the hash of those before them.
+ */
+static uint64_t
+prefix_hash(uint64_t hash, const char *str, size_t from, size_t length)
+{
+    for (size_t i = from; i < length; i++) {
+        hash = (hash ^ (unsigned char) str[i]) * UINT64_C(0x100000001b3);
+    }
+    return hash;
+}
+
+/* The hash of the empty string. */
+#define EMPTY_PREFIX_HASH UINT64_C(0xcbf29ce484222325)
+
+/* Return the entry of index for the given prefix of str, which is
+ * either its matching entry or the unused one at which it belongs.
+ */
+static PrefixEntry *
+prefix_index_entry(const PrefixIndex *index, const char *str, size_t length,
+                   uint64_t hash)
+{
+    size_t slot = (size_t) (hash >> 32) & (index->capacity - 1);
+    PrefixEntry *entry = &index->entries[slot];
+
+    while (entry->string != NULL &&
+            (entry->hash != hash || entry->length != length ||
+             memcmp(entry->string, str, length) != 0)) {
+        slot = (slot + 1) & (index->capacity - 1);
+        entry = &index->entries[slot];
+    }
+    return entry;
+}
+
+/* Add str, of the given length and hash, to index. */
+static void
+prefix_index_insert(PrefixIndex *index, const char *str, size_t length, uint64_t hash)
+{
+    PrefixEntry *entry;
+
+    /* Keep the table no more than half full. */
+    if (2 * (index->count + 1) > index->capacity) {
+        PrefixEntry *old_entries = index->entries;
+        size_t old_capacity = index->capacity;
+
+        index->capacity = old_capacity == 0 ? 64 : 2 * old_capacity;
+        index->entries = (PrefixEntry *) malloc_or_die(index->capacity *
+                sizeof(*index->entries));
+        for (size_t slot = 0; slot < index->capacity; slot++) {
+            index->entries[slot].string = NULL;
+        }
+        for (size_t slot = 0; slot < old_capacity; slot++) {
+            if (old_entries[slot].string != NULL) {
+                *prefix_index_entry(index, old_entries[slot].string,
+                        old_entries[slot].length, old_entries[slot].hash) =
+                        old_entries[slot];
+            }
+        }
+        free((void *) old_entries);
+    }
+    entry = prefix_index_entry(index, str, length, hash);
+    if (entry->string == NULL) {
+        entry->string = str;
+        entry->length = length;
+        entry->hash = hash;
+        index->count++;
+        if (index->has_length == NULL || length > index->max_length) {
+            size_t old_length = index->has_length == NULL ? 0 : index->max_length + 1;
+            index->has_length = (Boolean *) realloc_or_die((void *) index->has_length,
+                    (length + 1) * sizeof(*index->has_length));
+            for (size_t n = old_length; n <= length; n++) {
+                index->has_length[n] = FALSE;
+            }
+            index->max_length = length;
+        }
+        index->has_length[length] = TRUE;
+    }
+}
+
+/* Does a string in index match the start of str? */
+static Boolean
+prefix_index_match(const PrefixIndex *index, const char *str)
+{
+    Boolean found = FALSE;
+    uint64_t hash = EMPTY_PREFIX_HASH;
+    size_t length = 0;
+    Boolean more = TRUE;
+
+    while (!found && more) {
+        if (index->has_length[length]) {
+            found = prefix_index_entry(index, str, length, hash)->string != NULL;
+        }
+        more = length < index->max_length && str[length] != '\0';
+        if (more) {
+            hash = prefix_hash(hash, str, length, length + 1);
+            length++;
+        }
+    }
+    return found;
+}
+
+/* Note the selection at index ix of list, whose operator has been set,
+ * in the summary of its selections.
+ */
+static void
+index_selection(StringArray *list, unsigned ix)
+{
+    const TagSelection *selection = &list->tag_strings[ix];
+
+    switch (selection->operator) {
+        case NONE:
+            {
+                size_t length = strlen(selection->tag_string);
+                if (list->prefix_index == NULL) {
+                    list->prefix_index = (PrefixIndex *) malloc_or_die(sizeof(PrefixIndex));
+                    list->prefix_index->entries = NULL;
+                    list->prefix_index->capacity = 0;
+                    list->prefix_index->count = 0;
+                    list->prefix_index->has_length = NULL;
+                    list->prefix_index->max_length = 0;
+                }
+                prefix_index_insert(list->prefix_index, selection->tag_string, length,
+                        prefix_hash(EMPTY_PREFIX_HASH, selection->tag_string, 0, length));
+            }
+            break;
+        case REGEX:
+            list->num_regex++;
+            break;
+        case NOT_EQUAL_TO:
+            list->num_not_equal++;
+            break;
+        default:
+            list->num_relational++;
+            break;
+    }
+}
+
 /* Simple soundex code supplied by John Brogan
  * (jwbrogan@unix2.netaxs.com), 26th Aug 1994.
  * John writes:
@@ -332,6 +512,7 @@ add_tag_to_list(int tag, const char *tagstr, TagOperator operator, TagList *list
         ix = add_to_taglist(string_to_store, &(list->list_of_tags[tag]));
         if (ix >= 0) {
             list->list_of_tags[tag].tag_strings[ix].operator = operator;
+            index_selection(&list->list_of_tags[tag], (unsigned) ix);
         }
         /* Ensure that we know we are checking tags. */
         GlobalState.check_tags = TRUE;
@@ -743,35 +924,44 @@ check_list(int tag, const char *tag_string, const StringArray *list)
     }
     tag_string_is_numeric = *t == '\0';
 
-    for (list_index = 0; (list_index < list->num_used_elements) && ! wanted; list_index++) {
-        const TagSelection *selection = &list->tag_strings[list_index];
-        const char *list_string = selection->tag_string;
+    if (list->prefix_index != NULL && !GlobalState.tag_match_anywhere) {
+        /* Match only at the beginning of the tag. */
+        wanted = prefix_index_match(list->prefix_index, search_str);
+        possible_range_check = list->num_not_equal > 0 ||
+                (list->num_relational > 0 && tag_string_is_numeric);
+        possible_regex_check = list->num_regex > 0;
+    }
+    else {
+        for (list_index = 0; (list_index < list->num_used_elements) && ! wanted; list_index++) {
+            const TagSelection *selection = &list->tag_strings[list_index];
+            const char *list_string = selection->tag_string;
 
-        if(selection->operator == NONE) {
-            if (GlobalState.tag_match_anywhere) {
-                /* Match anywhere in the tag. */
-                if (strstr(search_str, list_string) != NULL) {
-                    wanted = TRUE;
+            if(selection->operator == NONE) {
+                if (GlobalState.tag_match_anywhere) {
+                    /* Match anywhere in the tag. */
+                    if (strstr(search_str, list_string) != NULL) {
+                        wanted = TRUE;
+                    }
                 }
-            }
-            else {
-                /* Match only at the beginning of the tag. */
-                if (strncmp(search_str, list_string, strlen(list_string)) == 0) {
-                    wanted = TRUE;
+                else {
+                    /* Match only at the beginning of the tag. */
+                    if (strncmp(search_str, list_string, strlen(list_string)) == 0) {
+                        wanted = TRUE;
+                    }
                 }
             }
-        }
-        else if(selection->operator == NOT_EQUAL_TO) {
-            /* Can be applied to non-numeric tags. */
-            possible_range_check = TRUE;
-        }
-        else if(selection->operator == REGEX) {
-            /* Defer to a later check. */
-            possible_regex_check = TRUE;
-        }
-        else if(! possible_range_check && tag_string_is_numeric) {
-            /* Defer to a later check. */
-            possible_range_check = TRUE;
+            else if(selection->operator == NOT_EQUAL_TO) {
+                /* Can be applied to non-numeric tags. */
+                possible_range_check = TRUE;
+            }
+            else if(selection->operator == REGEX) {
+                /* Defer to a later check. */
+                possible_regex_check = TRUE;
+            }
+            else if(! possible_range_check && tag_string_is_numeric) {
+                /* Defer to a later check. */
+                possible_range_check = TRUE;
+            }
         }
     }
     if(! wanted) {
@@ -38,6 +38,11 @@
 #include "grammar.h"
 #include "hashing.h"
 #include "argsfile.h"
+#include "evaluator.h"
+#include "fencsv.h"
+#include "ucilines.h"
+#include "positionfile.h"
+#include "ecocache.h"
 
 /* The maximum length of an output line.  This is conservatively
  * slightly smaller than the PGN export standard of 80.
@@ -88,6 +93,9 @@ StateInfo GlobalState = {
     TRUE,               /* keep_results (--noresults) */
     TRUE,               /* keep_checks (--nochecks) */
     FALSE,              /* output_evaluation (--evaluation) */
+    FALSE,              /* fen_csv_input (--fencsv) */
+    FALSE,              /* uci_lines_input (--ucilines) */
+    FALSE,              /* quiet_positions_only (--quietpositions) */
     FALSE,              /* keep_broken_games (--keepbroken) */
     FALSE,              /* suppress_redundant_ep_info (--nofauxep) */
     FALSE,              /* json_format (--json) */
@@ -107,6 +115,9 @@ StateInfo GlobalState = {
     10000,              /* upper_move_bound */
     -1,                 /* output_ply_limit (--plylimit) */
     0,                  /* stability_threshold (--stable) */
+    1,                  /* num_jobs (--jobs) */
+    0,                  /* pv_depth (--pvdepth) */
+    0,                  /* augment (--augment) */
     1,                  /* first */
     ~0,                 /* game_limit */
     0,                  /* maximum_matches */
@@ -146,11 +157,17 @@ StateInfo GlobalState = {
     (char *) NULL,      /* line_number_marker (--linenumbers) */
     (char *) NULL,      /* current_input_file */
     DEFAULT_ECO_FILE,   /* eco_file (-e) */
+    (char *) NULL,      /* eco_cache_file (--ecocache) */
+    (char *) NULL,      /* eval_plugin (--evalplugin) */
+    (char *) NULL,      /* checkpoint_file (--checkpoint) */
     (FILE *) NULL,      /* outputfile (-o, -a). Default is stdout */
     (char *) NULL,      /* output_filename (-o, -a) */
     (FILE *) NULL,      /* logfile (-l). Default is stderr */
     (FILE *) NULL,      /* duplicate_file (-d) */
     (FILE *) NULL,      /* non_matching_file (-n) */
+    (FILE *) NULL,      /* split_file (--split) */
+    0.0,                /* split_ratio (--split) */
+    0,                  /* split_seed (--splitseed) */
     NULL,               /* matching_game_numbers */
     NULL,               /* next_game_number_to_output */
     NULL,               /* skip_game_numbers */
@@ -170,6 +187,7 @@ int
 main(int argc, char *argv[])
 {
     int argnum;
+    Boolean input_remains = TRUE;
 
     /* Prepare global state. */
     init_default_global_state();
@@ -402,17 +420,116 @@ main(int argc, char *argv[])
         }
     }
 
+    if (GlobalState.fen_csv_input) {
+        if (GlobalState.output_format == SAN) {
+            GlobalState.output_format = BITBOARDS;
+        }
+        else if (GlobalState.output_format != BITBOARDS &&
+                GlobalState.output_format != PACKED) {
+            fprintf(GlobalState.logfile,
+                    "--fencsv requires -Wbitboards or -Wpacked output.\n");
+            exit(1);
+        }
+        if (GlobalState.checkpoint_file != NULL) {
+            fprintf(GlobalState.logfile,
+                    "--checkpoint cannot be used with --fencsv.\n");
+            exit(1);
+        }
+    }
+    else if (GlobalState.output_format == BITBOARDS ||
+            GlobalState.output_format == PACKED) {
+        fprintf(GlobalState.logfile,
+                "-Wbitboards and -Wpacked require --fencsv.\n");
+        exit(1);
+    }
+    else if (GlobalState.augment != 0) {
+        fprintf(GlobalState.logfile, "--augment requires --fencsv.\n");
+        exit(1);
+    }
+    if (GlobalState.uci_lines_input) {
+        if (GlobalState.fen_csv_input) {
+            fprintf(GlobalState.logfile,
+                    "--ucilines cannot be used with --fencsv.\n");
+            exit(1);
+        }
+        else if (GlobalState.checkpoint_file != NULL) {
+            fprintf(GlobalState.logfile,
+                    "--checkpoint cannot be used with --ucilines.\n");
+            exit(1);
+        }
+        else if (GlobalState.num_jobs > 1 &&
+                (GlobalState.json_format || GlobalState.suppress_duplicates ||
+                 GlobalState.suppress_originals ||
+                 GlobalState.duplicate_file != NULL ||
+                 GlobalState.non_matching_file != NULL ||
+                 GlobalState.split_file != NULL ||
+                 GlobalState.games_per_file > 0 ||
+                 GlobalState.ECO_level != DONT_DIVIDE ||
+                 GlobalState.first_game_number > 1 ||
+                 GlobalState.game_limit != (unsigned long) ~0 ||
+                 GlobalState.matching_game_numbers != NULL ||
+                 GlobalState.skip_game_numbers != NULL ||
+                 GlobalState.maximum_matches > 0)) {
+            /* These depend on the games that precede each one. */
+            fprintf(GlobalState.logfile,
+                    "--jobs with --ucilines cannot be used with --json, duplicate detection,\n"
+                    "-n, --split, -#, -E, --firstgame, --gamelimit, --selectonly,\n"
+                    "--skipmatching or --stopafter.\n");
+            exit(1);
+        }
+    }
+    if (GlobalState.quiet_positions_only && !GlobalState.fen_csv_input &&
+            GlobalState.output_format != FEN && GlobalState.output_format != EPD) {
+        fprintf(GlobalState.logfile,
+                "--quietpositions requires -Wfen, -Wepd or --fencsv.\n");
+        exit(1);
+    }
+
+    if (GlobalState.checkpoint_file != NULL) {
+        /* State carried from one game to the next, other than the
+         * game counts, cannot be recorded in a checkpoint.
+         */
+        if (GlobalState.output_filename == NULL) {
+            fprintf(GlobalState.logfile, "--checkpoint requires an output file (-a or -o).\n");
+            exit(1);
+        }
+        else if (GlobalState.suppress_duplicates || GlobalState.suppress_originals ||
+                GlobalState.duplicate_file != NULL || GlobalState.games_per_file > 0 ||
+                GlobalState.json_format || GlobalState.ECO_level != DONT_DIVIDE) {
+            fprintf(GlobalState.logfile,
+                    "--checkpoint cannot be used with -D, -U, -d, -#, -E or --json.\n");
+            exit(1);
+        }
+    }
+
+    if (GlobalState.split_file != NULL &&
+            (GlobalState.json_format || GlobalState.checkpoint_file != NULL)) {
+        fprintf(GlobalState.logfile,
+                "--split cannot be used with --json or --checkpoint.\n");
+        exit(1);
+    }
+
     /* Prepare the hash tables for duplicate detection. */
     init_duplicate_hash_table();
 
+    /* Load the positions of --positionfile, now that --jobs is known. */
+    load_position_files();
+
     if (GlobalState.add_ECO) {
         /* Read in a list of ECO lines in order to classify the games. */
-        if (open_eco_file(GlobalState.eco_file)) {
+        if (GlobalState.eco_cache_file != NULL &&
+                load_eco_cache(GlobalState.eco_cache_file, GlobalState.eco_file)) {
+            /* The lines have already been played out. */
+        }
+        else if (open_eco_file(GlobalState.eco_file)) {
             /* Indicate that the ECO file is currently being parsed. */
             GlobalState.parsing_ECO_file = TRUE;
             yyparse(ECOFILE);
             reset_line_number();
             GlobalState.parsing_ECO_file = FALSE;
+            if (GlobalState.eco_cache_file != NULL) {
+                save_eco_cache(GlobalState.eco_cache_file, GlobalState.eco_file);
+            }
         }
         else {
             fprintf(GlobalState.logfile, "Unable to open the ECO file %s.\n",
@@ -421,12 +538,32 @@ main(int argc, char *argv[])
         }
     }
 
+    if (GlobalState.eval_plugin != NULL) {
+        load_evaluator(GlobalState.eval_plugin);
+    }
+
+    if (GlobalState.fen_csv_input) {
+        /* The input is positions rather than games. */
+        process_fen_csv_files();
+        input_remains = FALSE;
+    }
+    else if (GlobalState.uci_lines_input) {
+        /* Each line is made into a game. */
+        process_uci_line_files();
+        input_remains = FALSE;
+    }
+    else if (GlobalState.checkpoint_file != NULL &&
+            resume_from_checkpoint(&input_remains)) {
+        /* Continue from where a previous run stopped. */
+    }
     /* Open up the first file as the source of input. */
-    if (!open_first_file()) {
+    else if (!open_first_file()) {
         exit(1);
     }
 
-    yyparse(GlobalState.current_file_type);
+    if (input_remains) {
+        yyparse(GlobalState.current_file_type);
+    }
 
     /* @@@ I would prefer this to be somewhere else. */
     if (GlobalState.json_format && !GlobalState.check_only) {
@@ -439,9 +576,14 @@ main(int argc, char *argv[])
         }
     }
 
+    if (GlobalState.eval_plugin != NULL) {
+        close_evaluator();
+    }
+
     /* Remove any temporary files. */
     clear_duplicate_hash_table();
-    if (!GlobalState.suppress_matched && GlobalState.verbosity > 1) {
+    if (!GlobalState.suppress_matched && GlobalState.verbosity > 1 &&
+            !GlobalState.fen_csv_input) {
         fprintf(GlobalState.logfile, "%lu game%s matched out of %lu.\n",
                 GlobalState.num_games_matched,
                 GlobalState.num_games_matched == 1 ? "" : "s",
@@ -33,6 +33,7 @@
 #include "map.h"
 #include "decode.h"
 #include "apply.h"
+#include "end.h"
 
 /* Structures to hold the x,y displacements of the various
  * piece movements.
@@ -227,6 +228,10 @@ make_move(MoveClass class, Col from_col, Rank from_rank, Col to_col, Rank to_ran
     Boolean capture = FALSE;
     /* For a castling move, where is the Rook? */
     Col castling_rook_col;
+    /* A saturated count is not decremented correctly, so
+     * the material of the board must be recounted afterwards.
+     */
+    Boolean recount_material = MATERIAL_SATURATED(board->material_signature);
 
     /* Determine which rook will be moving if castling.
      * Needed for Chess960.
@@ -303,6 +308,7 @@ make_move(MoveClass class, Col from_col, Rank from_rank, Col to_col, Rank to_ran
                 /* This is an ep capture. Remove the intermediate pawn. */
                 board->board[RankConvert(to_rank) - 1][ColConvert(to_col)] = EMPTY;
                 board->weak_hash_value ^= hash_lookup(to_col, to_rank - 1, PAWN, BLACK);
+                board->material_signature -= MATERIAL_UNIT(BLACK, PAWN);
                 board->EnPassant = FALSE;
             }
             else {
@@ -320,6 +326,7 @@ make_move(MoveClass class, Col from_col, Rank from_rank, Col to_col, Rank to_ran
                 /* This is an ep capture. Remove the intermediate pawn. */
                 board->board[RankConvert(to_rank) + 1][ColConvert(to_col)] = EMPTY;
                 board->weak_hash_value ^= hash_lookup(to_col, to_rank + 1, PAWN, WHITE);
+                board->material_signature -= MATERIAL_UNIT(WHITE, PAWN);
                 board->EnPassant = FALSE;
             }
             else {
@@ -331,6 +338,10 @@ make_move(MoveClass class, Col from_col, Rank from_rank, Col to_col, Rank to_ran
     if (class == PAWN_MOVE_WITH_PROMOTION && piece != PAWN) {
         /* Remove the promoted pawn. */
         board->weak_hash_value ^= hash_lookup(from_col, from_rank, PAWN, colour);
+        board->material_signature -= MATERIAL_UNIT(colour, PAWN);
+        if (MATERIAL_COUNT(board->material_signature, colour, piece) < MATERIAL_MAX_COUNT) {
+            board->material_signature += MATERIAL_UNIT(colour, piece);
+        }
     }
     else {
         board->weak_hash_value ^= hash_lookup(from_col, from_rank, piece, colour);
@@ -379,6 +390,7 @@ make_move(MoveClass class, Col from_col, Rank from_rank, Col to_col, Rank to_ran
         if (class != KINGSIDE_CASTLE && class != QUEENSIDE_CASTLE) {
             /* A genuine capture. */
             capture = TRUE;
+            board->material_signature -= MATERIAL_UNIT(removed_colour, removed_piece);
         }
     }
     /* Deal with the half-move clock. */
@@ -412,6 +424,9 @@ make_move(MoveClass class, Col from_col, Rank from_rank, Col to_col, Rank to_ran
         board->board[to_r][to_c + rook_offset] = MAKE_COLOURED_PIECE(colour, ROOK);
         board->weak_hash_value ^= hash_lookup(to_col + rook_offset, to_rank, ROOK, colour);
     }
+    if (recount_material) {
+        board->material_signature = board_material_signature(board);
+    }
 }
 
 /* Find pawn moves matching the to_ and from_ information.
@@ -1776,6 +1791,129 @@ king_move(Move *move_details, Colour colour, Board *board)
     return Ok;
 }
 
+/* Whether the squares strictly between from_r,from_c and to_r,to_c,
+ * which lie on a line, are empty.
+ */
+static Boolean
+clear_path(int from_r, int from_c, int to_r, int to_c, const Board *board)
+{
+    int dr = (to_r > from_r) - (to_r < from_r);
+    int dc = (to_c > from_c) - (to_c < from_c);
+    int r = from_r + dr, c = from_c + dc;
+
+    while (r != to_r || c != to_c) {
+        if (board->board[r][c] != EMPTY) {
+            return FALSE;
+        }
+        r += dr;
+        c += dc;
+    }
+    return TRUE;
+}
+
+/* A fast path for a move whose from and to squares are both given,
+ * as in long algebraic and UCI notation.
+ * Rather than looking for every piece that could reach the destination,
+ * check that the piece on the from square can make the move and
+ * that it does not leave its king in check.
+ * Return TRUE, with the class and piece_to_move of move_details
+ * filled in, if it is legal.
+ * Castling and promotion are left to the general case, as are
+ * illegal moves, so that they are reported in the usual way.
+ */
+static Boolean
+long_algebraic_move(Move *move_details, Colour colour, const Board *board)
+{
+    int from_r = RankConvert(move_details->from_rank);
+    int from_c = ColConvert(move_details->from_col);
+    int to_r = RankConvert(move_details->to_rank);
+    int to_c = ColConvert(move_details->to_col);
+    int dr = to_r - from_r, dc = to_c - from_c;
+    int abs_dr = dr < 0 ? -dr : dr, abs_dc = dc < 0 ? -dc : dc;
+    int direction = colour == WHITE ? 1 : -1;
+    MoveClass class = PIECE_MOVE;
+    Piece mover, occupant, piece;
+    Boolean Ok;
+    Board copy_board;
+
+    if (from_r == 0 || from_c == 0 || to_r == 0 || to_c == 0 ||
+            (dr == 0 && dc == 0)) {
+        return FALSE;
+    }
+    mover = board->board[from_r][from_c];
+    occupant = board->board[to_r][to_c];
+    if (mover == EMPTY || !piece_is_colour(mover, colour) ||
+            (occupant != EMPTY &&
+             (piece_is_colour(occupant, colour) || EXTRACT_PIECE(occupant) == KING))) {
+        return FALSE;
+    }
+    piece = EXTRACT_PIECE(mover);
+    if (move_details->class == PIECE_MOVE && move_details->piece_to_move != piece) {
+        return FALSE;
+    }
+    switch (piece) {
+        case PAWN:
+            class = PAWN_MOVE;
+            if (move_details->to_rank == (colour == WHITE ? LASTRANK : FIRSTRANK)) {
+                Ok = FALSE;
+            }
+            else if (dc == 0) {
+                Ok = occupant == EMPTY &&
+                        (dr == direction ||
+                         (dr == 2 * direction &&
+                          move_details->from_rank == (colour == WHITE ? '2' : '7') &&
+                          board->board[from_r + direction][from_c] == EMPTY));
+            }
+            else if (abs_dc == 1 && dr == direction) {
+                if (occupant != EMPTY) {
+                    Ok = TRUE;
+                }
+                else {
+                    Ok = board->EnPassant &&
+                            board->ep_rank == move_details->to_rank &&
+                            board->ep_col == move_details->to_col;
+                    class = ENPASSANT_PAWN_MOVE;
+                }
+            }
+            else {
+                Ok = FALSE;
+            }
+            break;
+        case KNIGHT:
+            Ok = (abs_dr == 1 && abs_dc == 2) || (abs_dr == 2 && abs_dc == 1);
+            break;
+        case BISHOP:
+            Ok = abs_dr == abs_dc && clear_path(from_r, from_c, to_r, to_c, board);
+            break;
+        case ROOK:
+            Ok = (dr == 0 || dc == 0) && clear_path(from_r, from_c, to_r, to_c, board);
+            break;
+        case QUEEN:
+            Ok = (abs_dr == abs_dc || dr == 0 || dc == 0) &&
+                    clear_path(from_r, from_c, to_r, to_c, board);
+            break;
+        case KING:
+            Ok = abs_dr <= 1 && abs_dc <= 1;
+            break;
+        default:
+            Ok = FALSE;
+            break;
+    }
+    if (Ok) {
+        copy_board = *board;
+        make_move(class, move_details->from_col, move_details->from_rank,
+                move_details->to_col, move_details->to_rank, piece, colour, &copy_board);
+        if (king_is_in_check(&copy_board, colour) == NOCHECK) {
+            move_details->class = class;
+            move_details->piece_to_move = piece;
+        }
+        else {
+            Ok = FALSE;
+        }
+    }
+    return Ok;
+}
+
 /* Try to complete the full set of move information for
  * move details.
  * In the process, several fields of move_details are modified
@@ -1820,13 +1958,20 @@ determine_move_details(Colour colour, Move *move_details, Board *board)
         /* A new piece on promotion. */
         move_details->promoted_piece = EMPTY;
 
+        if ((class == PAWN_MOVE || class == PIECE_MOVE) &&
+                long_algebraic_move(move_details, colour, board)) {
+            /* Fully determined from the from and to squares. */
+            class = move_details->class;
+            Ok = TRUE;
+            move_handled = TRUE;
+        }
         /* Because the decoding process did not have the current board
          * position available, trap apparent pawn moves that may be something
          * else.
          * At the moment, only do this when full positional information is
          * available.
          */
-        if ((class == PAWN_MOVE) &&
+        else if ((class == PAWN_MOVE) &&
                 (move_details->from_col != 0) &&
                 (move_details->from_rank != 0) &&
                 (move_details->to_col != 0) &&
@@ -1838,8 +1983,9 @@ determine_move_details(Colour colour, Move *move_details, Board *board)
         }
 
         /* Deal with apparent pawn moves first. */
-        if ((class == PAWN_MOVE) || (class == ENPASSANT_PAWN_MOVE) ||
-                (class == PAWN_MOVE_WITH_PROMOTION)) {
+        if (!move_handled &&
+                ((class == PAWN_MOVE) || (class == ENPASSANT_PAWN_MOVE) ||
+                 (class == PAWN_MOVE_WITH_PROMOTION))) {
             move_details->piece_to_move = PAWN;
             /* Fill in any promotional details. */
             if (class == PAWN_MOVE) {
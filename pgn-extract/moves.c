@@ -108,6 +108,31 @@ typedef struct variation_list {
 /* The head of the variations-of-interest list. */
 static variation_list *games_to_keep = NULL;
 
+/* Variations without ANY_MOVE or DISALLOWED_MOVE moves are matched
+ * straight by being merged into a trie of their moves, so that the
+ * moves of a game are walked once for all of them rather than once per
+ * variation.  Each edge is labelled with the text of a variant move,
+ * which is shared by the variations that have it at that point.
+ */
+typedef struct variation_trie {
+    /* Whether a variation ends at this point. */
+    Boolean complete;
+    struct trie_edge *edges;
+    unsigned num_edges, max_edges;
+} variation_trie;
+
+typedef struct trie_edge {
+    const char *move;
+    variation_trie *next;
+} trie_edge;
+
+/* The root of the merged variations, or NULL if there are none. */
+static variation_trie *variations_merged = NULL;
+/* Whether eligible variations have been moved from games_to_keep
+ * into variations_merged.
+ */
+static Boolean variations_compiled = FALSE;
+
 static Boolean is_insufficient_material(const Board *board);
 static Boolean textual_variation_match(const char *variation_move,
         const unsigned char *actual_move);
@@ -766,6 +791,99 @@ is_insufficient_material(const Board *board)
     return insufficient_material(board);
 }
 
+/* Can variation be merged into the trie of variations? */
+static Boolean
+mergeable_variation(const variation_list *variation)
+{
+    return variation->num_white_any_moves == 0 &&
+           variation->num_black_any_moves == 0 &&
+           variation->num_white_disallowed_moves == 0 &&
+           variation->num_black_disallowed_moves == 0;
+}
+
+static variation_trie *
+new_variation_trie(void)
+{
+    variation_trie *node = (variation_trie *) malloc_or_die(sizeof(*node));
+    node->complete = FALSE;
+    node->edges = NULL;
+    node->num_edges = node->max_edges = 0;
+    return node;
+}
+
+/* Add the moves of variation to the trie rooted at node. */
+static void
+merge_variation(variation_trie *node, const variation_list *variation)
+{
+    for (unsigned move_index = 0; move_index < variation->length; move_index++) {
+        const char *move = variation->moves[move_index].move;
+        unsigned edge = 0;
+
+        while (edge < node->num_edges && strcmp(node->edges[edge].move, move) != 0) {
+            edge++;
+        }
+        if (edge == node->num_edges) {
+            if (node->num_edges == node->max_edges) {
+                node->max_edges = node->max_edges == 0 ? 2 : 2 * node->max_edges;
+                node->edges = (trie_edge *) realloc_or_die((void *) node->edges,
+                        node->max_edges * sizeof(*node->edges));
+            }
+            node->edges[edge].move = move;
+            node->edges[edge].next = new_variation_trie();
+            node->num_edges++;
+        }
+        node = node->edges[edge].next;
+    }
+    node->complete = TRUE;
+}
+
+/* Move the variations that can be matched straight from
+ * games_to_keep into variations_merged.
+ * This is done once all the arguments have been processed, as
+ * permutation matching is requested independently of the variations.
+ */
+static void
+compile_textual_variations(void)
+{
+    if (!GlobalState.match_permutations) {
+        variation_list **link = &games_to_keep;
+        while (*link != NULL) {
+            variation_list *variation = *link;
+            if (mergeable_variation(variation)) {
+                if (variations_merged == NULL) {
+                    variations_merged = new_variation_trie();
+                }
+                merge_variation(variations_merged, variation);
+                *link = variation->next;
+            }
+            else {
+                link = &variation->next;
+            }
+        }
+    }
+    variations_compiled = TRUE;
+}
+
+/* Do the moves starting at next_move match any of the variations
+ * merged into node?
+ * More than one edge might match the same move, as a variant move
+ * can list alternatives.
+ */
+static Boolean
+merged_match(const variation_trie *node, const Move *next_move)
+{
+    Boolean matches = node->complete;
+
+    if (!matches && next_move != NULL) {
+        for (unsigned edge = 0; edge < node->num_edges && !matches; edge++) {
+            if (textual_variation_match(node->edges[edge].move, next_move->move)) {
+                matches = merged_match(node->edges[edge].next, next_move->next);
+            }
+        }
+    }
+    return matches;
+}
+
 /* Determine whether or not the current game is wanted.
  * It will be if it matches one of the current variations
  * and its tag details match those that we are interested in.
@@ -776,7 +894,10 @@ check_textual_variations(const Game *game_details)
     Boolean wanted = FALSE;
     variation_list *variation;
 
-    if (games_to_keep != NULL) {
+    if (!variations_compiled) {
+        compile_textual_variations();
+    }
+    if (games_to_keep != NULL || variations_merged != NULL) {
         unsigned game_length = 0;
         if(GlobalState.variation_match_anywhere) {
             /* Allow for the starting point of a match to be anywhere
@@ -789,7 +910,10 @@ check_textual_variations(const Game *game_details)
             unsigned moves_left = game_length;
             Boolean variation_left = TRUE;
             while(! wanted && game_position != NULL && variation_left) {
-                variation_left = FALSE;
+                variation_left = variations_merged != NULL;
+                if(variations_merged != NULL) {
+                    wanted = merged_match(variations_merged, game_position);
+                }
                 for(variation = games_to_keep; (variation != NULL) && !wanted;
                         variation = variation->next) {
                     if(variation->length <= moves_left) {
@@ -810,6 +934,9 @@ check_textual_variations(const Game *game_details)
         }
         else {
             /* Only match from the start of the game. */
+            if (variations_merged != NULL) {
+                wanted = merged_match(variations_merged, game_details->moves);
+            }
             for (variation = games_to_keep; (variation != NULL) && !wanted;
                     variation = variation->next) {
                 if (GlobalState.match_permutations) {
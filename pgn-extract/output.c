@@ -35,6 +35,8 @@
 #include "apply.h"
 #include "output.h"
 #include "mymalloc.h"
+#include "bitboard.h"
+#include "see.h"
 
 
 /* Functions for outputting games in the required format. */
@@ -175,6 +177,8 @@ which_output_format(const char *arg)
         { "XOLALG", XOLALG},
         { "xolalg", XOLALG},
         { "uci", UCI},
+        { "bitboards", BITBOARDS},
+        { "packed", PACKED},
         { "cm", CM},
         { "", SOURCE},
         /* Add others before the terminating NULL. */
@@ -219,6 +223,8 @@ output_file_suffix(OutputFormat format)
     static const char EPD_suffix[] = ".epd";
     static const char FEN_suffix[] = ".fen";
     static const char CM_suffix[] = ".cm";
+    static const char CSV_suffix[] = ".csv";
+    static const char packed_suffix[] = ".bin";
 
     switch (format) {
         case SOURCE:
@@ -236,6 +242,10 @@ output_file_suffix(OutputFormat format)
             return FEN_suffix;
         case CM:
             return CM_suffix;
+        case BITBOARDS:
+            return CSV_suffix;
+        case PACKED:
+            return packed_suffix;
         default:
             return PGN_suffix;
     }
@@ -1557,6 +1567,32 @@ print_algebraic_game(Game *current_game, FILE *outputfile,
     }
 }
 
+/* Whether board is to be output: with --quietpositions only
+ * positions without a pending tactic are.
+ */
+static Boolean
+position_wanted(const Board *board)
+{
+    if (GlobalState.quiet_positions_only) {
+        uint64_t pieces[NUM_BITBOARDS];
+
+        board_to_bitboards(board, pieces);
+        return quiet_position(pieces, board->to_move == WHITE ? 0 : 1,
+                              board_ep_square(board));
+    }
+    else {
+        return TRUE;
+    }
+}
+
+/* Whether the position after move is to be output. */
+static Boolean
+EPD_position_wanted(const Move *move)
+{
+    /* Quietness is decided when the EPD is built. */
+    return !GlobalState.quiet_positions_only || move->quiet;
+}
+
 static void
 print_EPD_move_list(Game *current_game, FILE *outputfile,
         unsigned move_number, Boolean white_to_move,
@@ -1572,14 +1608,16 @@ print_EPD_move_list(Game *current_game, FILE *outputfile,
     }
     const Move *move = current_game->moves;
 
-    if (initial_board != NULL) {
+    if (initial_board != NULL && position_wanted(initial_board)) {
         char epd[FEN_SPACE];
         build_basic_EPD_string(initial_board, epd);
         fprintf(outputfile, "%s %s\n", epd, game_comment);
     }
     while (move != NULL) {
         if (move->epd != NULL) {
-            fprintf(outputfile, "%s %s\n", move->epd, game_comment);
+            if (EPD_position_wanted(move)) {
+                fprintf(outputfile, "%s %s\n", move->epd, game_comment);
+            }
         }
         else {
             fprintf(GlobalState.logfile, "Internal error: Missing EPD\n");
@@ -1610,17 +1648,21 @@ static void print_FEN_move_list(Game *current_game, FILE *outputfile,
     }
     else {
         keepPrinting = TRUE;
-        const char *FEN_string = get_FEN_string(board);
-        fprintf(GlobalState.outputfile, "%s\n", FEN_string);
-        free((void *) FEN_string);
+        if (position_wanted(board)) {
+            const char *FEN_string = get_FEN_string(board);
+            fprintf(GlobalState.outputfile, "%s\n", FEN_string);
+            free((void *) FEN_string);
+        }
     }
 
     while (move != NULL && keepPrinting) {
         if (move->move[0] != '\0') {
             if(apply_move(move, board)) {
-                const char *FEN_string = get_FEN_string(board);
-                fprintf(GlobalState.outputfile, "%s\n", FEN_string);
-                free((void *) FEN_string);
+                if (position_wanted(board)) {
+                    const char *FEN_string = get_FEN_string(board);
+                    fprintf(GlobalState.outputfile, "%s\n", FEN_string);
+                    free((void *) FEN_string);
+                }
             }
             else {
                 keepPrinting = FALSE;
@@ -0,0 +1,363 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+/* packtool compress: write a version 2 packed file (packedfile.h) as
+ * a block-compressed container (packedblocks.h).
+ * packtool decompress: the reverse.
+ * In both directions the blocks are handled in parallel by the
+ * pipeline and written in order.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <zstd.h>
+#include "bool.h"
+#include "mymalloc.h"
+#include "packedfile.h"
+#include "packedblocks.h"
+#include "pipeline.h"
+#include "packtool.h"
+
+typedef struct {
+    PackedFile input;
+    PackedBlocksHeader header;
+    int level;
+    FILE *output;
+    const char *output_name;
+    Boolean verbose;
+    /* The offsets of the blocks written so far, and the next. */
+    uint64_t *offsets;
+    unsigned long num_offsets, offsets_space;
+    uint64_t records;
+} CompressContext;
+
+typedef struct {
+    PackedBlocks input;
+    FILE *output;
+    const char *output_name;
+    Boolean verbose;
+    uint64_t records;
+} DecompressContext;
+
+static void compress_usage_and_exit(void);
+static void decompress_usage_and_exit(void);
+static Boolean read_compress_chunk(void *arg, Chunk *chunk);
+static void process_compress_chunk(void *arg, Chunk *chunk);
+static void write_compress_chunk(void *arg, Chunk *chunk);
+static Boolean read_decompress_chunk(void *arg, Chunk *chunk);
+static void process_decompress_chunk(void *arg, Chunk *chunk);
+static void write_decompress_chunk(void *arg, Chunk *chunk);
+static void write_or_die(const void *data, size_t length, FILE *fp, const char *name);
+
+static void
+compress_usage_and_exit(void)
+{
+    fprintf(stderr,
+            "Usage: packtool compress [options] input output\n"
+            "Compress a version 2 packed file into independently readable blocks.\n"
+            "The output may be - for the standard output.\n"
+            "    -b N    records per block (default %d)\n"
+            "    -l N    zstd compression level (default %d)\n"
+            "    -j N    number of worker threads (default: number of processors)\n"
+            "    -q      don't report progress\n",
+            PACKED_BLOCKS_DEFAULT_RECORDS, ZSTD_CLEVEL_DEFAULT);
+    exit(1);
+}
+
+static void
+decompress_usage_and_exit(void)
+{
+    fprintf(stderr,
+            "Usage: packtool decompress [options] input output\n"
+            "Decompress a block-compressed packed file to a version 2 packed file.\n"
+            "The output may be - for the standard output.\n"
+            "    -j N    number of worker threads (default: number of processors)\n"
+            "    -q      don't report progress\n");
+    exit(1);
+}
+
+static void
+write_or_die(const void *data, size_t length, FILE *fp, const char *name)
+{
+    if (fwrite(data, 1, length, fp) != length) {
+        fprintf(stderr, "packtool: error writing %s\n", name);
+        exit(1);
+    }
+}
+
+/* Give each chunk the records of the next block. */
+static Boolean
+read_compress_chunk(void *arg, Chunk *chunk)
+{
+    CompressContext *context = (CompressContext *) arg;
+    uint64_t first = (uint64_t) chunk->sequence * context->header.block_records;
+    uint64_t count = context->input.header.record_count;
+    uint64_t num_records;
+
+    if (first >= count) {
+        return FALSE;
+    }
+    num_records = count - first < context->header.block_records ?
+            count - first : context->header.block_records;
+    chunk->input = (const char *) packed_file_record(&context->input, first);
+    chunk->input_length = (size_t) num_records * context->header.record_size;
+    return TRUE;
+}
+
+static void
+process_compress_chunk(void *arg, Chunk *chunk)
+{
+    const CompressContext *context = (const CompressContext *) arg;
+    size_t bound = packed_block_bound(&context->header);
+    size_t num_records = chunk->input_length / context->header.record_size;
+    char *compressed;
+    size_t length;
+
+    chunk_buffer_space(chunk, chunk->input_length);
+    compressed = chunk_output_space(chunk, bound);
+    length = compress_packed_block(&context->header, chunk->input, num_records,
+                                   context->level, chunk->buffer,
+                                   compressed, bound);
+    if (length == 0) {
+        chunk->errors = 1;
+    }
+    chunk->output_length = length;
+    chunk->records = num_records;
+}
+
+static void
+write_compress_chunk(void *arg, Chunk *chunk)
+{
+    CompressContext *context = (CompressContext *) arg;
+    uint64_t before = context->records;
+
+    if (chunk->errors > 0) {
+        fprintf(stderr, "packtool: unable to compress block %lu\n", chunk->sequence);
+        exit(1);
+    }
+    write_or_die(chunk->output, chunk->output_length, context->output,
+                 context->output_name);
+    if (context->num_offsets == context->offsets_space) {
+        context->offsets_space *= 2;
+        context->offsets = (uint64_t *) realloc_or_die((void *) context->offsets,
+                context->offsets_space * sizeof(*context->offsets));
+    }
+    context->offsets[context->num_offsets] =
+            context->offsets[context->num_offsets - 1] + chunk->output_length;
+    context->num_offsets++;
+    context->records += chunk->records;
+    if (context->verbose &&
+            before / PROGRESS_INTERVAL != context->records / PROGRESS_INTERVAL) {
+        fprintf(stderr, "\rProcessed: %" PRIu64 " records", context->records);
+    }
+}
+
+int
+compress_command(int argc, char *argv[])
+{
+    CompressContext context;
+    Pipeline pipeline;
+    unsigned threads = default_thread_count();
+    unsigned block_records = PACKED_BLOCKS_DEFAULT_RECORDS;
+    unsigned char bytes[PACKED_FILE_HEADER_SIZE];
+    const char *error;
+    unsigned long i;
+    int option;
+
+    memset(&context, 0, sizeof (context));
+    context.level = ZSTD_CLEVEL_DEFAULT;
+    context.verbose = TRUE;
+    while ((option = getopt(argc, argv, "b:l:j:qh")) != -1) {
+        switch (option) {
+            case 'b':
+                if (sscanf(optarg, "%u", &block_records) != 1 || block_records == 0) {
+                    fprintf(stderr, "packtool: invalid block size %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'l':
+                if (sscanf(optarg, "%d", &context.level) != 1 ||
+                        context.level < 1 || context.level > ZSTD_maxCLevel()) {
+                    fprintf(stderr, "packtool: the level must be between 1 and %d\n",
+                            ZSTD_maxCLevel());
+                    exit(1);
+                }
+                break;
+            case 'j':
+                threads = read_thread_count(optarg);
+                break;
+            case 'q':
+                context.verbose = FALSE;
+                break;
+            default:
+                compress_usage_and_exit();
+        }
+    }
+    if (optind + 2 != argc) {
+        compress_usage_and_exit();
+    }
+    error = open_packed_file(argv[optind], &context.input);
+    if (error != NULL) {
+        fprintf(stderr, "packtool: %s: %s\n", argv[optind], error);
+        exit(1);
+    }
+    init_packed_blocks_header(&context.header, context.input.header.pv_depth,
+                              block_records);
+    context.header.record_size = context.input.header.record_size;
+    context.output_name = argv[optind + 1];
+    context.output = open_file_or_die(context.output_name, "wb");
+    encode_packed_blocks_header(&context.header, bytes);
+    write_or_die(bytes, sizeof(bytes), context.output, context.output_name);
+    context.offsets_space = 1024;
+    context.offsets = (uint64_t *) malloc_or_die(context.offsets_space *
+                                                 sizeof(*context.offsets));
+    context.offsets[0] = context.header.header_size;
+    context.num_offsets = 1;
+
+    pipeline.read = read_compress_chunk;
+    pipeline.process = process_compress_chunk;
+    pipeline.write = write_compress_chunk;
+    pipeline.context = &context;
+    run_pipeline(&pipeline, threads);
+
+    for (i = 0; i < context.num_offsets; i++) {
+        encode_packed_blocks_offset(context.offsets[i], bytes);
+        write_or_die(bytes, 8, context.output, context.output_name);
+    }
+    encode_packed_blocks_trailer(context.records,
+                                 context.offsets[context.num_offsets - 1], bytes);
+    write_or_die(bytes, PACKED_BLOCKS_TRAILER_SIZE, context.output, context.output_name);
+    if (context.verbose) {
+        fprintf(stderr, "\nTotal records compressed: %" PRIu64 " into %" PRIu64 " bytes\n",
+                context.records,
+                context.offsets[context.num_offsets - 1] +
+                8 * context.num_offsets + PACKED_BLOCKS_TRAILER_SIZE);
+    }
+    free((void *) context.offsets);
+    close_packed_file(&context.input);
+    close_file_or_die(context.output, context.output_name);
+    return 0;
+}
+
+static Boolean
+read_decompress_chunk(void *arg, Chunk *chunk)
+{
+    const DecompressContext *context = (const DecompressContext *) arg;
+
+    return chunk->sequence < context->input.header.num_blocks;
+}
+
+static void
+process_decompress_chunk(void *arg, Chunk *chunk)
+{
+    const DecompressContext *context = (const DecompressContext *) arg;
+    const PackedBlocksHeader *header = &context->input.header;
+    size_t num_records = packed_block_records(&context->input, chunk->sequence);
+    size_t length = num_records * header->record_size;
+    char *records;
+
+    chunk_buffer_space(chunk, length);
+    records = chunk_output_space(chunk, length);
+    if (read_packed_block(&context->input, chunk->sequence, chunk->buffer,
+                          records) != NULL) {
+        chunk->errors = 1;
+    }
+    chunk->records = num_records;
+}
+
+static void
+write_decompress_chunk(void *arg, Chunk *chunk)
+{
+    DecompressContext *context = (DecompressContext *) arg;
+    uint64_t before = context->records;
+
+    if (chunk->errors > 0) {
+        fprintf(stderr, "packtool: block %lu is corrupt\n", chunk->sequence);
+        exit(1);
+    }
+    write_or_die(chunk->output, chunk->output_length, context->output,
+                 context->output_name);
+    context->records += chunk->records;
+    if (context->verbose &&
+            before / PROGRESS_INTERVAL != context->records / PROGRESS_INTERVAL) {
+        fprintf(stderr, "\rProcessed: %" PRIu64 " records", context->records);
+    }
+}
+
+int
+decompress_command(int argc, char *argv[])
+{
+    DecompressContext context;
+    Pipeline pipeline;
+    unsigned threads = default_thread_count();
+    PackedFileHeader header;
+    unsigned char bytes[PACKED_FILE_HEADER_SIZE];
+    const char *error;
+    int option;
+
+    memset(&context, 0, sizeof (context));
+    context.verbose = TRUE;
+    while ((option = getopt(argc, argv, "j:qh")) != -1) {
+        switch (option) {
+            case 'j':
+                threads = read_thread_count(optarg);
+                break;
+            case 'q':
+                context.verbose = FALSE;
+                break;
+            default:
+                decompress_usage_and_exit();
+        }
+    }
+    if (optind + 2 != argc) {
+        decompress_usage_and_exit();
+    }
+    error = open_packed_blocks(argv[optind], &context.input);
+    if (error != NULL) {
+        fprintf(stderr, "packtool: %s: %s\n", argv[optind], error);
+        exit(1);
+    }
+    context.output_name = argv[optind + 1];
+    context.output = open_file_or_die(context.output_name, "wb");
+    init_packed_file_header(&header, context.input.header.pv_depth,
+                            context.input.header.record_count);
+    header.record_size = context.input.header.record_size;
+    encode_packed_file_header(&header, bytes);
+    write_or_die(bytes, sizeof(bytes), context.output, context.output_name);
+
+    pipeline.read = read_decompress_chunk;
+    pipeline.process = process_decompress_chunk;
+    pipeline.write = write_decompress_chunk;
+    pipeline.context = &context;
+    run_pipeline(&pipeline, threads);
+
+    if (context.verbose) {
+        fprintf(stderr, "\nTotal records decompressed: %" PRIu64 "\n", context.records);
+    }
+    close_packed_blocks(&context.input);
+    close_file_or_die(context.output, context.output_name);
+    return 0;
+}
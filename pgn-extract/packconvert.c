@@ -0,0 +1,292 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+/* packtool convert: convert a version 1 packed file, as written by
+ * pack_dataset.py and packtool pack, to version 2 (packedfile.h).
+ * packtool info: describe a version 2 file or a block-compressed one
+ * (packedblocks.h), optionally listing its records, using the readers
+ * of packedfile.c and packedblocks.c.
+ *
+ * The conversion is a byte shuffle that runs at the speed of the
+ * memory and the disk, so it is not worth dividing between threads.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include "bool.h"
+#include "mymalloc.h"
+#include "packed.h"
+#include "packedfile.h"
+#include "packedblocks.h"
+#include "packtool.h"
+
+/* The number of records converted between writes. */
+#define BATCH_RECORDS 4096
+
+static void convert_usage_and_exit(void);
+static void info_usage_and_exit(void);
+static void print_record(const PackedFileRecord *record, unsigned pv_depth);
+static Boolean is_block_file(const char *filename);
+static void describe_packed_file(const char *filename, Boolean list_records);
+static void describe_packed_blocks(const char *filename, Boolean list_records);
+
+static void
+convert_usage_and_exit(void)
+{
+    fprintf(stderr,
+            "Usage: packtool convert [options] input output\n"
+            "Convert a version 1 packed file (>QQQQQQQQQQQQbbbe[H...]) to version 2.\n"
+            "The output may be - for the standard output.\n"
+            "    -p N    depth of the principal variation in the input (default 0)\n"
+            "    -q      don't report progress\n");
+    exit(1);
+}
+
+int
+convert_command(int argc, char *argv[])
+{
+    unsigned pv_depth = 0;
+    Boolean verbose = TRUE;
+    const char *input_name, *output_name;
+    FILE *input, *output;
+    const char *mapped = NULL;
+    size_t mapped_length = 0;
+    size_t input_size, output_size;
+    uint64_t count, index;
+    PackedFileHeader header;
+    unsigned char header_bytes[PACKED_FILE_HEADER_SIZE];
+    unsigned char *batch;
+    int option;
+
+    while ((option = getopt(argc, argv, "p:qh")) != -1) {
+        switch (option) {
+            case 'p':
+                pv_depth = read_pv_depth(optarg);
+                break;
+            case 'q':
+                verbose = FALSE;
+                break;
+            default:
+                convert_usage_and_exit();
+        }
+    }
+    if (optind + 2 != argc) {
+        convert_usage_and_exit();
+    }
+    input_name = argv[optind];
+    output_name = argv[optind + 1];
+    input_size = packed_record_size(pv_depth);
+    output_size = packed_file_record_size(pv_depth);
+
+    input = open_file_or_die(input_name, "rb");
+    if (input == stdin || (mapped = map_file(input, &mapped_length)) == NULL) {
+        /* The record count in the header must be known in advance. */
+        fprintf(stderr, "packtool: %s must be a non-empty regular file\n",
+                input_name);
+        exit(1);
+    }
+    if (mapped_length % input_size != 0) {
+        fprintf(stderr,
+                "packtool: the size of %s is not a multiple of %lu bytes; "
+                "check the pv depth (-p)\n",
+                input_name, (unsigned long) input_size);
+        exit(1);
+    }
+    count = mapped_length / input_size;
+
+    output = open_file_or_die(output_name, "wb");
+    init_packed_file_header(&header, pv_depth, count);
+    encode_packed_file_header(&header, header_bytes);
+    fwrite(header_bytes, 1, sizeof(header_bytes), output);
+
+    batch = (unsigned char *) malloc_or_die(BATCH_RECORDS * output_size);
+    for (index = 0; index < count; ) {
+        size_t records = 0;
+
+        while (records < BATCH_RECORDS && index < count) {
+            PackedRecord record;
+
+            decode_packed_record((const unsigned char *) mapped + index * input_size,
+                                 pv_depth, &record);
+            encode_packed_file_record(&record, pv_depth, batch + records * output_size);
+            records++;
+            index++;
+        }
+        if (fwrite(batch, output_size, records, output) != records) {
+            fprintf(stderr, "packtool: error writing %s\n", output_name);
+            exit(1);
+        }
+        if (verbose && index % PROGRESS_INTERVAL < records) {
+            fprintf(stderr, "\rProcessed: %" PRIu64 " records", index);
+        }
+    }
+    if (verbose) {
+        fprintf(stderr, "\nTotal records converted: %" PRIu64 "\n", count);
+    }
+    free((void *) batch);
+    unmap_file(mapped, mapped_length);
+    close_file_or_die(input, input_name);
+    close_file_or_die(output, output_name);
+    return 0;
+}
+
+static void
+info_usage_and_exit(void)
+{
+    fprintf(stderr,
+            "Usage: packtool info [options] file\n"
+            "Describe a version 2 or block-compressed packed file.\n"
+            "    -r      list the records: the bitboards in hexadecimal, side to move,\n"
+            "            castling, en-passant square, score in pawns and pv moves\n");
+    exit(1);
+}
+
+static void
+print_record(const PackedFileRecord *record, unsigned pv_depth)
+{
+    unsigned i;
+
+    for (i = 0; i < PACKED_NUM_BITBOARDS; i++) {
+        printf("%016" PRIx64 ",", record->pieces[i]);
+    }
+    printf("%d,%d,%d,%g", record->side_to_move, record->castling,
+           record->ep_square, half_to_double(record->score));
+    for (i = 0; i < pv_depth; i++) {
+        printf(",%u", (unsigned) record->pv[i]);
+    }
+    putchar('\n');
+}
+
+/* Whether filename starts with the magic of a block-compressed file. */
+static Boolean
+is_block_file(const char *filename)
+{
+    FILE *fp = open_file_or_die(filename, "rb");
+    char magic[PACKED_FILE_MAGIC_LENGTH];
+    Boolean blocks = fread(magic, 1, sizeof(magic), fp) == sizeof(magic) &&
+            memcmp(magic, PACKED_BLOCKS_MAGIC, sizeof(magic)) == 0;
+
+    close_file_or_die(fp, filename);
+    return blocks;
+}
+
+static void
+describe_packed_file(const char *filename, Boolean list_records)
+{
+    PackedFile file;
+    const char *error = open_packed_file(filename, &file);
+
+    if (error != NULL) {
+        fprintf(stderr, "packtool: %s: %s\n", filename, error);
+        exit(1);
+    }
+    printf("version %u\nheader size %u\nrecord size %u\npv depth %u\nrecords %" PRIu64 "\n",
+           (unsigned) file.header.version, (unsigned) file.header.header_size,
+           (unsigned) file.header.record_size, (unsigned) file.header.pv_depth,
+           file.header.record_count);
+    if (list_records) {
+        uint64_t index;
+
+        for (index = 0; index < file.header.record_count; index++) {
+            print_record(packed_file_record(&file, index), file.header.pv_depth);
+        }
+    }
+    close_packed_file(&file);
+}
+
+static void
+describe_packed_blocks(const char *filename, Boolean list_records)
+{
+    PackedBlocks file;
+    const char *error = open_packed_blocks(filename, &file);
+    const PackedBlocksHeader *header = &file.header;
+
+    if (error != NULL) {
+        fprintf(stderr, "packtool: %s: %s\n", filename, error);
+        exit(1);
+    }
+    printf("block-compressed version %u\nheader size %u\nrecord size %u\npv depth %u\n"
+           "records %" PRIu64 "\nrecords per block %u\nblocks %" PRIu64 "\n",
+           (unsigned) header->version, (unsigned) header->header_size,
+           (unsigned) header->record_size, (unsigned) header->pv_depth,
+           header->record_count, (unsigned) header->block_records, header->num_blocks);
+    if (list_records) {
+        size_t block_length = (size_t) header->block_records * header->record_size;
+        unsigned char *scratch = (unsigned char *) malloc_or_die(block_length);
+        unsigned char *records = (unsigned char *) malloc_or_die(block_length);
+        uint64_t block;
+
+        for (block = 0; block < header->num_blocks; block++) {
+            size_t num_records = packed_block_records(&file, block);
+            size_t i;
+
+            error = read_packed_block(&file, block, scratch, records);
+            if (error != NULL) {
+                fprintf(stderr, "packtool: %s: block %" PRIu64 ": %s\n",
+                        filename, block, error);
+                exit(1);
+            }
+            for (i = 0; i < num_records; i++) {
+                print_record((const PackedFileRecord *) (records + i * header->record_size),
+                             header->pv_depth);
+            }
+        }
+        free((void *) scratch);
+        free((void *) records);
+    }
+    close_packed_blocks(&file);
+}
+
+int
+info_command(int argc, char *argv[])
+{
+    Boolean list_records = FALSE;
+    int option;
+
+    while ((option = getopt(argc, argv, "rh")) != -1) {
+        switch (option) {
+            case 'r':
+                list_records = TRUE;
+                break;
+            default:
+                info_usage_and_exit();
+        }
+    }
+    if (optind + 1 != argc) {
+        info_usage_and_exit();
+    }
+    if (is_block_file(argv[optind])) {
+        describe_packed_blocks(argv[optind], list_records);
+    }
+    else {
+        describe_packed_file(argv[optind], list_records);
+    }
+    if (fflush(stdout) != 0) {
+        fprintf(stderr, "packtool: error writing the standard output\n");
+        exit(1);
+    }
+    return 0;
+}
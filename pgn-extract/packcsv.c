@@ -0,0 +1,592 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+/* packtool pack: pack a CSV of bitboards into the records of packed.h,
+ * producing exactly the same file as dataset-generation/pack_dataset.py.
+ * Each row has 17 + pv-depth fields:
+ *     12 bitboards as strings of binary digits,
+ *     side to move, castling rights, en-passant square,
+ *     search depth (ignored), score in centipawns,
+ *     pv-depth encoded moves.
+ *
+ * The input is mapped into memory where possible and divided into
+ * chunks of rows that are packed in parallel and written in order.
+ * As with the Python script, the first malformed row stops the run,
+ * after the rows before it have been written.
+ * With -a, each record is followed by its colour-flipped and mirrored
+ * forms, so that the loader need not augment the data every epoch.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include "bool.h"
+#include "mymalloc.h"
+#include "packed.h"
+#include "pipeline.h"
+#include "packtool.h"
+
+/* The amount of input in each chunk handed to a worker. */
+#define CHUNK_SIZE (4 * 1024 * 1024)
+/* The number of fields before the moves. */
+#define FIXED_FIELDS 17
+/* The index of the score field. */
+#define SCORE_FIELD 16
+#define MAX_FIELDS (FIXED_FIELDS + PACKED_MAX_PV_DEPTH)
+/* The longest field that is parsed as a number. */
+#define MAX_NUMBER_LENGTH 100
+
+typedef struct {
+    FILE *input;
+    const char *input_name;
+    const char *mapped;
+    size_t mapped_length;
+    LineSource lines;
+    Boolean skip_header;
+    unsigned pv_depth;
+    /* PACKED_AUGMENT_ bits. */
+    unsigned augment;
+    FILE *output;
+    const char *output_name;
+    Boolean verbose;
+    unsigned long rows;
+} PackContext;
+
+/* The fields of a row. */
+typedef struct {
+    const char *start[MAX_FIELDS];
+    size_t length[MAX_FIELDS];
+    /* The number of fields, which may exceed MAX_FIELDS. */
+    unsigned count;
+} Fields;
+
+/* The reason why a chunk could not be completely packed,
+ * passed from process to write as the chunk's result.
+ */
+typedef struct {
+    /* The message, in the form printed by pack_dataset.py. */
+    char message[200];
+    /* Whether the message is reported with a line number. */
+    Boolean fatal;
+} PackError;
+
+static void usage_and_exit(void);
+static size_t fill_input(void *source, char *space, size_t size);
+static Boolean read_pack_chunk(void *arg, Chunk *chunk);
+static void process_pack_chunk(void *arg, Chunk *chunk);
+static void write_pack_chunk(void *arg, Chunk *chunk);
+static Boolean split_fields(const char *line, size_t length, Fields *fields);
+static unsigned pack_row(const PackContext *context, const Fields *fields,
+                         unsigned char *bytes, PackError *error);
+static Boolean parse_bitboard(const char *field, size_t length, uint64_t *value,
+                              PackError *error);
+static Boolean parse_integer(const char *field, size_t length, long min, long max,
+                             long *value, PackError *error);
+static Boolean parse_digits(const char *field, size_t length, unsigned base,
+                            Boolean *negative, uint64_t *value, Boolean *overflow);
+static void trim(const char **field, size_t *length);
+static void set_error(PackError *error, Boolean fatal, const char *format,
+                      const char *field, size_t length);
+
+static void
+usage_and_exit(void)
+{
+    fprintf(stderr,
+            "Usage: packtool pack [options] -i input -o output\n"
+            "Pack CSV rows of bitboards into >QQQQQQQQQQQQbbbe[H...] records.\n"
+            "Either file may be - for the standard input or output.\n"
+            "    -s      skip the first row (header) of the CSV file\n"
+            "    -p N    depth of the principal variation to encode (default 0)\n"
+            "    -a A    add the augmentations A of each record: flip, mirror or flip,mirror\n"
+            "    -j N    number of worker threads (default %u)\n"
+            "    -q      no progress report\n",
+            default_thread_count());
+    exit(1);
+}
+
+static size_t
+fill_input(void *source, char *space, size_t size)
+{
+    PackContext *context = (PackContext *) source;
+
+    return fread(space, 1, size, context->input);
+}
+
+static Boolean
+read_pack_chunk(void *arg, Chunk *chunk)
+{
+    PackContext *context = (PackContext *) arg;
+
+    if (!read_line_chunk(&context->lines, chunk, CHUNK_SIZE)) {
+        return FALSE;
+    }
+    if (context->skip_header) {
+        /* The header is the first line of the first chunk. */
+        const char *newline = memchr(chunk->input, '\n', chunk->input_length);
+        size_t header = newline != NULL ? (size_t) (newline + 1 - chunk->input)
+                                        : chunk->input_length;
+        chunk->input += header;
+        chunk->input_length -= header;
+        context->skip_header = FALSE;
+    }
+    return TRUE;
+}
+
+static void
+process_pack_chunk(void *arg, Chunk *chunk)
+{
+    const PackContext *context = (const PackContext *) arg;
+    size_t record_size = packed_record_size(context->pv_depth);
+    const char *line = chunk->input;
+    const char *end = chunk->input + chunk->input_length;
+    PackError *error = NULL;
+    PackError row_error;
+    Fields fields;
+
+    while (line < end && error == NULL) {
+        const char *next = memchr(line, '\n', end - line);
+        size_t length;
+
+        if (next == NULL) {
+            next = end;
+        }
+        length = next - line;
+        if (length > 0 && line[length - 1] == '\r') {
+            length--;
+        }
+        if (!split_fields(line, length, &fields)) {
+            set_error(&row_error, FALSE, "conversion failed: unterminated quoted field", "", 0);
+            error = &row_error;
+        }
+        else if (fields.count != FIXED_FIELDS + context->pv_depth) {
+            sprintf(row_error.message, "has %u fields; expected %u",
+                    fields.count, FIXED_FIELDS + context->pv_depth);
+            row_error.fatal = FALSE;
+            error = &row_error;
+        }
+        else {
+            unsigned char records[PACKED_MAX_VARIANTS *
+                                  (PACKED_RECORD_SIZE + 2 * PACKED_MAX_PV_DEPTH)];
+            unsigned num_records = pack_row(context, &fields, records, &row_error);
+
+            if (num_records > 0) {
+                chunk_output(chunk, (const char *) records, num_records * record_size);
+                chunk->records++;
+            }
+            else {
+                error = &row_error;
+            }
+        }
+        line = next + 1;
+    }
+    if (error != NULL) {
+        /* Processing stopped at the row in error. */
+        chunk->result = malloc_or_die(sizeof (*error));
+        memcpy(chunk->result, error, sizeof (*error));
+        chunk->errors = 1;
+    }
+}
+
+static void
+write_pack_chunk(void *arg, Chunk *chunk)
+{
+    PackContext *context = (PackContext *) arg;
+    unsigned long before = context->rows;
+
+    if (fwrite(chunk->output, 1, chunk->output_length, context->output) !=
+            chunk->output_length) {
+        fprintf(stderr, "packtool: error writing %s\n", context->output_name);
+        exit(1);
+    }
+    context->rows += chunk->records;
+    if (chunk->result != NULL) {
+        const PackError *error = (const PackError *) chunk->result;
+
+        close_file_or_die(context->output, context->output_name);
+        if (error->fatal) {
+            fprintf(stderr, "Fatal error: %s\n", error->message);
+        }
+        else {
+            fprintf(stderr, "Error: Line %lu %s\n", context->rows + 1, error->message);
+        }
+        exit(1);
+    }
+    if (context->verbose &&
+            before / PROGRESS_INTERVAL != context->rows / PROGRESS_INTERVAL) {
+        fprintf(stderr, "\rProcessed: %lu rows", context->rows);
+    }
+}
+
+/* Divide line into fields, following the quoting rules of Python's
+ * csv module.  Return FALSE if a quoted field is not terminated.
+ */
+static Boolean
+split_fields(const char *line, size_t length, Fields *fields)
+{
+    const char *p = line, *end = line + length;
+
+    fields->count = 0;
+    if (length == 0) {
+        /* The csv module returns an empty row. */
+        return TRUE;
+    }
+    for (;;) {
+        const char *start = p;
+        size_t field_length;
+
+        if (p < end && *p == '"') {
+            /* Quoted. */
+            for (p++; p < end && !(*p == '"' && (p + 1 == end || p[1] != '"')); p++) {
+                if (*p == '"') {
+                    p++;
+                }
+            }
+            if (p == end) {
+                return FALSE;
+            }
+            p++;
+            if (p == end || *p == ',') {
+                /* Remove the quotes.  Any doubled quotes within
+                 * are left, since no number contains them.
+                 */
+                start++;
+                field_length = p - start - 1;
+            }
+            else {
+                while (p < end && *p != ',') {
+                    p++;
+                }
+                field_length = p - start;
+            }
+        }
+        else {
+            while (p < end && *p != ',') {
+                p++;
+            }
+            field_length = p - start;
+        }
+        if (fields->count < MAX_FIELDS) {
+            fields->start[fields->count] = start;
+            fields->length[fields->count] = field_length;
+        }
+        fields->count++;
+        if (p == end) {
+            return TRUE;
+        }
+        p++;
+    }
+}
+
+/* Pack the fields of a row, and any augmentations of it, into bytes.
+ * Return the number of records packed, or 0 if the row is malformed.
+ */
+static unsigned
+pack_row(const PackContext *context, const Fields *fields, unsigned char *bytes,
+         PackError *error)
+{
+    PackedRecord record;
+    PackedRecord variants[PACKED_MAX_VARIANTS];
+    unsigned num_variants, v;
+    char number[MAX_NUMBER_LENGTH + 1];
+    const char *field;
+    size_t length;
+    char *number_end;
+    double score;
+    long value;
+    unsigned f, m;
+
+    for (f = 0; f < PACKED_NUM_BITBOARDS; f++) {
+        if (!parse_bitboard(fields->start[f], fields->length[f],
+                            &record.pieces[f], error)) {
+            return 0;
+        }
+    }
+    if (!parse_integer(fields->start[12], fields->length[12], -128, 127, &value, error)) {
+        return 0;
+    }
+    record.side_to_move = (int8_t) value;
+    if (!parse_integer(fields->start[13], fields->length[13], -128, 127, &value, error)) {
+        return 0;
+    }
+    record.castling = (int8_t) value;
+    if (!parse_integer(fields->start[14], fields->length[14], -128, 127, &value, error)) {
+        return 0;
+    }
+    record.ep_square = (int8_t) value;
+
+    /* float(field) / 100.0 */
+    field = fields->start[SCORE_FIELD];
+    length = fields->length[SCORE_FIELD];
+    trim(&field, &length);
+    if (length == 0 || length > MAX_NUMBER_LENGTH ||
+            memchr(field, 'x', length) != NULL || memchr(field, 'X', length) != NULL) {
+        set_error(error, FALSE, "conversion failed: could not convert string to float: '%.*s'",
+                  fields->start[SCORE_FIELD], fields->length[SCORE_FIELD]);
+        return 0;
+    }
+    memcpy(number, field, length);
+    number[length] = '\0';
+    score = strtod(number, &number_end);
+    if (*number_end != '\0') {
+        set_error(error, FALSE, "conversion failed: could not convert string to float: '%.*s'",
+                  fields->start[SCORE_FIELD], fields->length[SCORE_FIELD]);
+        return 0;
+    }
+    score /= 100.0;
+    record.score = double_to_half(score);
+    if ((record.score & 0x7fff) == 0x7c00 && !isinf(score)) {
+        set_error(error, TRUE, "float too large to pack with e format", "", 0);
+        return 0;
+    }
+
+    for (m = 0; m < context->pv_depth; m++) {
+        f = FIXED_FIELDS + m;
+        if (!parse_integer(fields->start[f], fields->length[f], 0, 65535, &value, error)) {
+            return 0;
+        }
+        record.pv[m] = (uint16_t) value;
+    }
+    num_variants = augment_packed_record(&record, context->pv_depth, context->augment,
+                                         variants);
+    for (v = 0; v < num_variants; v++) {
+        encode_packed_record(&variants[v], context->pv_depth,
+                             bytes + v * packed_record_size(context->pv_depth));
+    }
+    return num_variants;
+}
+
+/* int(field, 2) for a bitboard. */
+static Boolean
+parse_bitboard(const char *field, size_t length, uint64_t *value, PackError *error)
+{
+    Boolean negative, overflow;
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if (length == 64) {
+        /* The usual case: convert eight digits at a time. */
+        uint64_t result = 0;
+        unsigned i;
+
+        for (i = 0; i < 64; i += 8) {
+            uint64_t digits;
+
+            memcpy(&digits, field + i, sizeof (digits));
+            if ((digits & ~0x0101010101010101ull) != 0x3030303030303030ull) {
+                break;
+            }
+            /* Gather the low bit of each byte into the top byte,
+             * the first digit being the most significant.
+             */
+            digits &= 0x0101010101010101ull;
+            result = (result << 8) | ((digits * 0x8040201008040201ull) >> 56);
+        }
+        if (i == 64) {
+            *value = result;
+            return TRUE;
+        }
+    }
+#endif
+    if (!parse_digits(field, length, 2, &negative, value, &overflow)) {
+        set_error(error, FALSE,
+                  "conversion failed: invalid literal for int() with base 2: '%.*s'",
+                  field, length);
+        return FALSE;
+    }
+    else if (overflow || (negative && *value != 0)) {
+        set_error(error, TRUE, "argument out of range", "", 0);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/* int(field), which must be in the range min..max to be packed. */
+static Boolean
+parse_integer(const char *field, size_t length, long min, long max, long *value,
+              PackError *error)
+{
+    Boolean negative, overflow;
+    uint64_t magnitude;
+
+    if (!parse_digits(field, length, 10, &negative, &magnitude, &overflow)) {
+        set_error(error, FALSE,
+                  "conversion failed: invalid literal for int() with base 10: '%.*s'",
+                  field, length);
+        return FALSE;
+    }
+    if (overflow || magnitude > (uint64_t) (negative ? -min : max)) {
+        char range[100];
+        sprintf(range, "%s format requires %ld <= number <= %ld",
+                min < 0 ? "byte" : "ushort", min, max);
+        set_error(error, TRUE, "%.*s", range, strlen(range));
+        return FALSE;
+    }
+    *value = negative ? -(long) magnitude : (long) magnitude;
+    return TRUE;
+}
+
+/* Parse an integer in the given base as Python's int does:
+ * surrounding white space, an optional sign, an optional 0b prefix
+ * in base 2, and single underscores between digits.
+ */
+static Boolean
+parse_digits(const char *field, size_t length, unsigned base,
+             Boolean *negative, uint64_t *value, Boolean *overflow)
+{
+    const char *p, *end;
+    Boolean digit_seen = FALSE;
+
+    trim(&field, &length);
+    p = field;
+    end = field + length;
+    *negative = FALSE;
+    *overflow = FALSE;
+    *value = 0;
+    if (p < end && (*p == '+' || *p == '-')) {
+        *negative = *p == '-';
+        p++;
+    }
+    if (base == 2 && end - p > 2 && p[0] == '0' && (p[1] == 'b' || p[1] == 'B')) {
+        p += 2;
+        /* An underscore may follow the prefix. */
+        if (*p == '_') {
+            p++;
+        }
+    }
+    for (; p < end; p++) {
+        unsigned digit;
+
+        if (*p == '_' && digit_seen && p + 1 < end && p[1] != '_') {
+            continue;
+        }
+        else if (*p < '0' || *p >= (char) ('0' + base)) {
+            return FALSE;
+        }
+        digit = *p - '0';
+        if (*value > (UINT64_MAX - digit) / base) {
+            *overflow = TRUE;
+        }
+        *value = *value * base + digit;
+        digit_seen = TRUE;
+    }
+    return digit_seen;
+}
+
+/* Remove surrounding white space from a field. */
+static void
+trim(const char **field, size_t *length)
+{
+    while (*length > 0 && strchr(" \t\f\v", **field) != NULL) {
+        (*field)++;
+        (*length)--;
+    }
+    while (*length > 0 && strchr(" \t\f\v", (*field)[*length - 1]) != NULL) {
+        (*length)--;
+    }
+}
+
+static void
+set_error(PackError *error, Boolean fatal, const char *format,
+          const char *field, size_t length)
+{
+    if (length > 80) {
+        length = 80;
+    }
+    snprintf(error->message, sizeof (error->message), format, (int) length, field);
+    error->fatal = fatal;
+}
+
+int
+pack_command(int argc, char *argv[])
+{
+    PackContext context;
+    Pipeline pipeline;
+    unsigned threads = default_thread_count();
+    int augment;
+    int option;
+
+    memset(&context, 0, sizeof (context));
+    context.verbose = TRUE;
+    while ((option = getopt(argc, argv, "i:o:sp:a:j:qh")) != -1) {
+        switch (option) {
+            case 'i':
+                context.input_name = optarg;
+                break;
+            case 'o':
+                context.output_name = optarg;
+                break;
+            case 's':
+                context.skip_header = TRUE;
+                break;
+            case 'p':
+                context.pv_depth = read_pv_depth(optarg);
+                break;
+            case 'a':
+                augment = packed_augmentation(optarg);
+                if (augment < 0) {
+                    fprintf(stderr, "packtool: invalid augmentation %s\n", optarg);
+                    exit(1);
+                }
+                context.augment = (unsigned) augment;
+                break;
+            case 'j':
+                threads = read_thread_count(optarg);
+                break;
+            case 'q':
+                context.verbose = FALSE;
+                break;
+            default:
+                usage_and_exit();
+        }
+    }
+    if (optind != argc || context.input_name == NULL || context.output_name == NULL) {
+        usage_and_exit();
+    }
+    context.input = open_file_or_die(context.input_name, "rb");
+    context.output = open_file_or_die(context.output_name, "wb");
+    context.mapped = map_file(context.input, &context.mapped_length);
+    if (context.mapped != NULL) {
+        init_mapped_line_source(&context.lines, context.mapped, context.mapped_length);
+    }
+    else {
+        init_line_source(&context.lines, fill_input, &context);
+    }
+
+    pipeline.read = read_pack_chunk;
+    pipeline.process = process_pack_chunk;
+    pipeline.write = write_pack_chunk;
+    pipeline.context = &context;
+    run_pipeline(&pipeline, threads);
+
+    if (context.verbose) {
+        fprintf(stderr, "\nTotal rows processed: %lu\n", context.rows);
+    }
+    if (context.mapped != NULL) {
+        unmap_file(context.mapped, context.mapped_length);
+    }
+    free_line_source(&context.lines);
+    close_file_or_die(context.input, context.input_name);
+    close_file_or_die(context.output, context.output_name);
+    return 0;
+}
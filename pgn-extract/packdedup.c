@@ -0,0 +1,854 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+/* packtool dedup: remove the repeated positions from one or more packed
+ * files, of either version, merging the evaluations of each position.
+ *
+ * No sort is needed.  The first pass reads the inputs in order and the
+ * pipeline's worker threads hash each record's position (see
+ * packed_position_key) to one of a number of partitions; the records
+ * of each partition are appended in runs to a single temporary file,
+ * as in packtool shuffle.  Equal positions always share a partition,
+ * so the second pass can aggregate each partition independently with
+ * a hash table in memory, on the worker threads, and write the
+ * surviving records partition by partition.
+ *
+ * Within a partition the records keep their input order, so the first
+ * occurrence of a position is well defined whatever the number of
+ * threads.  The number of partitions is chosen so that the partitions
+ * in flight fit within the memory limit; it affects only the order of
+ * the output.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "bool.h"
+#include "mymalloc.h"
+#include "packed.h"
+#include "packedfile.h"
+#include "pipeline.h"
+#include "packtool.h"
+
+/* The default memory limit, in megabytes. */
+#define DEFAULT_MEMORY 1024
+/* The size of the blocks in which the inputs are read. */
+#define READ_BLOCK_SIZE (1 << 20)
+/* Leave room for partitions that are larger than average. */
+#define PARTITION_MARGIN 0.8
+/* The bytes of a record, of either version, that hold the position:
+ * the bitboards, side to move, castling rights and en-passant square.
+ */
+#define POSITION_BYTES (PACKED_NUM_BITBOARDS * 8 + 3)
+/* The offsets of the score in version 1 (big-endian) and
+ * version 2 (little-endian) records.
+ */
+#define V1_SCORE_OFFSET POSITION_BYTES
+#define V2_SCORE_OFFSET (POSITION_BYTES + 1)
+#define V1_PV_OFFSET (V1_SCORE_OFFSET + 2)
+/* Multiplicities of at least this are reported together. */
+#define MAX_MULTIPLICITY 8
+/* The space taken in the first pass by the number of the input, which
+ * precedes the records in a chunk's buffer.
+ */
+#define SOURCE_PREFIX 8
+
+/* How the evaluations of a repeated position are merged. */
+typedef enum {
+    KEEP_FIRST, KEEP_DEEPEST, KEEP_AVERAGE
+} MergeMode;
+
+/* In the temporary file, each record is followed by the number of
+ * its input and its position's key.
+ */
+typedef struct {
+    uint16_t source;
+    uint64_t key;
+} SlotTrailer;
+
+typedef struct {
+    off_t offset;
+    size_t length;
+} Run;
+
+typedef struct {
+    char *buffer;
+    size_t buffered;
+    Run *runs;
+    unsigned long num_runs, runs_space;
+    size_t length;
+} Partition;
+
+/* A distinct position within a partition. */
+typedef struct {
+    uint64_t key;
+    /* The slots of its first occurrence and of the record kept. */
+    uint32_t first, kept;
+    uint32_t count;
+    uint32_t kept_pv_length;
+    double score_sum;
+} Entry;
+
+/* What the second pass's process passes to write. */
+typedef struct {
+    uint64_t *duplicates;
+    uint64_t multiplicity[MAX_MULTIPLICITY + 1];
+} PartitionCounts;
+
+typedef struct {
+    char **input_names;
+    unsigned num_inputs;
+    /* The input being read in the first pass. */
+    unsigned current_input;
+    FILE *input;
+    /* Bytes of a version 1 input read while looking for a header. */
+    unsigned char pending[PACKED_FILE_HEADER_SIZE];
+    size_t pending_length;
+    uint64_t input_records;
+    PackedFileHeader input_header;
+    Boolean format_known;
+    Boolean version2;
+    unsigned pv_depth;
+    size_t record_size;
+    size_t slot_size;
+    MergeMode mode;
+    unsigned long num_partitions;
+    Partition *partitions;
+    size_t run_space;
+    int temp_fd;
+    off_t temp_length;
+    FILE *output;
+    const char *output_name;
+    /* Per input: records read and those that repeat an earlier position. */
+    uint64_t *records;
+    uint64_t *duplicates;
+    uint64_t multiplicity[MAX_MULTIPLICITY + 1];
+    uint64_t read, written;
+    Boolean verbose;
+} DedupContext;
+
+static void usage_and_exit(void);
+static Boolean open_next_input(DedupContext *context);
+static void finish_input(DedupContext *context);
+static unsigned long partition_of(const DedupContext *context, uint64_t key);
+static uint64_t record_key(const DedupContext *context, const char *record);
+static unsigned pv_length(const DedupContext *context, const char *record);
+static double record_score(const DedupContext *context, const char *record);
+static void set_record_score(const DedupContext *context, char *record, double score);
+static void flush_partition(DedupContext *context, Partition *partition);
+static Boolean read_input_chunk(void *arg, Chunk *chunk);
+static void process_input_chunk(void *arg, Chunk *chunk);
+static void write_input_chunk(void *arg, Chunk *chunk);
+static Boolean read_partition_chunk(void *arg, Chunk *chunk);
+static void process_partition_chunk(void *arg, Chunk *chunk);
+static void write_partition_chunk(void *arg, Chunk *chunk);
+static void write_output_header(DedupContext *context, uint64_t record_count);
+static void report(const DedupContext *context);
+
+static void
+usage_and_exit(void)
+{
+    fprintf(stderr,
+            "Usage: packtool dedup [options] input ... output\n"
+            "Keep one record of each position in packed files (version 1 or 2),\n"
+            "which must all have the same version and pv depth, and report how\n"
+            "many were repeated.\n"
+            "    -k first    keep the first evaluation of a position (default)\n"
+            "    -k deepest  keep the evaluation with the longest principal variation\n"
+            "    -k average  keep the first, with the mean of the scores\n"
+            "    -m N    memory limit in megabytes (default %d)\n"
+            "    -P N    number of partitions (default: from the input size and -m)\n"
+            "    -p N    depth of the principal variation of version 1 inputs (default 0)\n"
+            "    -T dir  directory for the temporary file (default $TMPDIR or /tmp)\n"
+            "    -j N    number of worker threads (default: number of processors)\n"
+            "    -q      don't report progress\n",
+            DEFAULT_MEMORY);
+    exit(1);
+}
+
+/* Open the next input, if there is one, and read its header.
+ * Return FALSE if there are no more inputs.
+ */
+static Boolean
+open_next_input(DedupContext *context)
+{
+    const char *name;
+    Boolean version2;
+    size_t length;
+
+    if (context->current_input == context->num_inputs) {
+        return FALSE;
+    }
+    name = context->input_names[context->current_input];
+    context->input = open_file_or_die(name, "rb");
+    context->input_records = 0;
+    length = fread(context->pending, 1, PACKED_FILE_HEADER_SIZE, context->input);
+    version2 = length >= PACKED_FILE_MAGIC_LENGTH &&
+            memcmp(context->pending, PACKED_FILE_MAGIC, PACKED_FILE_MAGIC_LENGTH) == 0;
+    if (version2) {
+        const char *error = decode_packed_file_header(context->pending, length,
+                                                      &context->input_header);
+        size_t extension;
+
+        if (error != NULL) {
+            fprintf(stderr, "packtool: %s: %s\n", name, error);
+            exit(1);
+        }
+        for (extension = context->input_header.header_size - PACKED_FILE_HEADER_SIZE;
+                extension > 0; extension--) {
+            if (getc(context->input) == EOF) {
+                fprintf(stderr, "packtool: %s: the header is incomplete\n", name);
+                exit(1);
+            }
+        }
+        length = 0;
+    }
+    if (!context->format_known) {
+        context->format_known = TRUE;
+        context->version2 = version2;
+        if (version2) {
+            context->pv_depth = context->input_header.pv_depth;
+            context->record_size = context->input_header.record_size;
+        }
+        else {
+            context->record_size = packed_record_size(context->pv_depth);
+        }
+    }
+    else if (version2 != context->version2 ||
+            (version2 && (context->input_header.pv_depth != context->pv_depth ||
+                          context->input_header.record_size != context->record_size))) {
+        fprintf(stderr, "packtool: %s has a different format from %s\n",
+                name, context->input_names[0]);
+        exit(1);
+    }
+    context->pending_length = length;
+    return TRUE;
+}
+
+/* Check and close the input that has been read. */
+static void
+finish_input(DedupContext *context)
+{
+    const char *name = context->input_names[context->current_input];
+
+    if (ferror(context->input)) {
+        fprintf(stderr, "packtool: error reading %s\n", name);
+        exit(1);
+    }
+    else if (context->pending_length != 0 ||
+            (context->version2 &&
+             context->input_records != context->input_header.record_count)) {
+        fprintf(stderr, "packtool: %s does not hold a whole number of records%s\n",
+                name,
+                context->version2 ? " or its header is wrong" : "; check the pv depth (-p)");
+        exit(1);
+    }
+    close_file_or_die(context->input, name);
+    context->input = NULL;
+    context->records[context->current_input] = context->input_records;
+    context->current_input++;
+}
+
+static unsigned long
+partition_of(const DedupContext *context, uint64_t key)
+{
+    /* The high bits, so that the hash tables can use the low bits. */
+    return (unsigned long) (((key >> 32) * context->num_partitions) >> 32);
+}
+
+static uint64_t
+record_key(const DedupContext *context, const char *record)
+{
+    PackedRecord decoded;
+
+    if (context->version2) {
+        decode_packed_file_record((const unsigned char *) record, 0, &decoded);
+    }
+    else {
+        decode_packed_record((const unsigned char *) record, 0, &decoded);
+    }
+    return packed_position_key(&decoded);
+}
+
+/* The number of moves in the principal variation of record. */
+static unsigned
+pv_length(const DedupContext *context, const char *record)
+{
+    const unsigned char *pv = (const unsigned char *) record +
+            (context->version2 ? PACKED_FILE_PV_OFFSET : V1_PV_OFFSET);
+    unsigned length = 0;
+
+    while (length < context->pv_depth &&
+            (pv[2 * length] != 0 || pv[2 * length + 1] != 0)) {
+        length++;
+    }
+    return length;
+}
+
+static double
+record_score(const DedupContext *context, const char *record)
+{
+    const unsigned char *bytes = (const unsigned char *) record;
+
+    if (context->version2) {
+        return half_to_double((uint16_t) (bytes[V2_SCORE_OFFSET] |
+                                          (bytes[V2_SCORE_OFFSET + 1] << 8)));
+    }
+    else {
+        return half_to_double((uint16_t) ((bytes[V1_SCORE_OFFSET] << 8) |
+                                          bytes[V1_SCORE_OFFSET + 1]));
+    }
+}
+
+static void
+set_record_score(const DedupContext *context, char *record, double score)
+{
+    unsigned char *bytes = (unsigned char *) record;
+    uint16_t half = double_to_half(score);
+
+    if (context->version2) {
+        bytes[V2_SCORE_OFFSET] = (unsigned char) (half & 0xff);
+        bytes[V2_SCORE_OFFSET + 1] = (unsigned char) (half >> 8);
+    }
+    else {
+        bytes[V1_SCORE_OFFSET] = (unsigned char) (half >> 8);
+        bytes[V1_SCORE_OFFSET + 1] = (unsigned char) (half & 0xff);
+    }
+}
+
+/* Append the buffered slots of partition to the temporary file. */
+static void
+flush_partition(DedupContext *context, Partition *partition)
+{
+    Run *run;
+    size_t written = 0;
+
+    if (partition->buffered == 0) {
+        return;
+    }
+    while (written < partition->buffered) {
+        ssize_t bytes = pwrite(context->temp_fd, partition->buffer + written,
+                               partition->buffered - written,
+                               context->temp_length + (off_t) written);
+        if (bytes <= 0) {
+            fprintf(stderr, "packtool: unable to write the temporary file\n");
+            exit(1);
+        }
+        written += (size_t) bytes;
+    }
+    if (partition->num_runs == partition->runs_space) {
+        partition->runs_space = partition->runs_space == 0 ? 16 : 2 * partition->runs_space;
+        partition->runs = (Run *) realloc_or_die((void *) partition->runs,
+                                                 partition->runs_space * sizeof(*partition->runs));
+    }
+    run = &partition->runs[partition->num_runs++];
+    run->offset = context->temp_length;
+    run->length = partition->buffered;
+    partition->length += partition->buffered;
+    context->temp_length += (off_t) partition->buffered;
+    partition->buffered = 0;
+}
+
+/* Read the next block of whole records of the current input, after
+ * the number of the input.
+ */
+static Boolean
+read_input_chunk(void *arg, Chunk *chunk)
+{
+    DedupContext *context = (DedupContext *) arg;
+    size_t read_size = READ_BLOCK_SIZE / context->record_size * context->record_size;
+    size_t filled = 0;
+    uint64_t source;
+
+    while (context->input == NULL || filled == 0) {
+        if (context->input == NULL && !open_next_input(context)) {
+            return FALSE;
+        }
+        chunk_buffer_space(chunk, SOURCE_PREFIX + read_size);
+        memcpy(chunk->buffer + SOURCE_PREFIX, context->pending, context->pending_length);
+        filled = context->pending_length;
+        filled += fread(chunk->buffer + SOURCE_PREFIX + filled, 1, read_size - filled,
+                        context->input);
+        /* Keep any incomplete record for the next read. */
+        context->pending_length = filled % context->record_size;
+        filled -= context->pending_length;
+        memcpy(context->pending, chunk->buffer + SOURCE_PREFIX + filled,
+               context->pending_length);
+        if (filled == 0) {
+            finish_input(context);
+        }
+    }
+    source = context->current_input;
+    memcpy(chunk->buffer, &source, sizeof(source));
+    chunk->input = chunk->buffer + SOURCE_PREFIX;
+    chunk->input_length = filled;
+    context->input_records += filled / context->record_size;
+    return TRUE;
+}
+
+/* Find the partition of each record and arrange the chunk's slots
+ * by partition, preceded by the number of slots in each.
+ */
+static void
+process_input_chunk(void *arg, Chunk *chunk)
+{
+    const DedupContext *context = (const DedupContext *) arg;
+    size_t num_records = chunk->input_length / context->record_size;
+    size_t counts_size = context->num_partitions * sizeof(uint64_t);
+    uint64_t *keys = (uint64_t *) malloc_or_die((num_records + 1) * sizeof(*keys));
+    uint64_t *counts, *next;
+    SlotTrailer trailer;
+    uint64_t source;
+    char *slots;
+    size_t i;
+    unsigned long p;
+
+    memcpy(&source, chunk->buffer, sizeof(source));
+    trailer.source = (uint16_t) source;
+    next = (uint64_t *) malloc_or_die(counts_size);
+    memset(next, 0, counts_size);
+    counts = (uint64_t *) chunk_output_space(chunk, counts_size);
+    memset(counts, 0, counts_size);
+    for (i = 0; i < num_records; i++) {
+        keys[i] = record_key(context, chunk->input + i * context->record_size);
+        counts[partition_of(context, keys[i])]++;
+    }
+    for (p = 1; p < context->num_partitions; p++) {
+        next[p] = next[p - 1] + counts[p - 1];
+    }
+    slots = chunk_output_space(chunk, num_records * context->slot_size);
+    for (i = 0; i < num_records; i++) {
+        const char *record = chunk->input + i * context->record_size;
+        char *slot = slots + next[partition_of(context, keys[i])]++ * context->slot_size;
+
+        trailer.key = keys[i];
+        memcpy(slot, record, context->record_size);
+        memcpy(slot + context->record_size, &trailer, sizeof(trailer));
+    }
+    chunk->records = num_records;
+    free((void *) next);
+    free((void *) keys);
+}
+
+static void
+write_input_chunk(void *arg, Chunk *chunk)
+{
+    DedupContext *context = (DedupContext *) arg;
+    const uint64_t *counts = (const uint64_t *) chunk->output;
+    const char *slots = chunk->output + context->num_partitions * sizeof(uint64_t);
+    uint64_t before = context->read;
+    unsigned long p;
+
+    for (p = 0; p < context->num_partitions; p++) {
+        Partition *partition = &context->partitions[p];
+        size_t length = counts[p] * context->slot_size;
+
+        while (length > 0) {
+            size_t space = context->run_space - partition->buffered;
+            size_t part = length < space ? length : space;
+
+            memcpy(partition->buffer + partition->buffered, slots, part);
+            partition->buffered += part;
+            slots += part;
+            length -= part;
+            if (partition->buffered == context->run_space) {
+                flush_partition(context, partition);
+            }
+        }
+    }
+    context->read += chunk->records;
+    if (context->verbose &&
+            before / PROGRESS_INTERVAL != context->read / PROGRESS_INTERVAL) {
+        fprintf(stderr, "\rPartitioned: %" PRIu64 " records", context->read);
+    }
+}
+
+/* Gather the runs of the next partition into the chunk's buffer. */
+static Boolean
+read_partition_chunk(void *arg, Chunk *chunk)
+{
+    DedupContext *context = (DedupContext *) arg;
+    const Partition *partition;
+    size_t filled = 0;
+    unsigned long r;
+
+    if (chunk->sequence >= context->num_partitions) {
+        return FALSE;
+    }
+    partition = &context->partitions[chunk->sequence];
+    chunk_buffer_space(chunk, partition->length);
+    for (r = 0; r < partition->num_runs; r++) {
+        const Run *run = &partition->runs[r];
+        size_t done = 0;
+
+        while (done < run->length) {
+            ssize_t bytes = pread(context->temp_fd, chunk->buffer + filled + done,
+                                  run->length - done, run->offset + (off_t) done);
+            if (bytes <= 0) {
+                fprintf(stderr, "packtool: unable to read the temporary file\n");
+                exit(1);
+            }
+            done += (size_t) bytes;
+        }
+        filled += run->length;
+    }
+    chunk->input = chunk->buffer;
+    chunk->input_length = filled;
+    return TRUE;
+}
+
+/* Aggregate the records of a partition by position with an
+ * open-addressing hash table, and output one record per position
+ * in the order of their first occurrence.
+ */
+static void
+process_partition_chunk(void *arg, Chunk *chunk)
+{
+    const DedupContext *context = (const DedupContext *) arg;
+    size_t slot_size = context->slot_size;
+    size_t num_slots = chunk->input_length / slot_size;
+    size_t table_size = 16;
+    uint32_t *table;
+    Entry *entries;
+    size_t num_entries = 0, i;
+    PartitionCounts *counts = (PartitionCounts *) malloc_or_die(sizeof(*counts));
+
+    memset(counts, 0, sizeof(*counts));
+    counts->duplicates = (uint64_t *) malloc_or_die(context->num_inputs * sizeof(uint64_t));
+    memset(counts->duplicates, 0, context->num_inputs * sizeof(uint64_t));
+    while (table_size < 2 * num_slots) {
+        table_size *= 2;
+    }
+    /* Each element is an index into entries plus one, or 0 if empty. */
+    table = (uint32_t *) malloc_or_die(table_size * sizeof(*table));
+    memset(table, 0, table_size * sizeof(*table));
+    entries = (Entry *) malloc_or_die((num_slots + 1) * sizeof(*entries));
+
+    for (i = 0; i < num_slots; i++) {
+        const char *slot = chunk->input + i * slot_size;
+        SlotTrailer trailer;
+        size_t h;
+        Entry *entry = NULL;
+
+        memcpy(&trailer, slot + context->record_size, sizeof(trailer));
+        for (h = trailer.key & (table_size - 1); table[h] != 0; h = (h + 1) & (table_size - 1)) {
+            Entry *candidate = &entries[table[h] - 1];
+
+            if (candidate->key == trailer.key &&
+                    memcmp(chunk->input + (size_t) candidate->first * slot_size, slot,
+                           POSITION_BYTES) == 0) {
+                entry = candidate;
+                break;
+            }
+        }
+        if (entry == NULL) {
+            entry = &entries[num_entries++];
+            table[h] = (uint32_t) num_entries;
+            entry->key = trailer.key;
+            entry->first = entry->kept = (uint32_t) i;
+            entry->count = 1;
+            entry->kept_pv_length = pv_length(context, slot);
+            entry->score_sum = context->mode == KEEP_AVERAGE ? record_score(context, slot) : 0.0;
+        }
+        else {
+            entry->count++;
+            counts->duplicates[trailer.source]++;
+            if (context->mode == KEEP_DEEPEST) {
+                unsigned length = pv_length(context, slot);
+
+                if (length > entry->kept_pv_length) {
+                    entry->kept = (uint32_t) i;
+                    entry->kept_pv_length = length;
+                }
+            }
+            else if (context->mode == KEEP_AVERAGE) {
+                entry->score_sum += record_score(context, slot);
+            }
+        }
+    }
+
+    for (i = 0; i < num_entries; i++) {
+        const Entry *entry = &entries[i];
+        char *record = chunk_output_space(chunk, context->record_size);
+
+        memcpy(record, chunk->input + (size_t) entry->kept * slot_size, context->record_size);
+        if (context->mode == KEEP_AVERAGE && entry->count > 1) {
+            set_record_score(context, record, entry->score_sum / entry->count);
+        }
+        counts->multiplicity[entry->count < MAX_MULTIPLICITY ? entry->count : MAX_MULTIPLICITY]++;
+    }
+    chunk->records = num_entries;
+    chunk->result = counts;
+    free((void *) entries);
+    free((void *) table);
+}
+
+static void
+write_partition_chunk(void *arg, Chunk *chunk)
+{
+    DedupContext *context = (DedupContext *) arg;
+    PartitionCounts *counts = (PartitionCounts *) chunk->result;
+    unsigned i;
+
+    if (fwrite(chunk->output, 1, chunk->output_length, context->output) !=
+            chunk->output_length) {
+        fprintf(stderr, "packtool: error writing %s\n", context->output_name);
+        exit(1);
+    }
+    context->written += chunk->records;
+    for (i = 0; i < context->num_inputs; i++) {
+        context->duplicates[i] += counts->duplicates[i];
+    }
+    for (i = 0; i <= MAX_MULTIPLICITY; i++) {
+        context->multiplicity[i] += counts->multiplicity[i];
+    }
+    free((void *) counts->duplicates);
+    free((void *) counts);
+    chunk->result = NULL;
+}
+
+static void
+write_output_header(DedupContext *context, uint64_t record_count)
+{
+    PackedFileHeader header;
+    unsigned char bytes[PACKED_FILE_HEADER_SIZE];
+
+    init_packed_file_header(&header, context->pv_depth, record_count);
+    header.record_size = (uint32_t) context->record_size;
+    encode_packed_file_header(&header, bytes);
+    if (fwrite(bytes, 1, sizeof(bytes), context->output) != sizeof(bytes)) {
+        fprintf(stderr, "packtool: error writing %s\n", context->output_name);
+        exit(1);
+    }
+}
+
+/* Report the rate of duplicates in each input and overall. */
+static void
+report(const DedupContext *context)
+{
+    uint64_t duplicates = context->read - context->written;
+    unsigned i;
+
+    for (i = 0; i < context->num_inputs; i++) {
+        uint64_t records = context->records[i];
+
+        fprintf(stderr, "%s: %" PRIu64 " records, %" PRIu64 " duplicates (%.2f%%)\n",
+                context->input_names[i], records, context->duplicates[i],
+                records > 0 ? 100.0 * context->duplicates[i] / records : 0.0);
+    }
+    fprintf(stderr, "total: %" PRIu64 " records, %" PRIu64 " positions, %" PRIu64
+            " duplicates (%.2f%%)\n",
+            context->read, context->written, duplicates,
+            context->read > 0 ? 100.0 * duplicates / context->read : 0.0);
+    for (i = 1; i <= MAX_MULTIPLICITY; i++) {
+        if (context->multiplicity[i] > 0) {
+            fprintf(stderr, "positions seen %u%s time%s: %" PRIu64 "\n",
+                    i, i == MAX_MULTIPLICITY ? " or more" : "", i == 1 ? "" : "s",
+                    context->multiplicity[i]);
+        }
+    }
+}
+
+int
+dedup_command(int argc, char *argv[])
+{
+    DedupContext context;
+    Pipeline pipeline;
+    unsigned threads = default_thread_count();
+    unsigned long memory = DEFAULT_MEMORY;
+    const char *temp_dir = getenv("TMPDIR");
+    char *temp_name;
+    char *buffers;
+    unsigned long p;
+    unsigned i;
+    int option;
+
+    memset(&context, 0, sizeof (context));
+    context.verbose = TRUE;
+    context.mode = KEEP_FIRST;
+    while ((option = getopt(argc, argv, "k:m:P:p:T:j:qh")) != -1) {
+        switch (option) {
+            case 'k':
+                if (strcmp(optarg, "first") == 0) {
+                    context.mode = KEEP_FIRST;
+                }
+                else if (strcmp(optarg, "deepest") == 0) {
+                    context.mode = KEEP_DEEPEST;
+                }
+                else if (strcmp(optarg, "average") == 0) {
+                    context.mode = KEEP_AVERAGE;
+                }
+                else {
+                    usage_and_exit();
+                }
+                break;
+            case 'm':
+                if (sscanf(optarg, "%lu", &memory) != 1 || memory == 0) {
+                    fprintf(stderr, "packtool: invalid memory limit %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'P':
+                if (sscanf(optarg, "%lu", &context.num_partitions) != 1 ||
+                        context.num_partitions == 0) {
+                    fprintf(stderr, "packtool: invalid number of partitions %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'p':
+                context.pv_depth = read_pv_depth(optarg);
+                break;
+            case 'T':
+                temp_dir = optarg;
+                break;
+            case 'j':
+                threads = read_thread_count(optarg);
+                break;
+            case 'q':
+                context.verbose = FALSE;
+                break;
+            default:
+                usage_and_exit();
+        }
+    }
+    if (argc - optind < 2) {
+        usage_and_exit();
+    }
+    context.input_names = argv + optind;
+    context.num_inputs = (unsigned) (argc - optind - 1);
+    context.output_name = argv[argc - 1];
+    if (context.num_inputs > UINT16_MAX) {
+        fprintf(stderr, "packtool: at most %u inputs may be given\n", UINT16_MAX);
+        exit(1);
+    }
+    context.records = (uint64_t *) malloc_or_die(context.num_inputs * sizeof(uint64_t));
+    context.duplicates = (uint64_t *) malloc_or_die(context.num_inputs * sizeof(uint64_t));
+    memset(context.duplicates, 0, context.num_inputs * sizeof(uint64_t));
+    memory *= 1024 * 1024;
+
+    /* The format is needed to size the partitions. */
+    (void) open_next_input(&context);
+    context.slot_size = context.record_size + sizeof(SlotTrailer);
+    if (context.num_partitions == 0) {
+        /* Up to 2 * threads + 2 partitions are in memory at once in the
+         * second pass, each with its output, a hash table and an entry
+         * per slot.
+         */
+        double partition_records = PARTITION_MARGIN * memory / (2 * threads + 2) /
+                (context.slot_size + context.record_size + 2 * sizeof(uint32_t) +
+                 sizeof(Entry));
+        double total_records = 0;
+
+        for (i = 0; i < context.num_inputs; i++) {
+            struct stat status;
+
+            if (stat(context.input_names[i], &status) != 0 || !S_ISREG(status.st_mode)) {
+                fprintf(stderr, "packtool: -P is required when %s is not a regular file\n",
+                        context.input_names[i]);
+                exit(1);
+            }
+            total_records += (double) status.st_size / context.record_size;
+        }
+        context.num_partitions = (unsigned long) (total_records / partition_records) + 1;
+    }
+    if (context.verbose) {
+        fprintf(stderr, "Using %lu partition%s\n", context.num_partitions,
+                context.num_partitions == 1 ? "" : "s");
+    }
+    context.partitions = (Partition *) malloc_or_die(context.num_partitions *
+                                                     sizeof(*context.partitions));
+    memset(context.partitions, 0, context.num_partitions * sizeof(*context.partitions));
+
+    if (temp_dir == NULL || *temp_dir == '\0') {
+        temp_dir = "/tmp";
+    }
+    temp_name = (char *) malloc_or_die(strlen(temp_dir) + sizeof("/packtool.XXXXXX"));
+    sprintf(temp_name, "%s/packtool.XXXXXX", temp_dir);
+    context.temp_fd = mkstemp(temp_name);
+    if (context.temp_fd < 0) {
+        fprintf(stderr, "packtool: unable to create a temporary file in %s\n", temp_dir);
+        exit(1);
+    }
+    /* It is removed when it is closed. */
+    (void) unlink(temp_name);
+    free((void *) temp_name);
+
+    /* The first pass: partition the records by position.
+     * Half of the memory is left for the chunks in flight.
+     */
+    context.run_space = memory / 2 / context.num_partitions / context.slot_size *
+                        context.slot_size;
+    if (context.run_space == 0) {
+        context.run_space = context.slot_size;
+    }
+    buffers = (char *) malloc_or_die(context.num_partitions * context.run_space);
+    for (p = 0; p < context.num_partitions; p++) {
+        context.partitions[p].buffer = buffers + p * context.run_space;
+    }
+    pipeline.read = read_input_chunk;
+    pipeline.process = process_input_chunk;
+    pipeline.write = write_input_chunk;
+    pipeline.context = &context;
+    run_pipeline(&pipeline, threads);
+    for (p = 0; p < context.num_partitions; p++) {
+        flush_partition(&context, &context.partitions[p]);
+    }
+    free((void *) buffers);
+    if (context.verbose) {
+        fprintf(stderr, "\rPartitioned: %" PRIu64 " records\n", context.read);
+    }
+
+    /* The second pass: aggregate each partition. */
+    context.output = open_file_or_die(context.output_name, "wb");
+    if (context.version2) {
+        /* The count is filled in at the end. */
+        write_output_header(&context, 0);
+    }
+    pipeline.read = read_partition_chunk;
+    pipeline.process = process_partition_chunk;
+    pipeline.write = write_partition_chunk;
+    run_pipeline(&pipeline, threads);
+    if (context.version2) {
+        if (fseek(context.output, 0, SEEK_SET) != 0) {
+            fprintf(stderr, "packtool: %s must be a regular file to record its size\n",
+                    context.output_name);
+            exit(1);
+        }
+        write_output_header(&context, context.written);
+    }
+    close_file_or_die(context.output, context.output_name);
+    report(&context);
+
+    for (p = 0; p < context.num_partitions; p++) {
+        free((void *) context.partitions[p].runs);
+    }
+    free((void *) context.partitions);
+    free((void *) context.records);
+    free((void *) context.duplicates);
+    (void) close(context.temp_fd);
+    return 0;
+}
@@ -0,0 +1,539 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+/* Conversion to and from the packed dataset record (see packed.h). */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "bool.h"
+#include "packed.h"
+#include "packedfile.h"
+
+/* Return the size in bytes of a record with pv_depth moves. */
+size_t
+packed_record_size(unsigned pv_depth)
+{
+    return PACKED_RECORD_SIZE + 2 * (size_t) pv_depth;
+}
+
+/* Write record in its packed, big-endian form into bytes, which
+ * must have space for packed_record_size(pv_depth) bytes.
+ */
+void
+encode_packed_record(const PackedRecord *record, unsigned pv_depth,
+                     unsigned char *bytes)
+{
+    unsigned b, i;
+
+    for (b = 0; b < PACKED_NUM_BITBOARDS; b++) {
+        uint64_t bitboard = record->pieces[b];
+        for (i = 0; i < 8; i++) {
+            bytes[7 - i] = (unsigned char) (bitboard & 0xff);
+            bitboard >>= 8;
+        }
+        bytes += 8;
+    }
+    *bytes++ = (unsigned char) record->side_to_move;
+    *bytes++ = (unsigned char) record->castling;
+    *bytes++ = (unsigned char) record->ep_square;
+    *bytes++ = (unsigned char) (record->score >> 8);
+    *bytes++ = (unsigned char) (record->score & 0xff);
+    for (i = 0; i < pv_depth; i++) {
+        *bytes++ = (unsigned char) (record->pv[i] >> 8);
+        *bytes++ = (unsigned char) (record->pv[i] & 0xff);
+    }
+}
+
+/* Fill record from its packed form in bytes. */
+void
+decode_packed_record(const unsigned char *bytes, unsigned pv_depth,
+                     PackedRecord *record)
+{
+    unsigned b, i;
+
+    for (b = 0; b < PACKED_NUM_BITBOARDS; b++) {
+        uint64_t bitboard = 0;
+        for (i = 0; i < 8; i++) {
+            bitboard = (bitboard << 8) | bytes[i];
+        }
+        record->pieces[b] = bitboard;
+        bytes += 8;
+    }
+    record->side_to_move = (int8_t) bytes[0];
+    record->castling = (int8_t) bytes[1];
+    record->ep_square = (int8_t) bytes[2];
+    record->score = (uint16_t) ((bytes[3] << 8) | bytes[4]);
+    bytes += 5;
+    for (i = 0; i < pv_depth; i++) {
+        record->pv[i] = (uint16_t) ((bytes[0] << 8) | bytes[1]);
+        bytes += 2;
+    }
+}
+
+/* Write record in the little-endian, aligned form of version 2
+ * (packedfile.h) into bytes, which must have space for
+ * packed_file_record_size(pv_depth) bytes.
+ */
+void
+encode_packed_file_record(const PackedRecord *record, unsigned pv_depth,
+                          unsigned char *bytes)
+{
+    unsigned b, i;
+
+    memset(bytes, 0, packed_file_record_size(pv_depth));
+    for (b = 0; b < PACKED_NUM_BITBOARDS; b++) {
+        uint64_t bitboard = record->pieces[b];
+        for (i = 0; i < 8; i++) {
+            bytes[b * 8 + i] = (unsigned char) (bitboard & 0xff);
+            bitboard >>= 8;
+        }
+    }
+    bytes += PACKED_NUM_BITBOARDS * 8;
+    bytes[0] = (unsigned char) record->side_to_move;
+    bytes[1] = (unsigned char) record->castling;
+    bytes[2] = (unsigned char) record->ep_square;
+    bytes[4] = (unsigned char) (record->score & 0xff);
+    bytes[5] = (unsigned char) (record->score >> 8);
+    bytes += 6;
+    for (i = 0; i < pv_depth; i++) {
+        *bytes++ = (unsigned char) (record->pv[i] & 0xff);
+        *bytes++ = (unsigned char) (record->pv[i] >> 8);
+    }
+}
+
+/* Fill record from its version 2 form in bytes. */
+void
+decode_packed_file_record(const unsigned char *bytes, unsigned pv_depth,
+                          PackedRecord *record)
+{
+    unsigned b, i;
+
+    for (b = 0; b < PACKED_NUM_BITBOARDS; b++) {
+        uint64_t bitboard = 0;
+        for (i = 8; i > 0; i--) {
+            bitboard = (bitboard << 8) | bytes[b * 8 + i - 1];
+        }
+        record->pieces[b] = bitboard;
+    }
+    bytes += PACKED_NUM_BITBOARDS * 8;
+    record->side_to_move = (int8_t) bytes[0];
+    record->castling = (int8_t) bytes[1];
+    record->ep_square = (int8_t) bytes[2];
+    record->score = (uint16_t) (bytes[4] | (bytes[5] << 8));
+    bytes += 6;
+    for (i = 0; i < pv_depth; i++) {
+        record->pv[i] = (uint16_t) (bytes[0] | (bytes[1] << 8));
+        bytes += 2;
+    }
+}
+
+/* The finalizer of the splitmix64 generator. */
+static uint64_t
+mix64(uint64_t z)
+{
+    z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+    z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+    return z ^ (z >> 31);
+}
+
+static uint64_t
+position_key(const PackedRecord *record)
+{
+    uint64_t key = (uint64_t) (uint8_t) record->side_to_move |
+                   ((uint64_t) (uint8_t) record->castling << 8) |
+                   ((uint64_t) (uint8_t) record->ep_square << 16);
+    unsigned b;
+
+    for (b = 0; b < PACKED_NUM_BITBOARDS; b++) {
+        key = mix64(key ^ record->pieces[b]) + b;
+    }
+    return key;
+}
+
+/* Return a key for the position of record, ignoring its score and pv,
+ * so that equal positions have equal keys.
+ * The key is the same for the colour-flipped and mirrored forms of
+ * the position (see augment_packed_record), so that a split by key
+ * keeps a position and its augmentations together.
+ */
+uint64_t
+packed_position_key(const PackedRecord *record)
+{
+    PackedRecord variants[PACKED_MAX_VARIANTS];
+    unsigned num_variants = augment_packed_record(record, 0,
+            PACKED_AUGMENT_FLIP | PACKED_AUGMENT_MIRROR, variants);
+    uint64_t key = position_key(record);
+    unsigned v;
+
+    for (v = 1; v < num_variants; v++) {
+        uint64_t variant_key = position_key(&variants[v]);
+        if (variant_key < key) {
+            key = variant_key;
+        }
+    }
+    return key;
+}
+
+/* Map key to a number in [0, 1) that is uniformly distributed
+ * over keys and different for each seed.
+ * A record belongs to the first split whose cumulative ratio
+ * exceeds this number, so the same key always goes to the same split.
+ */
+double
+split_fraction(uint64_t key, uint64_t seed)
+{
+    uint64_t z = mix64(key ^ (seed * UINT64_C(0x9e3779b97f4a7c15)));
+
+    return (double) (z >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/* Reflect bitboard top to bottom: rank 1 becomes rank 8. */
+static uint64_t
+flip_bitboard(uint64_t bitboard)
+{
+    bitboard = ((bitboard >> 8) & UINT64_C(0x00ff00ff00ff00ff)) |
+               ((bitboard & UINT64_C(0x00ff00ff00ff00ff)) << 8);
+    bitboard = ((bitboard >> 16) & UINT64_C(0x0000ffff0000ffff)) |
+               ((bitboard & UINT64_C(0x0000ffff0000ffff)) << 16);
+    return (bitboard >> 32) | (bitboard << 32);
+}
+
+/* Reflect bitboard left to right: the a-file becomes the h-file. */
+static uint64_t
+mirror_bitboard(uint64_t bitboard)
+{
+    bitboard = ((bitboard >> 1) & UINT64_C(0x5555555555555555)) |
+               ((bitboard & UINT64_C(0x5555555555555555)) << 1);
+    bitboard = ((bitboard >> 2) & UINT64_C(0x3333333333333333)) |
+               ((bitboard & UINT64_C(0x3333333333333333)) << 2);
+    return ((bitboard >> 4) & UINT64_C(0x0f0f0f0f0f0f0f0f)) |
+           ((bitboard & UINT64_C(0x0f0f0f0f0f0f0f0f)) << 4);
+}
+
+/* Set *flipped to record with the colours exchanged and the board
+ * reflected top to bottom, which is the same position for the other
+ * side, so the score is negated.
+ */
+static void
+flip_record(const PackedRecord *record, unsigned pv_depth, PackedRecord *flipped)
+{
+    const unsigned half = PACKED_NUM_BITBOARDS / 2;
+    unsigned b, i;
+
+    for (b = 0; b < half; b++) {
+        flipped->pieces[b] = flip_bitboard(record->pieces[b + half]);
+        flipped->pieces[b + half] = flip_bitboard(record->pieces[b]);
+    }
+    flipped->side_to_move = (int8_t) (record->side_to_move ^ 1);
+    flipped->castling = (int8_t) (((record->castling & 0x03) << 2) |
+                                  ((record->castling >> 2) & 0x03));
+    flipped->ep_square = (int8_t) (record->ep_square >= 0 ? record->ep_square ^ 56 : -1);
+    /* Negate the half-precision score, leaving a zero positive. */
+    flipped->score = (record->score & 0x7fff) == 0 ? 0 : (uint16_t) (record->score ^ 0x8000);
+    for (i = 0; i < pv_depth; i++) {
+        /* Reflect both squares; the null move is unchanged. */
+        flipped->pv[i] = record->pv[i] == 0 ? 0 : (uint16_t) (record->pv[i] ^ (56 | (56 << 6)));
+    }
+}
+
+/* Set *mirrored to record reflected left to right, which is only the
+ * same position if there are no castling rights.
+ */
+static void
+mirror_record(const PackedRecord *record, unsigned pv_depth, PackedRecord *mirrored)
+{
+    unsigned b, i;
+
+    for (b = 0; b < PACKED_NUM_BITBOARDS; b++) {
+        mirrored->pieces[b] = mirror_bitboard(record->pieces[b]);
+    }
+    mirrored->side_to_move = record->side_to_move;
+    mirrored->castling = record->castling;
+    mirrored->ep_square = (int8_t) (record->ep_square >= 0 ? record->ep_square ^ 7 : -1);
+    mirrored->score = record->score;
+    for (i = 0; i < pv_depth; i++) {
+        mirrored->pv[i] = record->pv[i] == 0 ? 0 : (uint16_t) (record->pv[i] ^ (7 | (7 << 6)));
+    }
+}
+
+/* Fill variants with record followed by the augmentations of it
+ * selected by augment (PACKED_AUGMENT_FLIP and PACKED_AUGMENT_MIRROR):
+ * the colour-flipped record, then the mirrored record and its flip,
+ * which are only produced when there are no castling rights.
+ * Return the number of records in variants, at most PACKED_MAX_VARIANTS.
+ */
+unsigned
+augment_packed_record(const PackedRecord *record, unsigned pv_depth,
+                      unsigned augment, PackedRecord variants[PACKED_MAX_VARIANTS])
+{
+    unsigned num_variants = 1;
+
+    variants[0] = *record;
+    if (augment & PACKED_AUGMENT_FLIP) {
+        flip_record(record, pv_depth, &variants[num_variants++]);
+    }
+    if ((augment & PACKED_AUGMENT_MIRROR) && record->castling == 0) {
+        mirror_record(record, pv_depth, &variants[num_variants]);
+        num_variants++;
+        if (augment & PACKED_AUGMENT_FLIP) {
+            flip_record(&variants[num_variants - 1], pv_depth, &variants[num_variants]);
+            num_variants++;
+        }
+    }
+    return num_variants;
+}
+
+/* Return the augmentations named by text: none, flip, mirror or
+ * flip,mirror; or -1 if text is not one of them.
+ */
+int
+packed_augmentation(const char *text)
+{
+    if (strcmp(text, "none") == 0) {
+        return 0;
+    }
+    else if (strcmp(text, "flip") == 0) {
+        return PACKED_AUGMENT_FLIP;
+    }
+    else if (strcmp(text, "mirror") == 0) {
+        return PACKED_AUGMENT_MIRROR;
+    }
+    else if (strcmp(text, "flip,mirror") == 0 || strcmp(text, "mirror,flip") == 0) {
+        return PACKED_AUGMENT_FLIP | PACKED_AUGMENT_MIRROR;
+    }
+    else {
+        return -1;
+    }
+}
+
+/* Convert value to IEEE 754 half precision, rounding to nearest with
+ * ties to even, exactly as Python's struct module does for 'e'.
+ * Values too large to be represented become infinity.
+ */
+uint16_t
+double_to_half(double value)
+{
+    uint16_t sign = signbit(value) ? 0x8000 : 0;
+    int exponent;
+    double fraction;
+    unsigned bits;
+
+    if (isnan(value)) {
+        return sign | 0x7e00;
+    }
+    value = fabs(value);
+    if (isinf(value)) {
+        return sign | 0x7c00;
+    }
+    if (value == 0.0) {
+        return sign;
+    }
+    fraction = frexp(value, &exponent);
+    /* Normalise to 1 <= fraction < 2. */
+    fraction *= 2.0;
+    exponent--;
+    if (exponent >= 16) {
+        return sign | 0x7c00;
+    }
+    else if (exponent < -25) {
+        /* Underflow to zero. */
+        fraction = 0.0;
+        exponent = 0;
+    }
+    else if (exponent < -14) {
+        /* A subnormal. */
+        fraction = ldexp(fraction, 14 + exponent);
+        exponent = 0;
+    }
+    else {
+        exponent += 15;
+        fraction -= 1.0;
+    }
+    fraction *= 1024.0;
+    bits = (unsigned) fraction;
+    fraction -= bits;
+    if (fraction > 0.5 || (fraction == 0.5 && (bits & 1) != 0)) {
+        bits++;
+        if (bits == 1024) {
+            bits = 0;
+            exponent++;
+            if (exponent == 31) {
+                return sign | 0x7c00;
+            }
+        }
+    }
+    return sign | (uint16_t) ((exponent << 10) | bits);
+}
+
+/* Convert half-precision bits to a double. */
+double
+half_to_double(uint16_t half)
+{
+    int exponent = (half >> 10) & 0x1f;
+    unsigned mantissa = half & 0x3ff;
+    double value;
+
+    if (exponent == 0) {
+        value = ldexp((double) mantissa, -24);
+    }
+    else if (exponent == 31) {
+        value = mantissa == 0 ? INFINITY : NAN;
+    }
+    else {
+        value = ldexp((double) (mantissa | 0x400), exponent - 25);
+    }
+    return (half & 0x8000) != 0 ? -value : value;
+}
+
+/* Return the bitboard index of a FEN piece letter, or -1. */
+static int
+piece_index(char letter)
+{
+    static const char pieces[] = "PNBRQKpnbrqk";
+    const char *p = letter != '\0' ? strchr(pieces, letter) : NULL;
+
+    return p != NULL ? (int) (p - pieces) : -1;
+}
+
+/* Set the pieces, side to move, castling rights and en-passant
+ * square of record from fen.  Any move counters are ignored.
+ * The score and principal variation are untouched.
+ * Return FALSE if fen is not well formed.
+ */
+Boolean
+fen_to_packed(const char *fen, PackedRecord *record)
+{
+    int rank = 7, col = 0;
+    const char *p = fen;
+
+    memset(record->pieces, 0, sizeof (record->pieces));
+    for (; *p != '\0' && *p != ' '; p++) {
+        if (*p == '/') {
+            if (col != 8 || rank == 0) {
+                return FALSE;
+            }
+            rank--;
+            col = 0;
+        }
+        else if (*p >= '1' && *p <= '8') {
+            col += *p - '0';
+            if (col > 8) {
+                return FALSE;
+            }
+        }
+        else {
+            int piece = piece_index(*p);
+            if (piece < 0 || col >= 8) {
+                return FALSE;
+            }
+            record->pieces[piece] |= (uint64_t) 1 << (rank * 8 + col);
+            col++;
+        }
+    }
+    if (rank != 0 || col != 8 || *p != ' ') {
+        return FALSE;
+    }
+    p++;
+    if (*p == 'w') {
+        record->side_to_move = 0;
+    }
+    else if (*p == 'b') {
+        record->side_to_move = 1;
+    }
+    else {
+        return FALSE;
+    }
+    p++;
+    if (*p != ' ') {
+        return FALSE;
+    }
+    p++;
+    record->castling = 0;
+    if (*p == '-') {
+        p++;
+    }
+    else {
+        for (; *p != '\0' && *p != ' '; p++) {
+            switch (*p) {
+                case 'K':
+                    record->castling |= PACKED_WHITE_KINGSIDE;
+                    break;
+                case 'Q':
+                    record->castling |= PACKED_WHITE_QUEENSIDE;
+                    break;
+                case 'k':
+                    record->castling |= PACKED_BLACK_KINGSIDE;
+                    break;
+                case 'q':
+                    record->castling |= PACKED_BLACK_QUEENSIDE;
+                    break;
+                default:
+                    return FALSE;
+            }
+        }
+    }
+    if (*p == '\0') {
+        /* No en-passant field. */
+        record->ep_square = -1;
+        return TRUE;
+    }
+    else if (*p != ' ') {
+        return FALSE;
+    }
+    p++;
+    if (*p == '-') {
+        record->ep_square = -1;
+        p++;
+    }
+    else if (p[0] >= 'a' && p[0] <= 'h' && (p[1] == '3' || p[1] == '6')) {
+        record->ep_square = (int8_t) ((p[1] - '1') * 8 + (p[0] - 'a'));
+        p += 2;
+    }
+    else {
+        return FALSE;
+    }
+    return *p == '\0' || *p == ' ';
+}
+
+/* Return the encoding of the UCI move of the given length,
+ * or -1 if it is not a well-formed move.
+ * The promotion piece, if any, is not recorded.
+ */
+int
+uci_move_code(const char *move, size_t length)
+{
+    if (length == 4 && strncmp(move, "0000", 4) == 0) {
+        return 0;
+    }
+    else if ((length == 4 ||
+              (length == 5 && move[4] != '\0' && strchr("nbrq", move[4]) != NULL)) &&
+            move[0] >= 'a' && move[0] <= 'h' && move[1] >= '1' && move[1] <= '8' &&
+            move[2] >= 'a' && move[2] <= 'h' && move[3] >= '1' && move[3] <= '8') {
+        int from = (move[1] - '1') * 8 + (move[0] - 'a');
+        int to = (move[3] - '1') * 8 + (move[2] - 'a');
+        return from | (to << 6);
+    }
+    else {
+        return -1;
+    }
+}
@@ -0,0 +1,102 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+/* The packed dataset record used for training, as written by
+ * dataset-generation/pack_dataset.py with the struct format
+ *     >QQQQQQQQQQQQbbbe[H...]
+ * i.e., big-endian and unaligned:
+ *     12 uint64 piece bitboards,
+ *     int8 side to move, int8 castling rights, int8 en-passant square,
+ *     float16 score in pawns from White's point of view,
+ *     optionally followed by a uint16 per principal-variation move.
+ * The conventions are those of bitboard.h: squares are numbered
+ * from a1 (0) to h8 (63), the bitboards are ordered White pawn ... king
+ * then Black pawn ... king, side to move is 0 for White and 1 for Black,
+ * and the en-passant square is -1 if there is none.
+ * A move is encoded as from | (to << 6); the null move is 0.
+ */
+
+#ifndef PACKED_H
+#define PACKED_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define PACKED_NUM_BITBOARDS 12
+/* The size of a record without any principal variation. */
+#define PACKED_RECORD_SIZE (PACKED_NUM_BITBOARDS * 8 + 3 + 2)
+/* The longest principal variation that may be stored. */
+#define PACKED_MAX_PV_DEPTH 64
+
+/* Indices into PackedRecord.pieces. */
+enum {
+    PACKED_WHITE_PAWN, PACKED_WHITE_KNIGHT, PACKED_WHITE_BISHOP,
+    PACKED_WHITE_ROOK, PACKED_WHITE_QUEEN, PACKED_WHITE_KING,
+    PACKED_BLACK_PAWN, PACKED_BLACK_KNIGHT, PACKED_BLACK_BISHOP,
+    PACKED_BLACK_ROOK, PACKED_BLACK_QUEEN, PACKED_BLACK_KING
+};
+
+/* Bits of PackedRecord.castling; as in bitboard.h. */
+#define PACKED_WHITE_KINGSIDE  0x01
+#define PACKED_WHITE_QUEENSIDE 0x02
+#define PACKED_BLACK_KINGSIDE  0x04
+#define PACKED_BLACK_QUEENSIDE 0x08
+
+/* Augmentations of a record (see augment_packed_record). */
+#define PACKED_AUGMENT_FLIP   0x01
+#define PACKED_AUGMENT_MIRROR 0x02
+/* A record and its augmentations. */
+#define PACKED_MAX_VARIANTS 4
+
+/* The score used for a forced mate, in centipawns. */
+#define PACKED_MATE_SCORE 3000
+
+/* A record in native form. */
+typedef struct {
+    uint64_t pieces[PACKED_NUM_BITBOARDS];
+    int8_t side_to_move;
+    int8_t castling;
+    int8_t ep_square;
+    /* IEEE 754 half-precision bits of the score in pawns. */
+    uint16_t score;
+    uint16_t pv[PACKED_MAX_PV_DEPTH];
+} PackedRecord;
+
+size_t packed_record_size(unsigned pv_depth);
+void encode_packed_record(const PackedRecord *record, unsigned pv_depth,
+                          unsigned char *bytes);
+void decode_packed_record(const unsigned char *bytes, unsigned pv_depth,
+                          PackedRecord *record);
+void encode_packed_file_record(const PackedRecord *record, unsigned pv_depth,
+                               unsigned char *bytes);
+void decode_packed_file_record(const unsigned char *bytes, unsigned pv_depth,
+                               PackedRecord *record);
+uint64_t packed_position_key(const PackedRecord *record);
+double split_fraction(uint64_t key, uint64_t seed);
+unsigned augment_packed_record(const PackedRecord *record, unsigned pv_depth,
+                               unsigned augment, PackedRecord variants[PACKED_MAX_VARIANTS]);
+int packed_augmentation(const char *text);
+uint16_t double_to_half(double value);
+double half_to_double(uint16_t half);
+Boolean fen_to_packed(const char *fen, PackedRecord *record);
+int uci_move_code(const char *move, size_t length);
+
+#endif	// PACKED_H
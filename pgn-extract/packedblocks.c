@@ -0,0 +1,303 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+/* The block-compressed container of packed records; see packedblocks.h. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <zstd.h>
+#include "packedblocks.h"
+
+static uint32_t
+read_uint32(const unsigned char *bytes)
+{
+    return (uint32_t) bytes[0] | ((uint32_t) bytes[1] << 8) |
+           ((uint32_t) bytes[2] << 16) | ((uint32_t) bytes[3] << 24);
+}
+
+static uint64_t
+read_uint64(const unsigned char *bytes)
+{
+    return (uint64_t) read_uint32(bytes) | ((uint64_t) read_uint32(bytes + 4) << 32);
+}
+
+static void
+write_uint32(uint32_t value, unsigned char *bytes)
+{
+    unsigned i;
+
+    for (i = 0; i < 4; i++) {
+        bytes[i] = (unsigned char) (value >> (8 * i));
+    }
+}
+
+/* Arrange the bytes of num_records records of size bytes each
+ * so that byte j of record i moves to j * num_records + i.
+ */
+static void
+transpose_records(const unsigned char *records, size_t num_records,
+                  size_t size, unsigned char *transposed)
+{
+    size_t i, j;
+
+    for (i = 0; i < num_records; i++) {
+        const unsigned char *record = records + i * size;
+        for (j = 0; j < size; j++) {
+            transposed[j * num_records + i] = record[j];
+        }
+    }
+}
+
+/* The inverse of transpose_records. */
+static void
+restore_records(const unsigned char *transposed, size_t num_records,
+                size_t size, unsigned char *records)
+{
+    size_t i, j;
+
+    for (j = 0; j < size; j++) {
+        const unsigned char *plane = transposed + j * num_records;
+        for (i = 0; i < num_records; i++) {
+            records[i * size + j] = plane[i];
+        }
+    }
+}
+
+void
+init_packed_blocks_header(PackedBlocksHeader *header, unsigned pv_depth,
+                          unsigned block_records)
+{
+    header->version = PACKED_BLOCKS_VERSION;
+    header->header_size = PACKED_FILE_HEADER_SIZE;
+    header->layout = PACKED_FILE_LAYOUT_BITBOARDS;
+    header->record_size = (uint32_t) packed_file_record_size(pv_depth);
+    header->pv_depth = pv_depth;
+    header->block_records = block_records;
+    header->compression = PACKED_BLOCKS_TRANSPOSED_ZSTD;
+    header->record_count = 0;
+    header->num_blocks = 0;
+}
+
+void
+encode_packed_blocks_header(const PackedBlocksHeader *header,
+                            unsigned char bytes[PACKED_FILE_HEADER_SIZE])
+{
+    memset(bytes, 0, PACKED_FILE_HEADER_SIZE);
+    memcpy(bytes, PACKED_BLOCKS_MAGIC, PACKED_FILE_MAGIC_LENGTH);
+    write_uint32(header->version, bytes + 8);
+    write_uint32(header->header_size, bytes + 12);
+    write_uint32(header->layout, bytes + 16);
+    write_uint32(header->record_size, bytes + 20);
+    write_uint32(header->pv_depth, bytes + 24);
+    write_uint32(header->block_records, bytes + 28);
+    write_uint32(header->compression, bytes + 32);
+}
+
+void
+encode_packed_blocks_offset(uint64_t offset, unsigned char bytes[8])
+{
+    write_uint32((uint32_t) offset, bytes);
+    write_uint32((uint32_t) (offset >> 32), bytes + 4);
+}
+
+void
+encode_packed_blocks_trailer(uint64_t record_count, uint64_t index_offset,
+                             unsigned char bytes[PACKED_BLOCKS_TRAILER_SIZE])
+{
+    encode_packed_blocks_offset(record_count, bytes);
+    encode_packed_blocks_offset(index_offset, bytes + 8);
+    memcpy(bytes + 16, PACKED_BLOCKS_INDEX_MAGIC, PACKED_FILE_MAGIC_LENGTH);
+}
+
+/* Return the largest compressed size of a block. */
+size_t
+packed_block_bound(const PackedBlocksHeader *header)
+{
+    return ZSTD_compressBound((size_t) header->block_records * header->record_size);
+}
+
+/* Compress num_records records (at most header->block_records) into
+ * compressed, which has space for compressed_space bytes, using scratch,
+ * which has space for the records, at the given zstd level.
+ * Return the compressed size, or 0 on failure.
+ * This may be called concurrently.
+ */
+size_t
+compress_packed_block(const PackedBlocksHeader *header,
+                      const void *records, size_t num_records,
+                      int level, void *scratch,
+                      void *compressed, size_t compressed_space)
+{
+    size_t length = num_records * header->record_size;
+    size_t compressed_length;
+
+    transpose_records((const unsigned char *) records, num_records,
+                      header->record_size, (unsigned char *) scratch);
+    compressed_length = ZSTD_compress(compressed, compressed_space,
+                                      scratch, length, level);
+    return ZSTD_isError(compressed_length) ? 0 : compressed_length;
+}
+
+/* Map filename into memory for reading.
+ * Return NULL on success, otherwise a description of the problem.
+ */
+const char *
+open_packed_blocks(const char *filename, PackedBlocks *file)
+{
+    PackedBlocksHeader *header = &file->header;
+    const unsigned char *trailer;
+    struct stat status;
+    uint64_t index_offset, block;
+    const char *error = NULL;
+    void *data;
+    int fd;
+
+    file->data = NULL;
+    file->length = 0;
+    fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return "unable to open the file";
+    }
+    if (fstat(fd, &status) != 0 || !S_ISREG(status.st_mode) ||
+            status.st_size < PACKED_FILE_HEADER_SIZE + 8 + PACKED_BLOCKS_TRAILER_SIZE) {
+        (void) close(fd);
+        return "not a block-compressed packed file";
+    }
+    data = mmap(NULL, (size_t) status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    (void) close(fd);
+    if (data == MAP_FAILED) {
+        return "unable to map the file";
+    }
+    file->data = (const unsigned char *) data;
+    file->length = (size_t) status.st_size;
+    trailer = file->data + file->length - PACKED_BLOCKS_TRAILER_SIZE;
+
+    if (memcmp(file->data, PACKED_BLOCKS_MAGIC, PACKED_FILE_MAGIC_LENGTH) != 0 ||
+            memcmp(trailer + 16, PACKED_BLOCKS_INDEX_MAGIC, PACKED_FILE_MAGIC_LENGTH) != 0) {
+        error = "not a block-compressed packed file";
+    }
+    else {
+        header->version = read_uint32(file->data + 8);
+        header->header_size = read_uint32(file->data + 12);
+        header->layout = read_uint32(file->data + 16);
+        header->record_size = read_uint32(file->data + 20);
+        header->pv_depth = read_uint32(file->data + 24);
+        header->block_records = read_uint32(file->data + 28);
+        header->compression = read_uint32(file->data + 32);
+        header->record_count = read_uint64(trailer);
+        index_offset = read_uint64(trailer + 8);
+        if (header->version != PACKED_BLOCKS_VERSION) {
+            error = "unsupported version";
+        }
+        else if (header->layout != PACKED_FILE_LAYOUT_BITBOARDS ||
+                header->compression != PACKED_BLOCKS_TRANSPOSED_ZSTD) {
+            error = "unsupported record layout or compression";
+        }
+        else if (header->header_size < PACKED_FILE_HEADER_SIZE ||
+                header->pv_depth > 0xffff ||
+                header->record_size < packed_file_record_size(header->pv_depth) ||
+                header->record_size % PACKED_FILE_ALIGNMENT != 0 ||
+                header->block_records == 0) {
+            error = "inconsistent header";
+        }
+        else {
+            header->num_blocks = (header->record_count + header->block_records - 1) /
+                                 header->block_records;
+            if (index_offset < header->header_size ||
+                    index_offset > file->length - PACKED_BLOCKS_TRAILER_SIZE ||
+                    (file->length - PACKED_BLOCKS_TRAILER_SIZE - index_offset) / 8 !=
+                        header->num_blocks + 1) {
+                error = "inconsistent index";
+            }
+            else {
+                file->index = file->data + index_offset;
+                /* The blocks must lie in order between the header and the index. */
+                if (read_uint64(file->index) != header->header_size ||
+                        read_uint64(file->index + 8 * header->num_blocks) != index_offset) {
+                    error = "inconsistent index";
+                }
+                for (block = 0; error == NULL && block < header->num_blocks; block++) {
+                    if (read_uint64(file->index + 8 * block) >
+                            read_uint64(file->index + 8 * (block + 1))) {
+                        error = "inconsistent index";
+                    }
+                }
+            }
+        }
+    }
+    if (error != NULL) {
+        close_packed_blocks(file);
+    }
+    return error;
+}
+
+/* Return the number of records in block. */
+size_t
+packed_block_records(const PackedBlocks *file, uint64_t block)
+{
+    uint64_t first = block * file->header.block_records;
+    uint64_t remaining = file->header.record_count - first;
+
+    return remaining < file->header.block_records ?
+            (size_t) remaining : (size_t) file->header.block_records;
+}
+
+/* Decompress block, which must be less than the number of blocks, into
+ * records, using scratch.  Both must have space for the records of a
+ * whole block; records should be aligned for uint64_t.
+ * Return NULL on success, otherwise a description of the problem.
+ * This may be called concurrently.
+ */
+const char *
+read_packed_block(const PackedBlocks *file, uint64_t block,
+                  void *scratch, void *records)
+{
+    uint64_t start = read_uint64(file->index + 8 * block);
+    uint64_t end = read_uint64(file->index + 8 * (block + 1));
+    size_t num_records = packed_block_records(file, block);
+    size_t length = num_records * file->header.record_size;
+    size_t decompressed = ZSTD_decompress(scratch, length, file->data + start,
+                                          (size_t) (end - start));
+
+    if (ZSTD_isError(decompressed) || decompressed != length) {
+        return "corrupt block";
+    }
+    restore_records((const unsigned char *) scratch, num_records,
+                    file->header.record_size, (unsigned char *) records);
+    return NULL;
+}
+
+void
+close_packed_blocks(PackedBlocks *file)
+{
+    if (file->data != NULL) {
+        (void) munmap((void *) file->data, file->length);
+        file->data = NULL;
+        file->length = 0;
+    }
+}
@@ -0,0 +1,109 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+/* A seekable, block-compressed container for version 2 packed records
+ * (packedfile.h), and a reader for it.  Like packedfile.h, this header
+ * and packedblocks.c can be used apart from pgn-extract; they require
+ * libzstd.
+ *
+ * The records are divided into blocks of a fixed number of records,
+ * the last of which may be short.  Each block is compressed on its own,
+ * so any block can be read without the others, and by several threads
+ * at once.  Before compression the bytes of the records in a block are
+ * transposed: all of the first bytes, then all of the second bytes and
+ * so on, which brings together the mostly zero bytes of the bitboards.
+ *
+ * The file starts with a header of PACKED_FILE_HEADER_SIZE bytes:
+ *     offset  0: magic, PACKED_BLOCKS_MAGIC (8 bytes, no terminator)
+ *     offset  8: uint32 version, PACKED_BLOCKS_VERSION
+ *     offset 12: uint32 header size, the offset of the first block
+ *     offset 16: uint32 record layout, PACKED_FILE_LAYOUT_BITBOARDS
+ *     offset 20: uint32 record size
+ *     offset 24: uint32 principal-variation depth
+ *     offset 28: uint32 records per block
+ *     offset 32: uint32 compression, PACKED_BLOCKS_TRANSPOSED_ZSTD
+ *     offset 36: zero up to the header size
+ * followed by the compressed blocks, then an index of
+ * (number of blocks + 1) uint64 offsets, where block i occupies the
+ * bytes from offset i up to offset i + 1, and finally a trailer of
+ * PACKED_BLOCKS_TRAILER_SIZE bytes:
+ *     uint64 number of records
+ *     uint64 offset of the index
+ *     magic, PACKED_BLOCKS_INDEX_MAGIC
+ * Keeping the counts in a trailer allows the file to be written to a
+ * pipe.  All values are little-endian.
+ */
+
+#ifndef PACKEDBLOCKS_H
+#define PACKEDBLOCKS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "packedfile.h"
+
+#define PACKED_BLOCKS_MAGIC "NZPACKBZ"
+#define PACKED_BLOCKS_INDEX_MAGIC "NZPKINDX"
+#define PACKED_BLOCKS_VERSION 1
+#define PACKED_BLOCKS_TRAILER_SIZE 24
+/* Transposed records compressed with zstd. */
+#define PACKED_BLOCKS_TRANSPOSED_ZSTD 1
+/* The default number of records per block. */
+#define PACKED_BLOCKS_DEFAULT_RECORDS 16384
+
+typedef struct {
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t layout;
+    uint32_t record_size;
+    uint32_t pv_depth;
+    uint32_t block_records;
+    uint32_t compression;
+    uint64_t record_count;
+    uint64_t num_blocks;
+} PackedBlocksHeader;
+
+/* A file opened for reading by open_packed_blocks. */
+typedef struct {
+    PackedBlocksHeader header;
+    const unsigned char *data;
+    size_t length;
+    const unsigned char *index;
+} PackedBlocks;
+
+void init_packed_blocks_header(PackedBlocksHeader *header, unsigned pv_depth,
+                               unsigned block_records);
+void encode_packed_blocks_header(const PackedBlocksHeader *header,
+                                 unsigned char bytes[PACKED_FILE_HEADER_SIZE]);
+void encode_packed_blocks_trailer(uint64_t record_count, uint64_t index_offset,
+                                  unsigned char bytes[PACKED_BLOCKS_TRAILER_SIZE]);
+void encode_packed_blocks_offset(uint64_t offset, unsigned char bytes[8]);
+size_t compress_packed_block(const PackedBlocksHeader *header,
+                             const void *records, size_t num_records,
+                             int level, void *scratch,
+                             void *compressed, size_t compressed_space);
+size_t packed_block_bound(const PackedBlocksHeader *header);
+const char *open_packed_blocks(const char *filename, PackedBlocks *file);
+size_t packed_block_records(const PackedBlocks *file, uint64_t block);
+const char *read_packed_block(const PackedBlocks *file, uint64_t block,
+                              void *scratch, void *records);
+void close_packed_blocks(PackedBlocks *file);
+
+#endif	// PACKEDBLOCKS_H
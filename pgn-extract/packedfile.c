@@ -0,0 +1,200 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+/* Version 2 of the packed dataset format; see packedfile.h. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "packedfile.h"
+
+static uint32_t
+read_uint32(const unsigned char *bytes)
+{
+    return (uint32_t) bytes[0] | ((uint32_t) bytes[1] << 8) |
+           ((uint32_t) bytes[2] << 16) | ((uint32_t) bytes[3] << 24);
+}
+
+static uint64_t
+read_uint64(const unsigned char *bytes)
+{
+    return (uint64_t) read_uint32(bytes) | ((uint64_t) read_uint32(bytes + 4) << 32);
+}
+
+static void
+write_uint32(uint32_t value, unsigned char *bytes)
+{
+    unsigned i;
+
+    for (i = 0; i < 4; i++) {
+        bytes[i] = (unsigned char) (value >> (8 * i));
+    }
+}
+
+static void
+write_uint64(uint64_t value, unsigned char *bytes)
+{
+    write_uint32((uint32_t) value, bytes);
+    write_uint32((uint32_t) (value >> 32), bytes + 4);
+}
+
+/* Return the size in bytes of a record with pv_depth moves. */
+size_t
+packed_file_record_size(unsigned pv_depth)
+{
+    size_t size = PACKED_FILE_PV_OFFSET + 2 * (size_t) pv_depth;
+
+    return (size + PACKED_FILE_ALIGNMENT - 1) & ~(size_t) (PACKED_FILE_ALIGNMENT - 1);
+}
+
+void
+init_packed_file_header(PackedFileHeader *header, unsigned pv_depth,
+                        uint64_t record_count)
+{
+    header->version = PACKED_FILE_VERSION;
+    header->header_size = PACKED_FILE_HEADER_SIZE;
+    header->layout = PACKED_FILE_LAYOUT_BITBOARDS;
+    header->record_size = (uint32_t) packed_file_record_size(pv_depth);
+    header->pv_depth = pv_depth;
+    header->record_count = record_count;
+}
+
+void
+encode_packed_file_header(const PackedFileHeader *header,
+                          unsigned char bytes[PACKED_FILE_HEADER_SIZE])
+{
+    memset(bytes, 0, PACKED_FILE_HEADER_SIZE);
+    memcpy(bytes, PACKED_FILE_MAGIC, PACKED_FILE_MAGIC_LENGTH);
+    write_uint32(header->version, bytes + 8);
+    write_uint32(header->header_size, bytes + 12);
+    write_uint32(header->layout, bytes + 16);
+    write_uint32(header->record_size, bytes + 20);
+    write_uint32(header->pv_depth, bytes + 24);
+    write_uint64(header->record_count, bytes + 32);
+}
+
+/* Fill header from the length bytes at the start of a file.
+ * Return NULL if it describes a file that can be read, otherwise a
+ * description of the problem.
+ */
+const char *
+decode_packed_file_header(const unsigned char *bytes, size_t length,
+                          PackedFileHeader *header)
+{
+    if (length < PACKED_FILE_HEADER_SIZE ||
+            memcmp(bytes, PACKED_FILE_MAGIC, PACKED_FILE_MAGIC_LENGTH) != 0) {
+        return "not a version 2 packed file";
+    }
+    header->version = read_uint32(bytes + 8);
+    header->header_size = read_uint32(bytes + 12);
+    header->layout = read_uint32(bytes + 16);
+    header->record_size = read_uint32(bytes + 20);
+    header->pv_depth = read_uint32(bytes + 24);
+    header->record_count = read_uint64(bytes + 32);
+    if (header->version != PACKED_FILE_VERSION) {
+        return "unsupported version";
+    }
+    else if (header->layout != PACKED_FILE_LAYOUT_BITBOARDS) {
+        return "unsupported record layout";
+    }
+    else if (header->header_size < PACKED_FILE_HEADER_SIZE ||
+            header->header_size % PACKED_FILE_ALIGNMENT != 0 ||
+            header->pv_depth > 0xffff ||
+            header->record_size < packed_file_record_size(header->pv_depth) ||
+            header->record_size % PACKED_FILE_ALIGNMENT != 0) {
+        return "inconsistent header";
+    }
+    else {
+        return NULL;
+    }
+}
+
+/* Map filename into memory for reading.
+ * Return NULL on success, otherwise a description of the problem.
+ * The records are used in place, so the host must be little-endian.
+ */
+const char *
+open_packed_file(const char *filename, PackedFile *file)
+{
+    const uint16_t probe = 1;
+    struct stat status;
+    const char *error = NULL;
+    void *data;
+    int fd;
+
+    file->data = NULL;
+    file->length = 0;
+    if (*(const unsigned char *) &probe != 1) {
+        return "the reader requires a little-endian host";
+    }
+    fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return "unable to open the file";
+    }
+    if (fstat(fd, &status) != 0 || !S_ISREG(status.st_mode) ||
+            status.st_size < PACKED_FILE_HEADER_SIZE) {
+        (void) close(fd);
+        return "not a version 2 packed file";
+    }
+    data = mmap(NULL, (size_t) status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    (void) close(fd);
+    if (data == MAP_FAILED) {
+        return "unable to map the file";
+    }
+    file->data = (const unsigned char *) data;
+    file->length = (size_t) status.st_size;
+
+    error = decode_packed_file_header(file->data, file->length, &file->header);
+    if (error == NULL &&
+            (file->length < file->header.header_size ||
+             (file->length - file->header.header_size) / file->header.record_size <
+                file->header.record_count)) {
+        error = "the file is shorter than its header says";
+    }
+    if (error != NULL) {
+        close_packed_file(file);
+    }
+    return error;
+}
+
+/* Return the record at index, which must be less than the record count. */
+const PackedFileRecord *
+packed_file_record(const PackedFile *file, uint64_t index)
+{
+    return (const PackedFileRecord *) (file->data + file->header.header_size +
+                                       index * file->header.record_size);
+}
+
+void
+close_packed_file(PackedFile *file)
+{
+    if (file->data != NULL) {
+        (void) munmap((void *) file->data, file->length);
+        file->data = NULL;
+        file->length = 0;
+    }
+}
@@ -0,0 +1,111 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+/* Version 2 of the packed dataset format, and a reader for it.
+ * This header and packedfile.c are self-contained so that they can be
+ * copied into, or linked with (libpackedfile.a), a training loader that
+ * is built separately from pgn-extract.
+ *
+ * A version 1 file (see packed.h) is a headerless sequence of
+ * big-endian, unaligned records whose principal-variation depth must be
+ * known out of band.  A version 2 file starts with a header of
+ * PACKED_FILE_HEADER_SIZE bytes:
+ *     offset  0: magic, PACKED_FILE_MAGIC (8 bytes, no terminator)
+ *     offset  8: uint32 version, PACKED_FILE_VERSION
+ *     offset 12: uint32 header size, the offset of the first record
+ *     offset 16: uint32 record layout, PACKED_FILE_LAYOUT_BITBOARDS
+ *     offset 20: uint32 record size
+ *     offset 24: uint32 principal-variation depth
+ *     offset 28: uint32 zero
+ *     offset 32: uint64 number of records
+ *     offset 40: zero up to the header size
+ * followed by the records, each laid out as PackedFileRecord and padded
+ * with zeros to a multiple of PACKED_FILE_ALIGNMENT bytes.
+ * All values are little-endian, so on a little-endian host a record in
+ * a mapped file can be used in place.
+ */
+
+#ifndef PACKEDFILE_H
+#define PACKEDFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define PACKED_FILE_MAGIC "NZPACKED"
+#define PACKED_FILE_MAGIC_LENGTH 8
+#define PACKED_FILE_VERSION 2
+#define PACKED_FILE_HEADER_SIZE 64
+/* Records laid out as PackedFileRecord. */
+#define PACKED_FILE_LAYOUT_BITBOARDS 1
+/* Every record starts at a multiple of this. */
+#define PACKED_FILE_ALIGNMENT 8
+/* The offset of PackedFileRecord.pv. */
+#define PACKED_FILE_PV_OFFSET 102
+
+typedef struct {
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t layout;
+    uint32_t record_size;
+    uint32_t pv_depth;
+    uint64_t record_count;
+} PackedFileHeader;
+
+/* A record, with the conventions of packed.h:
+ * the bitboards are White pawn ... king then Black pawn ... king,
+ * with a1 as bit 0 and h8 as bit 63; side to move is 0 for White;
+ * the en-passant square is -1 if there is none; moves are
+ * from | (to << 6).
+ */
+typedef struct {
+    uint64_t pieces[12];
+    int8_t side_to_move;
+    int8_t castling;
+    int8_t ep_square;
+    uint8_t reserved;
+    /* IEEE 754 half-precision bits of the score in pawns
+     * from White's point of view.
+     */
+    uint16_t score;
+    /* pv_depth moves, followed by padding. */
+    uint16_t pv[];
+} PackedFileRecord;
+
+/* A file opened for reading by open_packed_file. */
+typedef struct {
+    PackedFileHeader header;
+    const unsigned char *data;
+    size_t length;
+} PackedFile;
+
+size_t packed_file_record_size(unsigned pv_depth);
+void init_packed_file_header(PackedFileHeader *header, unsigned pv_depth,
+                             uint64_t record_count);
+void encode_packed_file_header(const PackedFileHeader *header,
+                               unsigned char bytes[PACKED_FILE_HEADER_SIZE]);
+const char *decode_packed_file_header(const unsigned char *bytes, size_t length,
+                                      PackedFileHeader *header);
+const char *open_packed_file(const char *filename, PackedFile *file);
+const PackedFileRecord *packed_file_record(const PackedFile *file,
+                                           uint64_t index);
+void close_packed_file(PackedFile *file);
+
+#endif	// PACKEDFILE_H
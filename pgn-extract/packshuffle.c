@@ -0,0 +1,506 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+/* packtool shuffle: shuffle the records of a packed file, of either
+ * version, into a uniformly random order in bounded memory.
+ *
+ * The first pass reads the input sequentially and sends each record to
+ * one of a number of buckets chosen at random.  Each bucket has a
+ * buffer in memory which, when full, is appended as a run to a single
+ * temporary file, so the writes are sequential and only one file is
+ * open however many buckets there are.  The second pass reads the
+ * buckets in turn, shuffles each in memory on the pipeline's worker
+ * threads and writes them out in order.
+ *
+ * The number of buckets is chosen so that the buckets in flight in the
+ * pipeline fit within the memory limit.  The output depends only on
+ * the input, the seed and the number of buckets, which is reported so
+ * that a run can be repeated with -B on a machine with a different
+ * memory limit or number of threads.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "bool.h"
+#include "mymalloc.h"
+#include "packed.h"
+#include "packedfile.h"
+#include "pipeline.h"
+#include "packtool.h"
+
+/* The default memory limit, in megabytes. */
+#define DEFAULT_MEMORY 1024
+/* The size of the blocks in which the input is read. */
+#define READ_BLOCK_SIZE (1 << 20)
+/* Leave room for buckets that are larger than average. */
+#define BUCKET_MARGIN 0.8
+
+typedef struct {
+    off_t offset;
+    size_t length;
+} Run;
+
+typedef struct {
+    /* Records waiting to be written to the temporary file. */
+    char *buffer;
+    size_t buffered;
+    /* Where the bucket's records are in the temporary file. */
+    Run *runs;
+    unsigned long num_runs, runs_space;
+    /* The total length of the runs. */
+    size_t length;
+} Bucket;
+
+typedef struct {
+    FILE *input;
+    const char *input_name;
+    FILE *output;
+    const char *output_name;
+    Boolean version2;
+    unsigned pv_depth;
+    size_t record_size;
+    /* The state of the generator that chooses the buckets. */
+    uint64_t seed;
+    unsigned long num_buckets;
+    Bucket *buckets;
+    /* The space in each bucket's buffer. */
+    size_t run_space;
+    /* The temporary file that holds the runs of all of the buckets. */
+    int temp_fd;
+    off_t temp_length;
+    /* The number of records scattered and written. */
+    uint64_t records;
+    uint64_t written;
+    Boolean verbose;
+} ShuffleContext;
+
+static void usage_and_exit(void);
+static uint64_t next_random(uint64_t *state);
+static size_t read_input_header(ShuffleContext *context, PackedFileHeader *header,
+                                unsigned char bytes[PACKED_FILE_HEADER_SIZE]);
+static void scatter(ShuffleContext *context, const char *data, size_t length);
+static void flush_bucket(ShuffleContext *context, Bucket *bucket);
+static Boolean read_bucket_chunk(void *arg, Chunk *chunk);
+static void process_bucket_chunk(void *arg, Chunk *chunk);
+static void write_bucket_chunk(void *arg, Chunk *chunk);
+
+static void
+usage_and_exit(void)
+{
+    fprintf(stderr,
+            "Usage: packtool shuffle [options] input output\n"
+            "Shuffle the records of a packed file (version 1 or 2).\n"
+            "The input may be - for the standard input if -B is given,\n"
+            "and the output may be - for the standard output.\n"
+            "    -s N    seed for the random numbers (default 1)\n"
+            "    -m N    memory limit in megabytes (default %d)\n"
+            "    -B N    number of buckets (default: from the input size and -m)\n"
+            "    -p N    depth of the principal variation of a version 1 input (default 0)\n"
+            "    -T dir  directory for the temporary file (default $TMPDIR or /tmp)\n"
+            "    -j N    number of worker threads (default: number of processors)\n"
+            "    -q      don't report progress\n",
+            DEFAULT_MEMORY);
+    exit(1);
+}
+
+/* The splitmix64 generator. */
+static uint64_t
+next_random(uint64_t *state)
+{
+    uint64_t z = (*state += UINT64_C(0x9e3779b97f4a7c15));
+
+    z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+    z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+    return z ^ (z >> 31);
+}
+
+/* Read the header of a version 2 input into header, or recognise a
+ * version 1 input.  Return the number of bytes at the start of bytes
+ * that are records of a version 1 input.
+ */
+static size_t
+read_input_header(ShuffleContext *context, PackedFileHeader *header,
+                  unsigned char bytes[PACKED_FILE_HEADER_SIZE])
+{
+    size_t length = fread(bytes, 1, PACKED_FILE_HEADER_SIZE, context->input);
+    const char *error;
+
+    context->version2 = length >= PACKED_FILE_MAGIC_LENGTH &&
+            memcmp(bytes, PACKED_FILE_MAGIC, PACKED_FILE_MAGIC_LENGTH) == 0;
+    if (!context->version2) {
+        context->record_size = packed_record_size(context->pv_depth);
+        return length;
+    }
+    error = decode_packed_file_header(bytes, length, header);
+    if (error != NULL) {
+        fprintf(stderr, "packtool: %s: %s\n", context->input_name, error);
+        exit(1);
+    }
+    /* Skip any extension of the header. */
+    for (length = header->header_size - PACKED_FILE_HEADER_SIZE; length > 0; length--) {
+        if (getc(context->input) == EOF) {
+            fprintf(stderr, "packtool: %s: the header is incomplete\n",
+                    context->input_name);
+            exit(1);
+        }
+    }
+    context->pv_depth = header->pv_depth;
+    context->record_size = header->record_size;
+    return 0;
+}
+
+/* Send each of the records in data to a random bucket.
+ * Only whole records are passed.
+ */
+static void
+scatter(ShuffleContext *context, const char *data, size_t length)
+{
+    const char *end = data + length;
+
+    for (; data < end; data += context->record_size) {
+        Bucket *bucket = &context->buckets[next_random(&context->seed) %
+                                           context->num_buckets];
+
+        if (bucket->buffered + context->record_size > context->run_space) {
+            flush_bucket(context, bucket);
+        }
+        memcpy(bucket->buffer + bucket->buffered, data, context->record_size);
+        bucket->buffered += context->record_size;
+        context->records++;
+        if (context->verbose && context->records % PROGRESS_INTERVAL == 0) {
+            fprintf(stderr, "\rScattered: %" PRIu64 " records", context->records);
+        }
+    }
+}
+
+/* Append the buffered records of bucket to the temporary file. */
+static void
+flush_bucket(ShuffleContext *context, Bucket *bucket)
+{
+    Run *run;
+    size_t written = 0;
+
+    if (bucket->buffered == 0) {
+        return;
+    }
+    while (written < bucket->buffered) {
+        ssize_t bytes = pwrite(context->temp_fd, bucket->buffer + written,
+                               bucket->buffered - written,
+                               context->temp_length + (off_t) written);
+        if (bytes <= 0) {
+            fprintf(stderr, "packtool: unable to write the temporary file\n");
+            exit(1);
+        }
+        written += (size_t) bytes;
+    }
+    if (bucket->num_runs == bucket->runs_space) {
+        bucket->runs_space = bucket->runs_space == 0 ? 16 : 2 * bucket->runs_space;
+        bucket->runs = (Run *) realloc_or_die((void *) bucket->runs,
+                                              bucket->runs_space * sizeof(*bucket->runs));
+    }
+    run = &bucket->runs[bucket->num_runs++];
+    run->offset = context->temp_length;
+    run->length = bucket->buffered;
+    bucket->length += bucket->buffered;
+    context->temp_length += (off_t) bucket->buffered;
+    bucket->buffered = 0;
+}
+
+/* Gather the runs of the next bucket into the chunk's buffer. */
+static Boolean
+read_bucket_chunk(void *arg, Chunk *chunk)
+{
+    ShuffleContext *context = (ShuffleContext *) arg;
+    const Bucket *bucket;
+    size_t filled = 0;
+    unsigned long r;
+
+    if (chunk->sequence >= context->num_buckets) {
+        return FALSE;
+    }
+    bucket = &context->buckets[chunk->sequence];
+    chunk_buffer_space(chunk, bucket->length);
+    for (r = 0; r < bucket->num_runs; r++) {
+        const Run *run = &bucket->runs[r];
+        size_t done = 0;
+
+        while (done < run->length) {
+            ssize_t bytes = pread(context->temp_fd, chunk->buffer + filled + done,
+                                  run->length - done, run->offset + (off_t) done);
+            if (bytes <= 0) {
+                fprintf(stderr, "packtool: unable to read the temporary file\n");
+                exit(1);
+            }
+            done += (size_t) bytes;
+        }
+        filled += run->length;
+    }
+    chunk->input = chunk->buffer;
+    chunk->input_length = filled;
+    return TRUE;
+}
+
+/* Shuffle the records of a bucket in place, with a generator seeded
+ * from the bucket's number so that the result does not depend on the
+ * order in which the buckets are processed.
+ * The buffer then becomes the output, to avoid copying it.
+ */
+static void
+process_bucket_chunk(void *arg, Chunk *chunk)
+{
+    const ShuffleContext *context = (const ShuffleContext *) arg;
+    size_t size = context->record_size;
+    size_t num_records = chunk->input_length / size;
+    uint64_t state = context->seed ^ (UINT64_C(0xd1b54a32d192ed03) * (chunk->sequence + 1));
+    /* A version 2 header may give any record size. */
+    char *temp = (char *) malloc_or_die(size);
+    size_t i;
+
+    for (i = num_records; i > 1; i--) {
+        size_t j = (size_t) (next_random(&state) % i);
+
+        if (j != i - 1) {
+            char *a = chunk->buffer + (i - 1) * size;
+            char *b = chunk->buffer + j * size;
+
+            memcpy(temp, a, size);
+            memcpy(a, b, size);
+            memcpy(b, temp, size);
+        }
+    }
+    free((void *) temp);
+    free((void *) chunk->output);
+    chunk->output = chunk->buffer;
+    chunk->output_space = chunk->buffer_space;
+    chunk->output_length = chunk->input_length;
+    chunk->buffer = NULL;
+    chunk->buffer_space = 0;
+    chunk->records = num_records;
+}
+
+static void
+write_bucket_chunk(void *arg, Chunk *chunk)
+{
+    ShuffleContext *context = (ShuffleContext *) arg;
+    uint64_t before = context->written;
+
+    if (fwrite(chunk->output, 1, chunk->output_length, context->output) !=
+            chunk->output_length) {
+        fprintf(stderr, "packtool: error writing %s\n", context->output_name);
+        exit(1);
+    }
+    /* Release the bucket's memory before the next is read. */
+    free((void *) chunk->output);
+    chunk->output = NULL;
+    chunk->output_space = chunk->output_length = 0;
+    context->written += chunk->records;
+    if (context->verbose &&
+            before / PROGRESS_INTERVAL != context->written / PROGRESS_INTERVAL) {
+        fprintf(stderr, "\rWritten: %" PRIu64 " records", context->written);
+    }
+}
+
+int
+shuffle_command(int argc, char *argv[])
+{
+    ShuffleContext context;
+    PackedFileHeader header;
+    Pipeline pipeline;
+    unsigned threads = default_thread_count();
+    unsigned long memory = DEFAULT_MEMORY;
+    uint64_t seed = 1;
+    const char *temp_dir = getenv("TMPDIR");
+    char *temp_name;
+    unsigned char bytes[PACKED_FILE_HEADER_SIZE];
+    char *buffers, *block;
+    size_t filled, got, read_size;
+    struct stat status;
+    unsigned long b;
+    int option;
+
+    memset(&context, 0, sizeof (context));
+    context.verbose = TRUE;
+    while ((option = getopt(argc, argv, "s:m:B:p:T:j:qh")) != -1) {
+        switch (option) {
+            case 's':
+                if (sscanf(optarg, "%" SCNu64, &seed) != 1) {
+                    fprintf(stderr, "packtool: invalid seed %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'm':
+                if (sscanf(optarg, "%lu", &memory) != 1 || memory == 0) {
+                    fprintf(stderr, "packtool: invalid memory limit %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'B':
+                if (sscanf(optarg, "%lu", &context.num_buckets) != 1 ||
+                        context.num_buckets == 0) {
+                    fprintf(stderr, "packtool: invalid number of buckets %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'p':
+                context.pv_depth = read_pv_depth(optarg);
+                break;
+            case 'T':
+                temp_dir = optarg;
+                break;
+            case 'j':
+                threads = read_thread_count(optarg);
+                break;
+            case 'q':
+                context.verbose = FALSE;
+                break;
+            default:
+                usage_and_exit();
+        }
+    }
+    if (optind + 2 != argc) {
+        usage_and_exit();
+    }
+    context.input_name = argv[optind];
+    context.output_name = argv[optind + 1];
+    context.input = open_file_or_die(context.input_name, "rb");
+    memory *= 1024 * 1024;
+
+    if (context.num_buckets == 0) {
+        /* Up to 2 * threads + 2 buckets are in memory at once in the
+         * second pass.
+         */
+        double bucket_length = BUCKET_MARGIN * memory / (2 * threads + 2);
+
+        if (fstat(fileno(context.input), &status) != 0 || !S_ISREG(status.st_mode)) {
+            fprintf(stderr, "packtool: -B is required when %s is not a regular file\n",
+                    context.input_name);
+            exit(1);
+        }
+        context.num_buckets = (unsigned long) (status.st_size / bucket_length) + 1;
+    }
+    if (context.verbose) {
+        fprintf(stderr, "Using %lu bucket%s\n", context.num_buckets,
+                context.num_buckets == 1 ? "" : "s");
+    }
+    context.seed = seed;
+    /* The first pass may use all of the memory for the buckets' buffers. */
+    context.buckets = (Bucket *) malloc_or_die(context.num_buckets * sizeof(*context.buckets));
+    memset(context.buckets, 0, context.num_buckets * sizeof(*context.buckets));
+
+    if (temp_dir == NULL || *temp_dir == '\0') {
+        temp_dir = "/tmp";
+    }
+    temp_name = (char *) malloc_or_die(strlen(temp_dir) + sizeof("/packtool.XXXXXX"));
+    sprintf(temp_name, "%s/packtool.XXXXXX", temp_dir);
+    context.temp_fd = mkstemp(temp_name);
+    if (context.temp_fd < 0) {
+        fprintf(stderr, "packtool: unable to create a temporary file in %s\n", temp_dir);
+        exit(1);
+    }
+    /* It is removed when it is closed. */
+    (void) unlink(temp_name);
+    free((void *) temp_name);
+
+    /* The first pass: scatter the records into the buckets, whose
+     * buffers share the memory.
+     */
+    filled = read_input_header(&context, &header, bytes);
+    context.run_space = memory / context.num_buckets / context.record_size *
+                        context.record_size;
+    if (context.run_space == 0) {
+        context.run_space = context.record_size;
+    }
+    buffers = (char *) malloc_or_die(context.num_buckets * context.run_space);
+    for (b = 0; b < context.num_buckets; b++) {
+        context.buckets[b].buffer = buffers + b * context.run_space;
+    }
+    read_size = READ_BLOCK_SIZE / context.record_size * context.record_size;
+    block = (char *) malloc_or_die(read_size);
+    memcpy(block, bytes, filled);
+    do {
+        size_t whole;
+
+        got = fread(block + filled, 1, read_size - filled, context.input);
+        filled += got;
+        whole = filled - filled % context.record_size;
+        scatter(&context, block, whole);
+        memmove(block, block + whole, filled - whole);
+        filled -= whole;
+    } while (got > 0);
+    if (ferror(context.input)) {
+        fprintf(stderr, "packtool: error reading %s\n", context.input_name);
+        exit(1);
+    }
+    else if (filled != 0 ||
+            (context.version2 && context.records != header.record_count)) {
+        fprintf(stderr, "packtool: %s does not hold a whole number of records%s\n",
+                context.input_name,
+                context.version2 ? " or its header is wrong" : "; check the pv depth (-p)");
+        exit(1);
+    }
+    for (b = 0; b < context.num_buckets; b++) {
+        flush_bucket(&context, &context.buckets[b]);
+    }
+    free((void *) block);
+    free((void *) buffers);
+    close_file_or_die(context.input, context.input_name);
+    if (context.verbose) {
+        fprintf(stderr, "\rScattered: %" PRIu64 " records\n", context.records);
+    }
+
+    /* The second pass: shuffle each bucket and write them in order. */
+    context.seed = seed;
+    context.output = open_file_or_die(context.output_name, "wb");
+    if (context.version2) {
+        PackedFileHeader output_header;
+
+        init_packed_file_header(&output_header, context.pv_depth, context.records);
+        output_header.record_size = (uint32_t) context.record_size;
+        encode_packed_file_header(&output_header, bytes);
+        if (fwrite(bytes, 1, sizeof(bytes), context.output) != sizeof(bytes)) {
+            fprintf(stderr, "packtool: error writing %s\n", context.output_name);
+            exit(1);
+        }
+    }
+    pipeline.read = read_bucket_chunk;
+    pipeline.process = process_bucket_chunk;
+    pipeline.write = write_bucket_chunk;
+    pipeline.context = &context;
+    run_pipeline(&pipeline, threads);
+    if (context.verbose) {
+        fprintf(stderr, "\rWritten: %" PRIu64 " records\n", context.written);
+    }
+
+    for (b = 0; b < context.num_buckets; b++) {
+        free((void *) context.buckets[b].runs);
+    }
+    free((void *) context.buckets);
+    (void) close(context.temp_fd);
+    close_file_or_die(context.output, context.output_name);
+    return 0;
+}
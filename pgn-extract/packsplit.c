@@ -0,0 +1,289 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+/* packtool split: divide the records of a packed file, of either
+ * version, between several outputs, such as training and validation
+ * sets, in a single pass.
+ *
+ * The output of a record is chosen from a hash of its position alone
+ * (see packed_position_key), not at random, so every occurrence of a
+ * position goes to the same output whatever its score and wherever it
+ * is in the input, and a position seen in training can never leak
+ * into validation.  The same seed and ratios always give the same
+ * division, and --split of pgn-extract --fencsv makes the same choice.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include "bool.h"
+#include "mymalloc.h"
+#include "packed.h"
+#include "packedfile.h"
+#include "packtool.h"
+
+/* The size of the blocks in which the input is read. */
+#define READ_BLOCK_SIZE (1 << 20)
+
+typedef struct {
+    FILE *fp;
+    const char *name;
+    /* The upper limit of the split fractions of this output's records. */
+    double limit;
+    uint64_t records;
+} SplitOutput;
+
+static void usage_and_exit(void);
+static unsigned read_ratios(const char *arg, SplitOutput *outputs, unsigned max_outputs);
+static void write_header(SplitOutput *output, unsigned pv_depth, size_t record_size);
+
+static void
+usage_and_exit(void)
+{
+    fprintf(stderr,
+            "Usage: packtool split [options] -r ratio[,ratio...] input output1 output2 ...\n"
+            "Divide the records of a packed file (version 1 or 2) between the outputs\n"
+            "by a hash of their positions, so that equal positions share an output.\n"
+            "Output i receives the given ratio of the positions and the last output\n"
+            "the remainder, so there must be one more output than ratios.\n"
+            "The input may be - for the standard input.\n"
+            "    -r R,.. ratios of the outputs other than the last\n"
+            "    -s N    seed that varies the division (default 0)\n"
+            "    -p N    depth of the principal variation of a version 1 input (default 0)\n"
+            "    -q      don't report progress\n");
+    exit(1);
+}
+
+/* Read the comma-separated ratios of arg into the limits of outputs.
+ * Return the number of ratios.
+ */
+static unsigned
+read_ratios(const char *arg, SplitOutput *outputs, unsigned max_outputs)
+{
+    unsigned num_ratios = 0;
+    double total = 0.0;
+
+    for (;;) {
+        double ratio;
+        int used;
+
+        if (num_ratios + 1 >= max_outputs ||
+                sscanf(arg, "%lf%n", &ratio, &used) != 1 || ratio <= 0.0) {
+            fprintf(stderr, "packtool: invalid ratios %s\n", arg);
+            exit(1);
+        }
+        total += ratio;
+        outputs[num_ratios].limit = total;
+        num_ratios++;
+        arg += used;
+        if (*arg == '\0') {
+            break;
+        }
+        else if (*arg != ',') {
+            fprintf(stderr, "packtool: invalid ratios %s\n", arg);
+            exit(1);
+        }
+        arg++;
+    }
+    if (total > 1.0) {
+        fprintf(stderr, "packtool: the ratios add up to more than 1\n");
+        exit(1);
+    }
+    return num_ratios;
+}
+
+/* Write a version 2 header for the records written so far to output. */
+static void
+write_header(SplitOutput *output, unsigned pv_depth, size_t record_size)
+{
+    PackedFileHeader header;
+    unsigned char bytes[PACKED_FILE_HEADER_SIZE];
+
+    init_packed_file_header(&header, pv_depth, output->records);
+    header.record_size = (uint32_t) record_size;
+    encode_packed_file_header(&header, bytes);
+    if (fwrite(bytes, 1, sizeof(bytes), output->fp) != sizeof(bytes)) {
+        fprintf(stderr, "packtool: error writing %s\n", output->name);
+        exit(1);
+    }
+}
+
+int
+split_command(int argc, char *argv[])
+{
+    SplitOutput *outputs = NULL;
+    unsigned num_outputs = 0, num_ratios = 0, o;
+    const char *ratios = NULL;
+    const char *input_name;
+    FILE *input;
+    PackedFileHeader header;
+    Boolean version2, verbose = TRUE;
+    unsigned pv_depth = 0;
+    uint64_t seed = 0, records = 0;
+    size_t record_size, filled, got, read_size;
+    unsigned char *block;
+    int option;
+
+    while ((option = getopt(argc, argv, "r:s:p:qh")) != -1) {
+        switch (option) {
+            case 'r':
+                ratios = optarg;
+                break;
+            case 's':
+                if (sscanf(optarg, "%" SCNu64, &seed) != 1) {
+                    fprintf(stderr, "packtool: invalid seed %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'p':
+                pv_depth = read_pv_depth(optarg);
+                break;
+            case 'q':
+                verbose = FALSE;
+                break;
+            default:
+                usage_and_exit();
+        }
+    }
+    if (ratios == NULL || argc - optind < 3) {
+        usage_and_exit();
+    }
+    input_name = argv[optind];
+    num_outputs = (unsigned) (argc - optind - 1);
+    outputs = (SplitOutput *) malloc_or_die(num_outputs * sizeof(*outputs));
+    memset(outputs, 0, num_outputs * sizeof(*outputs));
+    num_ratios = read_ratios(ratios, outputs, num_outputs);
+    if (num_ratios + 1 != num_outputs) {
+        fprintf(stderr, "packtool: %u ratio%s requires %u outputs\n",
+                num_ratios, num_ratios == 1 ? "" : "s", num_ratios + 1);
+        exit(1);
+    }
+    /* The last output takes everything else. */
+    outputs[num_ratios].limit = 2.0;
+
+    input = open_file_or_die(input_name, "rb");
+    block = (unsigned char *) malloc_or_die(READ_BLOCK_SIZE);
+    filled = fread(block, 1, PACKED_FILE_HEADER_SIZE, input);
+    version2 = filled >= PACKED_FILE_MAGIC_LENGTH &&
+            memcmp(block, PACKED_FILE_MAGIC, PACKED_FILE_MAGIC_LENGTH) == 0;
+    if (version2) {
+        const char *error = decode_packed_file_header(block, filled, &header);
+        size_t extension;
+
+        if (error != NULL) {
+            fprintf(stderr, "packtool: %s: %s\n", input_name, error);
+            exit(1);
+        }
+        for (extension = header.header_size - PACKED_FILE_HEADER_SIZE;
+                extension > 0; extension--) {
+            if (getc(input) == EOF) {
+                fprintf(stderr, "packtool: %s: the header is incomplete\n", input_name);
+                exit(1);
+            }
+        }
+        pv_depth = header.pv_depth;
+        record_size = header.record_size;
+        filled = 0;
+    }
+    else {
+        record_size = packed_record_size(pv_depth);
+    }
+
+    for (o = 0; o < num_outputs; o++) {
+        outputs[o].name = argv[optind + 1 + o];
+        outputs[o].fp = open_file_or_die(outputs[o].name, "wb");
+        if (version2) {
+            /* The count is filled in at the end. */
+            write_header(&outputs[o], pv_depth, record_size);
+        }
+    }
+
+    read_size = READ_BLOCK_SIZE / record_size * record_size;
+    do {
+        size_t whole, offset;
+
+        got = fread(block + filled, 1, read_size - filled, input);
+        filled += got;
+        whole = filled - filled % record_size;
+        for (offset = 0; offset < whole; offset += record_size) {
+            PackedRecord record;
+            double fraction;
+
+            if (version2) {
+                decode_packed_file_record(block + offset, 0, &record);
+            }
+            else {
+                decode_packed_record(block + offset, 0, &record);
+            }
+            fraction = split_fraction(packed_position_key(&record), seed);
+            o = 0;
+            while (fraction >= outputs[o].limit) {
+                o++;
+            }
+            if (fwrite(block + offset, 1, record_size, outputs[o].fp) != record_size) {
+                fprintf(stderr, "packtool: error writing %s\n", outputs[o].name);
+                exit(1);
+            }
+            outputs[o].records++;
+            records++;
+            if (verbose && records % PROGRESS_INTERVAL == 0) {
+                fprintf(stderr, "\rSplit: %" PRIu64 " records", records);
+            }
+        }
+        memmove(block, block + whole, filled - whole);
+        filled -= whole;
+    } while (got > 0);
+    if (ferror(input)) {
+        fprintf(stderr, "packtool: error reading %s\n", input_name);
+        exit(1);
+    }
+    else if (filled != 0 || (version2 && records != header.record_count)) {
+        fprintf(stderr, "packtool: %s does not hold a whole number of records%s\n",
+                input_name,
+                version2 ? " or its header is wrong" : "; check the pv depth (-p)");
+        exit(1);
+    }
+    close_file_or_die(input, input_name);
+    free((void *) block);
+
+    for (o = 0; o < num_outputs; o++) {
+        if (version2) {
+            if (fseek(outputs[o].fp, 0, SEEK_SET) != 0) {
+                fprintf(stderr, "packtool: %s must be a regular file to record its size\n",
+                        outputs[o].name);
+                exit(1);
+            }
+            write_header(&outputs[o], pv_depth, record_size);
+        }
+        close_file_or_die(outputs[o].fp, outputs[o].name);
+        if (verbose) {
+            fprintf(stderr, "%s%s: %" PRIu64 " records (%.2f%%)\n",
+                    o == 0 ? "\r" : "", outputs[o].name, outputs[o].records,
+                    records > 0 ? 100.0 * outputs[o].records / records : 0.0);
+        }
+    }
+    free((void *) outputs);
+    return 0;
+}
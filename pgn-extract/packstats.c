@@ -0,0 +1,514 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+/* packtool stats: summarise the records of a packed file, of either
+ * version, to check a dataset before training: the balance of the side
+ * to move, castling and en-passant rights, the number of pieces, the
+ * distribution of the scores and the validity of the positions and of
+ * the principal variations.
+ *
+ * The file is mapped into memory and divided into chunks that the
+ * pipeline's worker threads summarise independently; the summaries
+ * are added together in order, so the report does not depend on the
+ * number of threads.  The work per record is a handful of popcounts
+ * and comparisons, so a scan runs at about the speed of the disk.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <math.h>
+#include <unistd.h>
+#include "bool.h"
+#include "mymalloc.h"
+#include "packed.h"
+#include "packedfile.h"
+#include "pipeline.h"
+#include "packtool.h"
+
+/* The number of records summarised by each chunk. */
+#define CHUNK_RECORDS 65536
+/* The score histogram has bins one pawn wide over
+ * [-SCORE_RANGE, SCORE_RANGE), with one more at each end.
+ */
+#define SCORE_RANGE 10
+#define SCORE_BINS (2 * SCORE_RANGE + 2)
+/* Scores of at least this size, in pawns, are mates. */
+#define MATE_SCORE (PACKED_MATE_SCORE / 100.0)
+#define MAX_PIECES 32
+
+typedef struct {
+    uint64_t records;
+    uint64_t side_to_move[2];
+    uint64_t castling[4];
+    uint64_t any_castling;
+    uint64_t ep;
+    uint64_t piece_totals[PACKED_NUM_BITBOARDS];
+    /* The last counts positions with more than MAX_PIECES. */
+    uint64_t piece_counts[MAX_PIECES + 2];
+    /* Positions that cannot occur in a game. */
+    uint64_t invalid_positions;
+    uint64_t score_bins[SCORE_BINS];
+    uint64_t mates;
+    uint64_t not_a_number;
+    /* Of the scores that are neither mates nor NaN. */
+    uint64_t scored;
+    double score_sum, score_square_sum;
+    double min_score, max_score;
+    uint64_t pv_lengths[PACKED_MAX_PV_DEPTH + 1];
+    uint64_t invalid_pvs;
+} Stats;
+
+typedef struct {
+    const char *data;
+    size_t length, offset;
+    Boolean version2;
+    unsigned pv_depth;
+    size_t record_size;
+    Stats stats;
+} StatsContext;
+
+static void usage_and_exit(void);
+static unsigned popcount64(uint64_t bitboard);
+static Boolean valid_position(const PackedRecord *record);
+static unsigned pv_length(const PackedRecord *record, unsigned pv_depth, Boolean *valid);
+static void add_record(Stats *stats, const PackedRecord *record, unsigned pv_depth);
+static void add_stats(Stats *total, const Stats *stats);
+static Boolean read_stats_chunk(void *arg, Chunk *chunk);
+static void process_stats_chunk(void *arg, Chunk *chunk);
+static void write_stats_chunk(void *arg, Chunk *chunk);
+static void report(const Stats *stats, unsigned pv_depth);
+
+static void
+usage_and_exit(void)
+{
+    fprintf(stderr,
+            "Usage: packtool stats [options] input\n"
+            "Summarise the records of a packed file (version 1 or 2).\n"
+            "    -p N    depth of the principal variation of a version 1 input (default 0)\n"
+            "    -j N    number of worker threads (default: number of processors)\n");
+    exit(1);
+}
+
+/* Count the bits of bitboard in parallel within the word, without
+ * branches, so that the loop over the bitboards of a record can be
+ * vectorised.
+ */
+static unsigned
+popcount64(uint64_t bitboard)
+{
+    bitboard = bitboard - ((bitboard >> 1) & UINT64_C(0x5555555555555555));
+    bitboard = (bitboard & UINT64_C(0x3333333333333333)) +
+               ((bitboard >> 2) & UINT64_C(0x3333333333333333));
+    bitboard = (bitboard + (bitboard >> 4)) & UINT64_C(0x0f0f0f0f0f0f0f0f);
+    return (unsigned) ((bitboard * UINT64_C(0x0101010101010101)) >> 56);
+}
+
+/* Whether record holds one king of each colour, no more than one piece
+ * on a square, no pawns on the first or last rank and no more than 16
+ * pieces of each colour.
+ */
+static Boolean
+valid_position(const PackedRecord *record)
+{
+    const uint64_t back_ranks = UINT64_C(0xff000000000000ff);
+    uint64_t occupied = 0, white = 0, black = 0;
+    unsigned b;
+
+    for (b = 0; b < PACKED_NUM_BITBOARDS; b++) {
+        if ((occupied & record->pieces[b]) != 0) {
+            return FALSE;
+        }
+        occupied |= record->pieces[b];
+        if (b < PACKED_BLACK_PAWN) {
+            white |= record->pieces[b];
+        }
+        else {
+            black |= record->pieces[b];
+        }
+    }
+    return popcount64(record->pieces[PACKED_WHITE_KING]) == 1 &&
+           popcount64(record->pieces[PACKED_BLACK_KING]) == 1 &&
+           ((record->pieces[PACKED_WHITE_PAWN] | record->pieces[PACKED_BLACK_PAWN]) &
+            back_ranks) == 0 &&
+           popcount64(white) <= 16 && popcount64(black) <= 16;
+}
+
+/* Return the number of moves in the principal variation of record,
+ * and set *valid to whether the moves are plausible: the first moves
+ * a piece of the side to move that does not land on another of its
+ * own, no move leaves a square empty by moving to it, and the padding
+ * is only at the end.
+ */
+static unsigned
+pv_length(const PackedRecord *record, unsigned pv_depth, Boolean *valid)
+{
+    unsigned length = 0, i;
+
+    *valid = TRUE;
+    while (length < pv_depth && record->pv[length] != 0) {
+        unsigned from = record->pv[length] & 63;
+        unsigned to = (record->pv[length] >> 6) & 63;
+
+        if (from == to || record->pv[length] >= 64 * 64) {
+            *valid = FALSE;
+        }
+        length++;
+    }
+    for (i = length; i < pv_depth; i++) {
+        if (record->pv[i] != 0) {
+            *valid = FALSE;
+        }
+    }
+    if (length > 0) {
+        unsigned first = record->side_to_move == 0 ? PACKED_WHITE_PAWN : PACKED_BLACK_PAWN;
+        uint64_t own = 0;
+        unsigned b;
+
+        for (b = first; b < first + PACKED_NUM_BITBOARDS / 2; b++) {
+            own |= record->pieces[b];
+        }
+        if (((own >> (record->pv[0] & 63)) & 1) == 0 ||
+                ((own >> ((record->pv[0] >> 6) & 63)) & 1) != 0) {
+            *valid = FALSE;
+        }
+    }
+    return length;
+}
+
+static void
+add_record(Stats *stats, const PackedRecord *record, unsigned pv_depth)
+{
+    unsigned pieces = 0, b;
+    double score = half_to_double(record->score);
+    Boolean valid_pv;
+
+    stats->records++;
+    stats->side_to_move[record->side_to_move != 0]++;
+    for (b = 0; b < 4; b++) {
+        if ((record->castling >> b) & 1) {
+            stats->castling[b]++;
+        }
+    }
+    if (record->castling != 0) {
+        stats->any_castling++;
+    }
+    if (record->ep_square >= 0) {
+        stats->ep++;
+    }
+    for (b = 0; b < PACKED_NUM_BITBOARDS; b++) {
+        unsigned count = popcount64(record->pieces[b]);
+
+        stats->piece_totals[b] += count;
+        pieces += count;
+    }
+    stats->piece_counts[pieces <= MAX_PIECES ? pieces : MAX_PIECES + 1]++;
+    if (pieces > MAX_PIECES || !valid_position(record)) {
+        stats->invalid_positions++;
+    }
+
+    if (score != score) {
+        stats->not_a_number++;
+    }
+    else if (score >= MATE_SCORE || score <= -MATE_SCORE) {
+        stats->mates++;
+    }
+    else {
+        int bin = score < -SCORE_RANGE ? 0 :
+                  score >= SCORE_RANGE ? SCORE_BINS - 1 :
+                  (int) (score + SCORE_RANGE + 1);
+
+        if (stats->scored == 0 || score < stats->min_score) {
+            stats->min_score = score;
+        }
+        if (stats->scored == 0 || score > stats->max_score) {
+            stats->max_score = score;
+        }
+        stats->scored++;
+        stats->score_sum += score;
+        stats->score_square_sum += score * score;
+        stats->score_bins[bin]++;
+    }
+
+    stats->pv_lengths[pv_length(record, pv_depth, &valid_pv)]++;
+    if (!valid_pv) {
+        stats->invalid_pvs++;
+    }
+}
+
+static void
+add_stats(Stats *total, const Stats *stats)
+{
+    unsigned i;
+
+    if (stats->scored > 0) {
+        if (total->scored == 0 || stats->min_score < total->min_score) {
+            total->min_score = stats->min_score;
+        }
+        if (total->scored == 0 || stats->max_score > total->max_score) {
+            total->max_score = stats->max_score;
+        }
+    }
+    total->records += stats->records;
+    for (i = 0; i < 2; i++) {
+        total->side_to_move[i] += stats->side_to_move[i];
+    }
+    for (i = 0; i < 4; i++) {
+        total->castling[i] += stats->castling[i];
+    }
+    total->any_castling += stats->any_castling;
+    total->ep += stats->ep;
+    for (i = 0; i < PACKED_NUM_BITBOARDS; i++) {
+        total->piece_totals[i] += stats->piece_totals[i];
+    }
+    for (i = 0; i <= MAX_PIECES + 1; i++) {
+        total->piece_counts[i] += stats->piece_counts[i];
+    }
+    total->invalid_positions += stats->invalid_positions;
+    for (i = 0; i < SCORE_BINS; i++) {
+        total->score_bins[i] += stats->score_bins[i];
+    }
+    total->mates += stats->mates;
+    total->not_a_number += stats->not_a_number;
+    total->scored += stats->scored;
+    total->score_sum += stats->score_sum;
+    total->score_square_sum += stats->score_square_sum;
+    for (i = 0; i <= PACKED_MAX_PV_DEPTH; i++) {
+        total->pv_lengths[i] += stats->pv_lengths[i];
+    }
+    total->invalid_pvs += stats->invalid_pvs;
+}
+
+/* Pass the next CHUNK_RECORDS records of the mapped file, in place. */
+static Boolean
+read_stats_chunk(void *arg, Chunk *chunk)
+{
+    StatsContext *context = (StatsContext *) arg;
+    size_t length = CHUNK_RECORDS * context->record_size;
+
+    if (context->offset == context->length) {
+        return FALSE;
+    }
+    if (length > context->length - context->offset) {
+        length = context->length - context->offset;
+    }
+    chunk->input = context->data + context->offset;
+    chunk->input_length = length;
+    context->offset += length;
+    return TRUE;
+}
+
+static void
+process_stats_chunk(void *arg, Chunk *chunk)
+{
+    const StatsContext *context = (const StatsContext *) arg;
+    Stats *stats = (Stats *) chunk_output_space(chunk, sizeof(Stats));
+    const unsigned char *record = (const unsigned char *) chunk->input;
+    const unsigned char *end = record + chunk->input_length;
+
+    memset(stats, 0, sizeof(*stats));
+    for (; record < end; record += context->record_size) {
+        PackedRecord decoded;
+
+        if (context->version2) {
+            decode_packed_file_record(record, context->pv_depth, &decoded);
+        }
+        else {
+            decode_packed_record(record, context->pv_depth, &decoded);
+        }
+        add_record(stats, &decoded, context->pv_depth);
+    }
+}
+
+static void
+write_stats_chunk(void *arg, Chunk *chunk)
+{
+    StatsContext *context = (StatsContext *) arg;
+
+    add_stats(&context->stats, (const Stats *) chunk->output);
+}
+
+/* The percentage that count is of total. */
+#define PERCENT(count, total) ((total) > 0 ? 100.0 * (count) / (total) : 0.0)
+
+static void
+report(const Stats *stats, unsigned pv_depth)
+{
+    static const char piece_letters[] = "PNBRQKpnbrqk";
+    static const char castling_letters[] = "KQkq";
+    uint64_t records = stats->records;
+    unsigned i;
+
+    printf("records %" PRIu64 "\n", records);
+    printf("side to move: white %" PRIu64 " (%.2f%%), black %" PRIu64 " (%.2f%%)\n",
+           stats->side_to_move[0], PERCENT(stats->side_to_move[0], records),
+           stats->side_to_move[1], PERCENT(stats->side_to_move[1], records));
+    printf("castling rights:");
+    for (i = 0; i < 4; i++) {
+        printf(" %c %" PRIu64 " (%.2f%%)", castling_letters[i], stats->castling[i],
+               PERCENT(stats->castling[i], records));
+    }
+    printf(", any %" PRIu64 " (%.2f%%)\n", stats->any_castling,
+           PERCENT(stats->any_castling, records));
+    printf("en passant: %" PRIu64 " (%.2f%%)\n", stats->ep, PERCENT(stats->ep, records));
+    printf("invalid positions: %" PRIu64 "\n", stats->invalid_positions);
+
+    printf("mean pieces:");
+    for (i = 0; i < PACKED_NUM_BITBOARDS; i++) {
+        printf(" %c %.3f", piece_letters[i],
+               records > 0 ? (double) stats->piece_totals[i] / records : 0.0);
+    }
+    printf("\npieces on the board:\n");
+    for (i = 0; i <= MAX_PIECES + 1; i++) {
+        if (stats->piece_counts[i] > 0) {
+            printf("  %s%2u %" PRIu64 " (%.2f%%)\n", i > MAX_PIECES ? ">" : " ",
+                   i > MAX_PIECES ? MAX_PIECES : i,
+                   stats->piece_counts[i], PERCENT(stats->piece_counts[i], records));
+        }
+    }
+
+    printf("scores: mates %" PRIu64 ", not a number %" PRIu64, stats->mates,
+           stats->not_a_number);
+    if (stats->scored > 0) {
+        double mean = stats->score_sum / stats->scored;
+        double variance = stats->score_square_sum / stats->scored - mean * mean;
+
+        printf(", others mean %.3f, standard deviation %.3f, min %.3f, max %.3f",
+               mean, variance > 0.0 ? sqrt(variance) : 0.0,
+               stats->min_score, stats->max_score);
+    }
+    printf("\nscores in pawns, other than mates:\n");
+    for (i = 0; i < SCORE_BINS; i++) {
+        char range[32];
+
+        if (stats->score_bins[i] == 0) {
+            continue;
+        }
+        if (i == 0) {
+            sprintf(range, "< %d", -SCORE_RANGE);
+        }
+        else if (i == SCORE_BINS - 1) {
+            sprintf(range, ">= %d", SCORE_RANGE);
+        }
+        else {
+            sprintf(range, "[%d, %d)", (int) i - SCORE_RANGE - 1, (int) i - SCORE_RANGE);
+        }
+        printf("  %-10s %" PRIu64 " (%.2f%%)\n", range, stats->score_bins[i],
+               PERCENT(stats->score_bins[i], records));
+    }
+
+    if (pv_depth > 0) {
+        printf("principal variation lengths:\n");
+        for (i = 0; i <= pv_depth; i++) {
+            if (stats->pv_lengths[i] > 0) {
+                printf("  %2u %" PRIu64 " (%.2f%%)\n", i, stats->pv_lengths[i],
+                       PERCENT(stats->pv_lengths[i], records));
+            }
+        }
+        printf("invalid principal variations: %" PRIu64 "\n", stats->invalid_pvs);
+    }
+}
+
+int
+stats_command(int argc, char *argv[])
+{
+    StatsContext context;
+    Pipeline pipeline;
+    unsigned threads = default_thread_count();
+    const char *input_name;
+    FILE *input;
+    int option;
+
+    memset(&context, 0, sizeof (context));
+    while ((option = getopt(argc, argv, "p:j:h")) != -1) {
+        switch (option) {
+            case 'p':
+                context.pv_depth = read_pv_depth(optarg);
+                break;
+            case 'j':
+                threads = read_thread_count(optarg);
+                break;
+            default:
+                usage_and_exit();
+        }
+    }
+    if (optind + 1 != argc) {
+        usage_and_exit();
+    }
+    input_name = argv[optind];
+    input = open_file_or_die(input_name, "rb");
+    if (input == stdin || (context.data = map_file(input, &context.length)) == NULL) {
+        fprintf(stderr, "packtool: %s must be a non-empty regular file\n", input_name);
+        exit(1);
+    }
+    context.version2 = context.length >= PACKED_FILE_MAGIC_LENGTH &&
+            memcmp(context.data, PACKED_FILE_MAGIC, PACKED_FILE_MAGIC_LENGTH) == 0;
+    if (context.version2) {
+        PackedFileHeader header;
+        const char *error = decode_packed_file_header((const unsigned char *) context.data,
+                                                      context.length, &header);
+
+        if (error == NULL && (context.length < header.header_size ||
+                (context.length - header.header_size) / header.record_size !=
+                header.record_count)) {
+            error = "the record count does not match the size of the file";
+        }
+        if (error == NULL && header.pv_depth > PACKED_MAX_PV_DEPTH) {
+            /* The records are decoded into a PackedRecord. */
+            error = "the pv depth is too great to be summarised";
+        }
+        if (error != NULL) {
+            fprintf(stderr, "packtool: %s: %s\n", input_name, error);
+            exit(1);
+        }
+        context.pv_depth = header.pv_depth;
+        context.record_size = header.record_size;
+        context.offset = header.header_size;
+    }
+    else {
+        context.record_size = packed_record_size(context.pv_depth);
+    }
+    if ((context.length - context.offset) % context.record_size != 0) {
+        fprintf(stderr,
+                "packtool: %s does not hold a whole number of records%s\n",
+                input_name,
+                context.version2 ? "" : "; check the pv depth (-p)");
+        exit(1);
+    }
+
+    pipeline.read = read_stats_chunk;
+    pipeline.process = process_stats_chunk;
+    pipeline.write = write_stats_chunk;
+    pipeline.context = &context;
+    run_pipeline(&pipeline, threads);
+    unmap_file(context.data, context.length);
+    close_file_or_die(input, input_name);
+
+    report(&context.stats, context.pv_depth);
+    if (fflush(stdout) != 0) {
+        fprintf(stderr, "packtool: error writing the standard output\n");
+        exit(1);
+    }
+    return 0;
+}
@@ -0,0 +1,188 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+/* packtool: tools for building and processing the packed training
+ * datasets.  See packtool.h and packed.h.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "bool.h"
+#include "packed.h"
+#include "packtool.h"
+
+typedef struct {
+    const char *name;
+    int (*run)(int argc, char *argv[]);
+    const char *description;
+} Command;
+
+static const Command commands[] = {
+    { "lichess", lichess_command,
+      "convert the lichess evaluation database (JSONL, optionally zstd-compressed)" },
+    { "pack", pack_command,
+      "pack a CSV of bitboards as pack_dataset.py does" },
+    { "convert", convert_command,
+      "convert a packed file to version 2 (little-endian, aligned, with a header)" },
+    { "compress", compress_command,
+      "compress a version 2 packed file into independently readable blocks" },
+    { "decompress", decompress_command,
+      "decompress a block-compressed packed file to version 2" },
+    { "shuffle", shuffle_command,
+      "shuffle the records of a packed file in bounded memory" },
+    { "dedup", dedup_command,
+      "remove repeated positions from packed files, merging their evaluations" },
+    { "split", split_command,
+      "divide a packed file into training and validation sets by position" },
+    { "stats", stats_command,
+      "summarise the positions, scores and pvs of a packed file" },
+    { "info", info_command,
+      "describe a version 2 or block-compressed packed file" },
+};
+#define NUM_COMMANDS (sizeof (commands) / sizeof (commands[0]))
+
+static void usage_and_exit(void);
+
+static void
+usage_and_exit(void)
+{
+    unsigned c;
+
+    fprintf(stderr, "Usage: packtool command [options] arguments\n");
+    for (c = 0; c < NUM_COMMANDS; c++) {
+        fprintf(stderr, "    %-10s %s\n", commands[c].name, commands[c].description);
+    }
+    fprintf(stderr, "Use packtool command -h for the options of a command.\n");
+    exit(1);
+}
+
+/* Open filename, or the standard input or output if it is "-".
+ * Exit if it cannot be opened.
+ */
+FILE *
+open_file_or_die(const char *filename, const char *mode)
+{
+    FILE *fp;
+
+    if (strcmp(filename, "-") == 0) {
+        return mode[0] == 'r' ? stdin : stdout;
+    }
+    fp = fopen(filename, mode);
+    if (fp == NULL) {
+        fprintf(stderr, "packtool: unable to open %s\n", filename);
+        exit(1);
+    }
+    return fp;
+}
+
+/* Close fp, which was opened by open_file_or_die,
+ * and exit if any of its output could not be written.
+ */
+void
+close_file_or_die(FILE *fp, const char *filename)
+{
+    if (fp == stdin) {
+        return;
+    }
+    if (fp == stdout ? fflush(fp) != 0 : fclose(fp) != 0) {
+        fprintf(stderr, "packtool: error writing %s\n", filename);
+        exit(1);
+    }
+}
+
+/* Map the whole of fp, which must be open for reading, into memory.
+ * Return NULL, with *length undefined, if that is not possible,
+ * for instance because fp is not a regular file.
+ */
+const char *
+map_file(FILE *fp, size_t *length)
+{
+    struct stat status;
+    void *data;
+
+    if (fstat(fileno(fp), &status) != 0 || !S_ISREG(status.st_mode) ||
+            status.st_size == 0) {
+        return NULL;
+    }
+    data = mmap(NULL, (size_t) status.st_size, PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+    if (data == MAP_FAILED) {
+        return NULL;
+    }
+    (void) posix_madvise(data, (size_t) status.st_size, POSIX_MADV_SEQUENTIAL);
+    *length = (size_t) status.st_size;
+    return (const char *) data;
+}
+
+void
+unmap_file(const char *data, size_t length)
+{
+    (void) munmap((void *) data, length);
+}
+
+/* Return the number of threads given by arg (-j). */
+unsigned
+read_thread_count(const char *arg)
+{
+    unsigned threads;
+
+    if (sscanf(arg, "%u", &threads) != 1 || threads == 0) {
+        fprintf(stderr, "packtool: invalid number of threads %s\n", arg);
+        exit(1);
+    }
+    return threads;
+}
+
+/* Return the principal-variation depth given by arg (-p). */
+unsigned
+read_pv_depth(const char *arg)
+{
+    unsigned pv_depth;
+
+    if (sscanf(arg, "%u", &pv_depth) != 1 || pv_depth > PACKED_MAX_PV_DEPTH) {
+        fprintf(stderr, "packtool: the pv depth must be at most %d\n",
+                PACKED_MAX_PV_DEPTH);
+        exit(1);
+    }
+    return pv_depth;
+}
+
+int
+main(int argc, char *argv[])
+{
+    unsigned c;
+
+    if (argc < 2) {
+        usage_and_exit();
+    }
+    for (c = 0; c < NUM_COMMANDS; c++) {
+        if (strcmp(argv[1], commands[c].name) == 0) {
+            return commands[c].run(argc - 1, argv + 1);
+        }
+    }
+    usage_and_exit();
+    return 1;
+}
@@ -0,0 +1,52 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+/* packtool: tools for building and processing the packed training
+ * datasets (see packed.h).
+ * Each command is named by the first argument:
+ *     packtool command [options] arguments
+ */
+
+#ifndef PACKTOOL_H
+#define PACKTOOL_H
+
+/* How often to report progress, in records. */
+#define PROGRESS_INTERVAL 100000
+
+int lichess_command(int argc, char *argv[]);
+int pack_command(int argc, char *argv[]);
+int convert_command(int argc, char *argv[]);
+int info_command(int argc, char *argv[]);
+int compress_command(int argc, char *argv[]);
+int decompress_command(int argc, char *argv[]);
+int shuffle_command(int argc, char *argv[]);
+int split_command(int argc, char *argv[]);
+int dedup_command(int argc, char *argv[]);
+int stats_command(int argc, char *argv[]);
+
+FILE *open_file_or_die(const char *filename, const char *mode);
+const char *map_file(FILE *fp, size_t *length);
+void unmap_file(const char *data, size_t length);
+void close_file_or_die(FILE *fp, const char *filename);
+unsigned read_thread_count(const char *arg);
+unsigned read_pv_depth(const char *arg);
+
+#endif	// PACKTOOL_H
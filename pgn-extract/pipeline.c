@@ -0,0 +1,338 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+/* An ordered, multi-threaded pipeline for the dataset tools
+ * (see pipeline.h).
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "bool.h"
+#include "mymalloc.h"
+#include "pipeline.h"
+
+/* The state of a chunk in flight. */
+typedef enum {
+    CHUNK_FREE, CHUNK_READ, CHUNK_BUSY, CHUNK_DONE, CHUNK_END
+} ChunkState;
+
+typedef struct {
+    const Pipeline *pipeline;
+    Chunk *chunks;
+    ChunkState *states;
+    unsigned num_chunks;
+    /* Sequence numbers of the next chunk to be read,
+     * processed and written.
+     */
+    unsigned long next_read, next_process, next_write;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+} PipelineState;
+
+static void *reader_thread(void *arg);
+static void *worker_thread(void *arg);
+static void set_state(PipelineState *state, unsigned slot, ChunkState new_state);
+
+/* Change the state of a slot and wake everyone waiting for a change. */
+static void
+set_state(PipelineState *state, unsigned slot, ChunkState new_state)
+{
+    pthread_mutex_lock(&state->lock);
+    state->states[slot] = new_state;
+    pthread_cond_broadcast(&state->changed);
+    pthread_mutex_unlock(&state->lock);
+}
+
+static void *
+reader_thread(void *arg)
+{
+    PipelineState *state = (PipelineState *) arg;
+    Boolean more = TRUE;
+
+    while (more) {
+        unsigned slot = state->next_read % state->num_chunks;
+        Chunk *chunk = &state->chunks[slot];
+
+        pthread_mutex_lock(&state->lock);
+        while (state->states[slot] != CHUNK_FREE) {
+            pthread_cond_wait(&state->changed, &state->lock);
+        }
+        pthread_mutex_unlock(&state->lock);
+
+        chunk->sequence = state->next_read;
+        chunk->input = NULL;
+        chunk->input_length = 0;
+        more = state->pipeline->read(state->pipeline->context, chunk);
+        state->next_read++;
+        set_state(state, slot, more ? CHUNK_READ : CHUNK_END);
+    }
+    return NULL;
+}
+
+static void *
+worker_thread(void *arg)
+{
+    PipelineState *state = (PipelineState *) arg;
+
+    for (;;) {
+        unsigned slot;
+        Chunk *chunk;
+
+        pthread_mutex_lock(&state->lock);
+        slot = state->next_process % state->num_chunks;
+        while (state->states[slot] != CHUNK_READ && state->states[slot] != CHUNK_END) {
+            pthread_cond_wait(&state->changed, &state->lock);
+            slot = state->next_process % state->num_chunks;
+        }
+        if (state->states[slot] == CHUNK_END) {
+            pthread_mutex_unlock(&state->lock);
+            return NULL;
+        }
+        state->states[slot] = CHUNK_BUSY;
+        state->next_process++;
+        pthread_mutex_unlock(&state->lock);
+
+        chunk = &state->chunks[slot];
+        chunk->output_length = 0;
+        chunk->records = chunk->errors = 0;
+        chunk->result = NULL;
+        state->pipeline->process(state->pipeline->context, chunk);
+        set_state(state, slot, CHUNK_DONE);
+    }
+}
+
+/* Run pipeline with num_threads workers until its input is exhausted. */
+void
+run_pipeline(const Pipeline *pipeline, unsigned num_threads)
+{
+    PipelineState state;
+    pthread_t reader;
+    pthread_t *workers;
+    unsigned t;
+
+    if (num_threads == 0) {
+        num_threads = 1;
+    }
+    state.pipeline = pipeline;
+    state.num_chunks = 2 * num_threads + 2;
+    state.chunks = (Chunk *) malloc_or_die(state.num_chunks * sizeof (*state.chunks));
+    memset(state.chunks, 0, state.num_chunks * sizeof (*state.chunks));
+    state.states = (ChunkState *) malloc_or_die(state.num_chunks * sizeof (*state.states));
+    for (t = 0; t < state.num_chunks; t++) {
+        state.states[t] = CHUNK_FREE;
+    }
+    state.next_read = state.next_process = state.next_write = 0;
+    pthread_mutex_init(&state.lock, NULL);
+    pthread_cond_init(&state.changed, NULL);
+
+    workers = (pthread_t *) malloc_or_die(num_threads * sizeof (*workers));
+    if (pthread_create(&reader, NULL, reader_thread, &state) != 0) {
+        fprintf(stderr, "Unable to start a thread.\n");
+        exit(1);
+    }
+    for (t = 0; t < num_threads; t++) {
+        if (pthread_create(&workers[t], NULL, worker_thread, &state) != 0) {
+            fprintf(stderr, "Unable to start a thread.\n");
+            exit(1);
+        }
+    }
+
+    for (;;) {
+        unsigned slot = state.next_write % state.num_chunks;
+
+        pthread_mutex_lock(&state.lock);
+        while (state.states[slot] != CHUNK_DONE && state.states[slot] != CHUNK_END) {
+            pthread_cond_wait(&state.changed, &state.lock);
+        }
+        pthread_mutex_unlock(&state.lock);
+        if (state.states[slot] == CHUNK_END) {
+            break;
+        }
+        pipeline->write(pipeline->context, &state.chunks[slot]);
+        state.next_write++;
+        set_state(&state, slot, CHUNK_FREE);
+    }
+
+    pthread_join(reader, NULL);
+    for (t = 0; t < num_threads; t++) {
+        pthread_join(workers[t], NULL);
+    }
+    pthread_cond_destroy(&state.changed);
+    pthread_mutex_destroy(&state.lock);
+    for (t = 0; t < state.num_chunks; t++) {
+        (void) free((void *) state.chunks[t].buffer);
+        (void) free((void *) state.chunks[t].output);
+    }
+    (void) free((void *) state.chunks);
+    (void) free((void *) state.states);
+    (void) free((void *) workers);
+}
+
+/* Return space for length more bytes at the end of chunk's output,
+ * counting them as written.
+ */
+char *
+chunk_output_space(Chunk *chunk, size_t length)
+{
+    char *space;
+
+    if (chunk->output_length + length > chunk->output_space) {
+        size_t new_space = chunk->output_space == 0 ? 4096 : 2 * chunk->output_space;
+        while (new_space < chunk->output_length + length) {
+            new_space *= 2;
+        }
+        chunk->output = (char *) realloc_or_die((void *) chunk->output, new_space);
+        chunk->output_space = new_space;
+    }
+    space = chunk->output + chunk->output_length;
+    chunk->output_length += length;
+    return space;
+}
+
+/* Append length bytes of data to chunk's output. */
+void
+chunk_output(Chunk *chunk, const char *data, size_t length)
+{
+    memcpy(chunk_output_space(chunk, length), data, length);
+}
+
+/* Make sure that chunk's buffer has room for at least length bytes. */
+void
+chunk_buffer_space(Chunk *chunk, size_t length)
+{
+    if (length > chunk->buffer_space) {
+        chunk->buffer = (char *) realloc_or_die((void *) chunk->buffer, length);
+        chunk->buffer_space = length;
+    }
+}
+
+/* Prepare to divide length bytes of data into chunks of lines. */
+void
+init_mapped_line_source(LineSource *lines, const char *data, size_t length)
+{
+    memset(lines, 0, sizeof (*lines));
+    lines->mapped = data;
+    lines->mapped_length = length;
+}
+
+/* Prepare to divide the input obtained by calling fill into chunks
+ * of lines.
+ */
+void
+init_line_source(LineSource *lines,
+                 size_t (*fill)(void *source, char *space, size_t size),
+                 void *source)
+{
+    memset(lines, 0, sizeof (*lines));
+    lines->fill = fill;
+    lines->source = source;
+}
+
+/* Set chunk's input to the next chunk_size bytes or so of lines.
+ * Only the final line of the input may be without a newline.
+ * Return FALSE if the input is exhausted.
+ */
+Boolean
+read_line_chunk(LineSource *lines, Chunk *chunk, size_t chunk_size)
+{
+    size_t length;
+
+    if (lines->mapped != NULL) {
+        const char *start = lines->mapped + lines->mapped_offset;
+        size_t remaining = lines->mapped_length - lines->mapped_offset;
+        const char *newline;
+
+        length = remaining;
+        if (remaining > chunk_size) {
+            newline = memchr(start + chunk_size, '\n', remaining - chunk_size);
+            if (newline != NULL) {
+                length = newline + 1 - start;
+            }
+        }
+        chunk->input = start;
+        chunk->input_length = length;
+        lines->mapped_offset += length;
+        return length > 0;
+    }
+
+    chunk_buffer_space(chunk, lines->carry_length + chunk_size);
+    memcpy(chunk->buffer, lines->carry, lines->carry_length);
+    length = lines->carry_length;
+    lines->carry_length = 0;
+    for (;;) {
+        size_t got = 0, end;
+
+        if (!lines->end_of_input) {
+            got = lines->fill(lines->source, chunk->buffer + length,
+                              chunk->buffer_space - length);
+            if (got == 0) {
+                lines->end_of_input = TRUE;
+            }
+        }
+        length += got;
+        if (lines->end_of_input) {
+            break;
+        }
+        /* Hand over everything up to the last complete line. */
+        for (end = length; end > 0 && chunk->buffer[end - 1] != '\n'; end--) {
+        }
+        if (end > 0) {
+            lines->carry_length = length - end;
+            if (lines->carry_length > lines->carry_space) {
+                lines->carry = (char *) realloc_or_die((void *) lines->carry,
+                                                       lines->carry_length);
+                lines->carry_space = lines->carry_length;
+            }
+            memcpy(lines->carry, chunk->buffer + end, lines->carry_length);
+            length = end;
+            break;
+        }
+        else if (length == chunk->buffer_space) {
+            /* A line longer than the chunk. */
+            chunk_buffer_space(chunk, 2 * chunk->buffer_space);
+        }
+    }
+    chunk->input = chunk->buffer;
+    chunk->input_length = length;
+    return length > 0;
+}
+
+void
+free_line_source(LineSource *lines)
+{
+    (void) free((void *) lines->carry);
+    lines->carry = NULL;
+    lines->carry_length = lines->carry_space = 0;
+}
+
+/* The number of worker threads to use by default. */
+unsigned
+default_thread_count(void)
+{
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return processors > 0 ? (unsigned) processors : 1;
+}
@@ -0,0 +1,97 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+/* An ordered, multi-threaded pipeline for the dataset tools.
+ * A single reader thread divides the input into chunks, any number of
+ * worker threads process the chunks concurrently, and the calling thread
+ * writes the results in the order in which the chunks were read.
+ * Memory use is bounded by the fixed number of chunks in flight.
+ */
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+typedef struct {
+    /* The position of the chunk in the input, counting from 0. */
+    unsigned long sequence;
+    /* Storage owned by the chunk that read may use for the input. */
+    char *buffer;
+    size_t buffer_space;
+    /* The input to be processed; it need not be in buffer. */
+    const char *input;
+    size_t input_length;
+    /* The result of processing the input. */
+    char *output;
+    size_t output_length, output_space;
+    /* Counts maintained by process for the caller's use. */
+    unsigned long records, errors;
+    /* Anything else that process passes to write, such as the
+     * details of an error; NULL before process is called.
+     */
+    void *result;
+} Chunk;
+
+typedef struct {
+    /* Set chunk->input to the next piece of input.
+     * Return FALSE if there is none left.
+     * Called on the reader thread.
+     */
+    Boolean (*read)(void *context, Chunk *chunk);
+    /* Process chunk->input into chunk->output.
+     * Called concurrently on the worker threads.
+     */
+    void (*process)(void *context, Chunk *chunk);
+    /* Dispose of chunk->output.
+     * Called on the calling thread, in input order.
+     */
+    void (*write)(void *context, Chunk *chunk);
+    void *context;
+} Pipeline;
+
+/* A source of chunks that hold only whole lines. */
+typedef struct {
+    /* Either the whole input is mapped into memory ... */
+    const char *mapped;
+    size_t mapped_length, mapped_offset;
+    /* ... or fill is called for more of it.
+     * fill returns the number of bytes read, 0 at the end.
+     */
+    size_t (*fill)(void *source, char *space, size_t size);
+    void *source;
+    /* The start of an incomplete line left over from the previous chunk. */
+    char *carry;
+    size_t carry_length, carry_space;
+    Boolean end_of_input;
+} LineSource;
+
+void run_pipeline(const Pipeline *pipeline, unsigned num_threads);
+void init_mapped_line_source(LineSource *lines, const char *data, size_t length);
+void init_line_source(LineSource *lines,
+                      size_t (*fill)(void *source, char *space, size_t size),
+                      void *source);
+Boolean read_line_chunk(LineSource *lines, Chunk *chunk, size_t chunk_size);
+void free_line_source(LineSource *lines);
+char *chunk_output_space(Chunk *chunk, size_t length);
+void chunk_output(Chunk *chunk, const char *data, size_t length);
+void chunk_buffer_space(Chunk *chunk, size_t length);
+unsigned default_thread_count(void);
+
+#endif	// PIPELINE_H
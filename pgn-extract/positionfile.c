@@ -0,0 +1,248 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+/* Loading of position files (--positionfile); see positionfile.h.
+ * Reading a FEN string is the costly part of loading, so, as with
+ * --fencsv, a regular file is split at line boundaries into --jobs
+ * ranges that are read by separate processes; see linejobs.h.
+ * These return the hash codes of their lines through a temporary file,
+ * so that the parent can size the sets of positions of interest once
+ * before filling them.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "bool.h"
+#include "mymalloc.h"
+#include "defs.h"
+#include "typedef.h"
+#include "grammar.h"
+#include "apply.h"
+#include "linejobs.h"
+#include "positionfile.h"
+
+/* The hash code of a line, the material of a FEN string,
+ * and whether it is a polyglot code.
+ */
+typedef struct {
+    uint64_t code;
+    MaterialSignature material;
+    unsigned char polyglot;
+} PositionRecord;
+
+typedef struct {
+    unsigned long non_polyglot;
+    unsigned long polyglot;
+    unsigned long invalid;
+} PositionCounts;
+
+/* The files named by --positionfile. */
+static StringList *position_files = NULL;
+/* The file being loaded, for diagnostics. */
+static const char *current_position_file = NULL;
+
+/* Note filename to be loaded by load_position_files. */
+void
+add_position_file(const char *filename)
+{
+    position_files = save_string_list_item(position_files, filename);
+}
+
+/* Decode line as a position and set *record to its code.
+ * Return FALSE if it is neither a polyglot code nor a valid FEN string.
+ */
+static Boolean
+decode_position(const char *line, size_t length, PositionRecord *record)
+{
+    if (length <= 16 && strspn(line, "0123456789abcdefABCDEF") == length) {
+        char *end;
+
+        errno = 0;
+        record->code = strtoull(line, &end, 16);
+        record->material = 0;
+        record->polyglot = TRUE;
+        return errno == 0 && *end == '\0';
+    }
+    else {
+        Board *board = new_fen_board(line);
+
+        if (board == NULL) {
+            return FALSE;
+        }
+        record->code = board_weak_hash_value(board);
+        record->material = board->material_signature;
+        record->polyglot = FALSE;
+        free_board(board);
+        return TRUE;
+    }
+}
+
+/* Decode a line as a position; see LineJob.
+ * Write its record to outputs[0] if it is not NULL, otherwise add
+ * it directly to the positions of interest.
+ */
+static Boolean
+decode_line(char *line, size_t length, unsigned long line_number,
+            FILE *outputs[], void *counts)
+{
+    PositionCounts *position_counts = (PositionCounts *) counts;
+    PositionRecord record;
+
+    while (length > 0 && (line[length - 1] == ' ' || line[length - 1] == '\t')) {
+        length--;
+    }
+    line[length] = '\0';
+    while (*line == ' ' || *line == '\t') {
+        line++;
+        length--;
+    }
+    if (length == 0) {
+        /* Blank. */
+    }
+    else if (!decode_position(line, length, &record)) {
+        fprintf(GlobalState.logfile,
+                "Skipping line %lu of %s: invalid position %s.\n",
+                line_number, current_position_file, line);
+        position_counts->invalid++;
+    }
+    else {
+        if (record.polyglot) {
+            position_counts->polyglot++;
+        }
+        else {
+            position_counts->non_polyglot++;
+        }
+        if (outputs[0] != NULL) {
+            /* The worker checks its output for errors once it is flushed. */
+            (void) fwrite(&record, sizeof(record), 1, outputs[0]);
+        }
+        else if (record.polyglot) {
+            add_polyglot_hashcode_of_interest(record.code);
+        }
+        else {
+            add_hash_value_of_interest(record.code, record.material);
+        }
+    }
+    return TRUE;
+}
+
+static const LineJob position_job = {
+    decode_line, NULL, 1, sizeof(PositionCounts)
+};
+
+/* Add the records in records to the positions of interest. */
+static void
+add_records(FILE *records)
+{
+    PositionRecord record;
+
+    rewind(records);
+    while (fread(&record, sizeof(record), 1, records) == 1) {
+        if (record.polyglot) {
+            add_polyglot_hashcode_of_interest(record.code);
+        }
+        else {
+            add_hash_value_of_interest(record.code, record.material);
+        }
+    }
+}
+
+/* Load filename, of the given size, with GlobalState.num_jobs
+ * worker processes.
+ * Line numbers in diagnostics are relative to the start of each
+ * worker's range, as the workers do not read the lines before it.
+ */
+static void
+load_file_in_parallel(const char *filename, off_t size, PositionCounts *counts)
+{
+    FILE *outputs[1];
+
+    outputs[0] = tmpfile();
+    if (outputs[0] == NULL) {
+        fprintf(GlobalState.logfile,
+                "Unable to create the output of a --jobs worker.\n");
+        exit(1);
+    }
+    if (!process_lines_in_parallel(filename, size, &position_job,
+                                   outputs, counts) ||
+            fflush(outputs[0]) != 0 || ferror(outputs[0])) {
+        fprintf(GlobalState.logfile, "Failed to load %s.\n", filename);
+        exit(1);
+    }
+    /* Size the sets once, rather than growing them as they fill. */
+    reserve_positions_of_interest(counts->non_polyglot, counts->polyglot);
+    add_records(outputs[0]);
+    (void) fclose(outputs[0]);
+}
+
+/* Add the positions in the files named by --positionfile to the
+ * positions of interest.
+ */
+void
+load_position_files(void)
+{
+    StringList *file;
+
+    for (file = position_files; file != NULL; file = file->next) {
+        const char *filename = file->str;
+        PositionCounts counts = { 0, 0, 0 };
+        struct stat status;
+
+        current_position_file = filename;
+        if (stat(filename, &status) != 0) {
+            fprintf(GlobalState.logfile, "Unable to open the file: %s\n",
+                    filename);
+            exit(1);
+        }
+        else if (GlobalState.num_jobs > 1 && S_ISREG(status.st_mode)) {
+            load_file_in_parallel(filename, status.st_size, &counts);
+        }
+        else {
+            FILE *fpin = fopen(filename, "rb");
+            FILE *no_output = NULL;
+
+            if (fpin == NULL) {
+                fprintf(GlobalState.logfile, "Unable to open the file: %s\n",
+                        filename);
+                exit(1);
+            }
+            if (!process_line_range(fpin, 0, -1, &position_job,
+                                    &no_output, &counts)) {
+                fprintf(GlobalState.logfile, "Error reading %s.\n", filename);
+                exit(1);
+            }
+            (void) fclose(fpin);
+        }
+        if (GlobalState.verbosity > 1) {
+            fprintf(GlobalState.logfile,
+                    "%lu positions loaded from %s; %lu lines skipped.\n",
+                    counts.non_polyglot + counts.polyglot, filename,
+                    counts.invalid);
+        }
+    }
+}
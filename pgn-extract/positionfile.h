@@ -0,0 +1,35 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+/* Bulk loading of positions of interest (--positionfile).
+ * Each line of a position file is either a polyglot hash code in
+ * hexadecimal, as for -H, or a FEN string, as for a FEN pattern of -t,
+ * so large sets of positions can be searched for without a command-line
+ * argument or a tag-file line for each.
+ */
+
+#ifndef POSITIONFILE_H
+#define POSITIONFILE_H
+
+void add_position_file(const char *filename);
+void load_position_files(void);
+
+#endif	// POSITIONFILE_H
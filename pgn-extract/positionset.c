@@ -0,0 +1,198 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+/* A set of position hash codes; see positionset.h.
+ * A PositionSet that is all zero is empty and ready for use.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "bool.h"
+#include "mymalloc.h"
+#include "positionset.h"
+
+/* The smallest table allocated. */
+#define MIN_CAPACITY 64
+/* The smallest table, in slots, to be given a filter. */
+#define MIN_FILTERED_CAPACITY (1 << 16)
+
+/* Spread the bits of code over the high bits of the result.
+ * The polyglot codes of -H are Zobrist hashes, whose bits are well
+ * mixed, but the weak hash values of -x and FEN strings are XORs of
+ * HashTab entries of 57 bits, whose top bits are always clear.
+ */
+static uint64_t
+mix_code(uint64_t code)
+{
+    return code * UINT64_C(0x9e3779b97f4a7c15);
+}
+
+static size_t
+slot_of(const PositionSet *set, uint64_t code)
+{
+    return (size_t) (mix_code(code) >> 32) & (set->capacity - 1);
+}
+
+/* The filter word of the code whose mixed value is mixed. */
+static size_t
+filter_word(const PositionSet *set, uint64_t mixed)
+{
+    return (size_t) (mixed >> 20) & set->filter_mask;
+}
+
+/* The two bits of a filter word that the code whose mixed value
+ * is mixed sets.
+ */
+static uint64_t
+filter_bits(uint64_t mixed)
+{
+    return ((uint64_t) 1 << (mixed >> 58)) | ((uint64_t) 1 << ((mixed >> 52) & 63));
+}
+
+static void
+add_to_filter(PositionSet *set, uint64_t code)
+{
+    uint64_t mixed = mix_code(code);
+
+    set->filter[filter_word(set, mixed)] |= filter_bits(mixed);
+}
+
+/* Whether the filter admits code. */
+static Boolean
+in_filter(const PositionSet *set, uint64_t code)
+{
+    uint64_t mixed = mix_code(code);
+    uint64_t bits = filter_bits(mixed);
+
+    return (set->filter[filter_word(set, mixed)] & bits) == bits;
+}
+
+static void
+insert_code(PositionSet *set, uint64_t code)
+{
+    size_t slot = slot_of(set, code);
+
+    while (set->codes[slot] != 0) {
+        if (set->codes[slot] == code) {
+            return;
+        }
+        slot = (slot + 1) & (set->capacity - 1);
+    }
+    set->codes[slot] = code;
+    set->count++;
+    if (set->filter != NULL) {
+        add_to_filter(set, code);
+    }
+}
+
+/* Rebuild the table with the given capacity. */
+static void
+resize(PositionSet *set, size_t capacity)
+{
+    uint64_t *old_codes = set->codes;
+    size_t old_capacity = set->capacity;
+    size_t slot;
+
+    set->codes = (uint64_t *) malloc_or_die(capacity * sizeof(*set->codes));
+    memset(set->codes, 0, capacity * sizeof(*set->codes));
+    set->capacity = capacity;
+    set->count = 0;
+    if (set->filter != NULL) {
+        free((void *) set->filter);
+        set->filter = NULL;
+    }
+    if (capacity >= MIN_FILTERED_CAPACITY) {
+        size_t words = capacity / 4;
+
+        set->filter = (uint64_t *) malloc_or_die(words * sizeof(*set->filter));
+        memset(set->filter, 0, words * sizeof(*set->filter));
+        set->filter_mask = words - 1;
+    }
+    for (slot = 0; slot < old_capacity; slot++) {
+        if (old_codes[slot] != 0) {
+            insert_code(set, old_codes[slot]);
+        }
+    }
+    free((void *) old_codes);
+}
+
+/* Make room for expected codes in all, without further growth. */
+void
+position_set_reserve(PositionSet *set, size_t expected)
+{
+    size_t capacity = set->capacity > 0 ? set->capacity : MIN_CAPACITY;
+
+    while (capacity < 2 * expected) {
+        capacity *= 2;
+    }
+    if (capacity != set->capacity) {
+        resize(set, capacity);
+    }
+}
+
+void
+position_set_add(PositionSet *set, uint64_t code)
+{
+    if (code == 0) {
+        set->has_zero = TRUE;
+    }
+    else {
+        if (2 * (set->count + 1) > set->capacity) {
+            position_set_reserve(set, set->count + 1);
+        }
+        insert_code(set, code);
+    }
+}
+
+Boolean
+position_set_contains(const PositionSet *set, uint64_t code)
+{
+    if (code == 0) {
+        return set->has_zero;
+    }
+    else if (set->capacity == 0) {
+        return FALSE;
+    }
+    else if (set->filter != NULL && !in_filter(set, code)) {
+        return FALSE;
+    }
+    else {
+        size_t slot = slot_of(set, code);
+
+        while (set->codes[slot] != 0) {
+            if (set->codes[slot] == code) {
+                return TRUE;
+            }
+            slot = (slot + 1) & (set->capacity - 1);
+        }
+        return FALSE;
+    }
+}
+
+void
+free_position_set(PositionSet *set)
+{
+    free((void *) set->codes);
+    free((void *) set->filter);
+    memset(set, 0, sizeof(*set));
+}
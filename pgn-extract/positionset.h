@@ -0,0 +1,55 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+/* A set of 64-bit position hash codes, used for the positions of
+ * interest of -H, -x and --positionfile.
+ * The set is an open-addressing table with linear probing, kept at
+ * most half full and grown as needed, so a lookup that fails, as almost
+ * all do, costs a probe or two rather than a walk along a chain.
+ * Once the table is too large to stay in the cache it is preceded by a
+ * Bloom-style filter of one word per lookup, a quarter of its size.
+ */
+
+#ifndef POSITIONSET_H
+#define POSITIONSET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    /* The codes, with 0 marking an empty slot. */
+    uint64_t *codes;
+    /* The number of slots, a power of two, or 0 when nothing is held. */
+    size_t capacity;
+    size_t count;
+    /* Whether 0, which cannot be held in codes, is in the set. */
+    Boolean has_zero;
+    /* The filter, or NULL when the table is small. */
+    uint64_t *filter;
+    size_t filter_mask;
+} PositionSet;
+
+void position_set_reserve(PositionSet *set, size_t expected);
+void position_set_add(PositionSet *set, uint64_t code);
+Boolean position_set_contains(const PositionSet *set, uint64_t code);
+void free_position_set(PositionSet *set);
+
+#endif	// POSITIONSET_H
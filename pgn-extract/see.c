@@ -0,0 +1,304 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+/* Static exchange evaluation over bitboards (see see.h).
+ * The attacks are calculated with shifts and masks rather than tables,
+ * so nothing needs to be initialised and the functions can be used
+ * from any thread or process.
+ */
+
+#include <stdint.h>
+#include "bool.h"
+#include "see.h"
+
+#define FILE_A UINT64_C(0x0101010101010101)
+#define FILE_B (FILE_A << 1)
+#define FILE_G (FILE_A << 6)
+#define FILE_H (FILE_A << 7)
+#define RANK_1 UINT64_C(0x00000000000000ff)
+#define RANK_8 (RANK_1 << 56)
+
+/* Indices of the pieces within the bitboards of one colour. */
+enum { PAWN_INDEX, KNIGHT_INDEX, BISHOP_INDEX, ROOK_INDEX, QUEEN_INDEX, KING_INDEX,
+       PIECES_PER_SIDE };
+
+/* The value of a king only needs to exceed the others together. */
+static const int piece_values[PIECES_PER_SIDE] = {
+    SEE_PAWN_VALUE, SEE_KNIGHT_VALUE, SEE_BISHOP_VALUE,
+    SEE_ROOK_VALUE, SEE_QUEEN_VALUE, 100 * SEE_QUEEN_VALUE
+};
+
+static const int bishop_directions[4][2] = { {1, 1}, {1, -1}, {-1, 1}, {-1, -1} };
+static const int rook_directions[4][2] = { {1, 0}, {-1, 0}, {0, 1}, {0, -1} };
+
+static uint64_t
+knight_attacks(uint64_t knights)
+{
+    uint64_t one = ((knights << 1) & ~FILE_A) | ((knights >> 1) & ~FILE_H);
+    uint64_t two = ((knights << 2) & ~(FILE_A | FILE_B)) |
+                   ((knights >> 2) & ~(FILE_G | FILE_H));
+
+    return (one << 16) | (one >> 16) | (two << 8) | (two >> 8);
+}
+
+static uint64_t
+king_attacks(uint64_t kings)
+{
+    uint64_t sideways = ((kings << 1) & ~FILE_A) | ((kings >> 1) & ~FILE_H);
+    uint64_t row = kings | sideways;
+
+    return sideways | (row << 8) | (row >> 8);
+}
+
+/* The squares attacked by pawns of the given side. */
+static uint64_t
+pawn_attacks(uint64_t pawns, int side)
+{
+    if (side == 0) {
+        return ((pawns << 7) & ~FILE_H) | ((pawns << 9) & ~FILE_A);
+    }
+    else {
+        return ((pawns >> 9) & ~FILE_H) | ((pawns >> 7) & ~FILE_A);
+    }
+}
+
+/* The squares attacked from square along directions, up to and
+ * including the first occupied square in each.
+ */
+static uint64_t
+ray_attacks(int square, uint64_t occupied, const int directions[4][2])
+{
+    uint64_t attacks = 0;
+    unsigned d;
+
+    for (d = 0; d < 4; d++) {
+        int rank = square / 8 + directions[d][0];
+        int file = square % 8 + directions[d][1];
+
+        while (rank >= 0 && rank < 8 && file >= 0 && file < 8) {
+            uint64_t bit = (uint64_t) 1 << (rank * 8 + file);
+
+            attacks |= bit;
+            if (occupied & bit) {
+                break;
+            }
+            rank += directions[d][0];
+            file += directions[d][1];
+        }
+    }
+    return attacks;
+}
+
+/* The pieces of both sides within occupied that attack square. */
+static uint64_t
+attackers_to(const uint64_t pieces[12], int square, uint64_t occupied)
+{
+    const uint64_t *white = pieces, *black = pieces + PIECES_PER_SIDE;
+    uint64_t target = (uint64_t) 1 << square;
+    uint64_t diagonal = white[BISHOP_INDEX] | white[QUEEN_INDEX] |
+                        black[BISHOP_INDEX] | black[QUEEN_INDEX];
+    uint64_t straight = white[ROOK_INDEX] | white[QUEEN_INDEX] |
+                        black[ROOK_INDEX] | black[QUEEN_INDEX];
+    uint64_t attackers =
+            (pawn_attacks(target, 1) & white[PAWN_INDEX]) |
+            (pawn_attacks(target, 0) & black[PAWN_INDEX]) |
+            (knight_attacks(target) & (white[KNIGHT_INDEX] | black[KNIGHT_INDEX])) |
+            (king_attacks(target) & (white[KING_INDEX] | black[KING_INDEX]));
+
+    if (ray_attacks(square, 0, bishop_directions) & diagonal) {
+        attackers |= ray_attacks(square, occupied, bishop_directions) & diagonal;
+    }
+    if (ray_attacks(square, 0, rook_directions) & straight) {
+        attackers |= ray_attacks(square, occupied, rook_directions) & straight;
+    }
+    return attackers & occupied;
+}
+
+static uint64_t
+side_pieces(const uint64_t pieces[12], int side)
+{
+    const uint64_t *own = pieces + side * PIECES_PER_SIDE;
+    uint64_t all = 0;
+    unsigned p;
+
+    for (p = 0; p < PIECES_PER_SIDE; p++) {
+        all |= own[p];
+    }
+    return all;
+}
+
+/* The index within its side of the piece on square, or -1. */
+static int
+piece_on(const uint64_t pieces[12], int square)
+{
+    uint64_t bit = (uint64_t) 1 << square;
+    unsigned b;
+
+    for (b = 0; b < 2 * PIECES_PER_SIDE; b++) {
+        if (pieces[b] & bit) {
+            return b % PIECES_PER_SIDE;
+        }
+    }
+    return -1;
+}
+
+/* Return the material that side_to_move expects to gain, in
+ * centipawns, by capturing on to with the piece on from, after the
+ * best sequence of recaptures on that square by both sides, either
+ * of which may stop at any point.
+ * to may be ep_square for a capture en passant by a pawn.
+ */
+int
+static_exchange(const uint64_t pieces[12], int side_to_move,
+                int from, int to, int ep_square)
+{
+    uint64_t occupied = side_pieces(pieces, 0) | side_pieces(pieces, 1);
+    uint64_t from_bit = (uint64_t) 1 << from;
+    int attacker = piece_on(pieces, from);
+    int side = side_to_move;
+    int gain[32];
+    int depth = 0;
+
+    if (attacker == PAWN_INDEX && to == ep_square) {
+        /* The captured pawn is beside the capturing one. */
+        gain[0] = SEE_PAWN_VALUE;
+        occupied &= ~((uint64_t) 1 << (side_to_move == 0 ? to - 8 : to + 8));
+    }
+    else {
+        int captured = piece_on(pieces, to);
+
+        gain[0] = captured >= 0 ? piece_values[captured] : 0;
+    }
+    for (;;) {
+        uint64_t attackers, opponents;
+        int p;
+
+        depth++;
+        /* Speculatively, what is gained if the attacker is recaptured. */
+        gain[depth] = piece_values[attacker] - gain[depth - 1];
+        if ((-gain[depth - 1] > gain[depth] ? -gain[depth - 1] : gain[depth]) < 0 ||
+                depth == 31) {
+            break;
+        }
+        occupied &= ~from_bit;
+        /* Sliders behind the attacker are uncovered. */
+        attackers = attackers_to(pieces, to, occupied);
+        side ^= 1;
+        opponents = attackers & side_pieces(pieces, side ^ 1);
+        from_bit = 0;
+        for (p = 0; p < PIECES_PER_SIDE && from_bit == 0; p++) {
+            uint64_t candidates = attackers & pieces[side * PIECES_PER_SIDE + p];
+
+            if (candidates != 0) {
+                from_bit = candidates & (~candidates + 1);
+                attacker = p;
+            }
+        }
+        if (from_bit == 0 || (attacker == KING_INDEX && opponents != 0)) {
+            /* No recapture, or only into check. */
+            break;
+        }
+    }
+    while (--depth > 0) {
+        gain[depth - 1] = -(-gain[depth - 1] > gain[depth] ? -gain[depth - 1] : gain[depth]);
+    }
+    return gain[0];
+}
+
+/* Whether the king of side is attacked. */
+Boolean
+side_in_check(const uint64_t pieces[12], int side)
+{
+    uint64_t king = pieces[side * PIECES_PER_SIDE + KING_INDEX];
+    uint64_t occupied = side_pieces(pieces, 0) | side_pieces(pieces, 1);
+    int square = 0;
+
+    if (king == 0) {
+        return FALSE;
+    }
+    while ((king & 1) == 0) {
+        king >>= 1;
+        square++;
+    }
+    return (attackers_to(pieces, square, occupied) & side_pieces(pieces, side ^ 1)) != 0;
+}
+
+/* Whether the position is quiet for side_to_move: it is not in check,
+ * has no pawn about to promote, and has no capture that wins material
+ * by static exchange evaluation.
+ */
+Boolean
+quiet_position(const uint64_t pieces[12], int side_to_move, int ep_square)
+{
+    const uint64_t *own = pieces + side_to_move * PIECES_PER_SIDE;
+    uint64_t ours = side_pieces(pieces, side_to_move);
+    uint64_t theirs = side_pieces(pieces, side_to_move ^ 1);
+    uint64_t occupied = ours | theirs;
+    uint64_t last_rank = side_to_move == 0 ? RANK_8 : RANK_1;
+    uint64_t pushes = side_to_move == 0 ? own[PAWN_INDEX] << 8 : own[PAWN_INDEX] >> 8;
+    uint64_t targets;
+
+    if (side_in_check(pieces, side_to_move)) {
+        return FALSE;
+    }
+    if ((pushes & ~occupied & last_rank) != 0 ||
+            (pawn_attacks(own[PAWN_INDEX], side_to_move) & theirs & last_rank) != 0) {
+        return FALSE;
+    }
+    targets = theirs & ~pieces[(side_to_move ^ 1) * PIECES_PER_SIDE + KING_INDEX];
+    if (ep_square >= 0) {
+        targets |= (uint64_t) 1 << ep_square;
+    }
+    while (targets != 0) {
+        int to = 0;
+        uint64_t target_bit = targets & (~targets + 1);
+        uint64_t attackers;
+        int captured;
+
+        targets &= targets - 1;
+        while (((target_bit >> to) & 1) == 0) {
+            to++;
+        }
+        attackers = attackers_to(pieces, to, occupied) & ours;
+        if (to == ep_square) {
+            attackers &= own[PAWN_INDEX];
+            captured = PAWN_INDEX;
+        }
+        else {
+            captured = piece_on(pieces, to);
+        }
+        while (attackers != 0) {
+            int from = 0;
+            uint64_t from_bit = attackers & (~attackers + 1);
+
+            attackers &= attackers - 1;
+            while (((from_bit >> from) & 1) == 0) {
+                from++;
+            }
+            /* Taking a more valuable piece always wins something. */
+            if (piece_values[captured] > piece_values[piece_on(pieces, from)] ||
+                    static_exchange(pieces, side_to_move, from, to, ep_square) > 0) {
+                return FALSE;
+            }
+        }
+    }
+    return TRUE;
+}
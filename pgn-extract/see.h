@@ -0,0 +1,47 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+/* Static exchange evaluation, and a test of whether a position is
+ * quiet, over the twelve bitboards of a position with the conventions
+ * of bitboard.h: squares from a1 (0) to h8 (63), White pawn ... king
+ * then Black pawn ... king, side to move 0 for White and 1 for Black,
+ * and an en-passant square of -1 if there is none.
+ * Pins are ignored, as is usual for static exchange evaluation.
+ */
+
+#ifndef SEE_H
+#define SEE_H
+
+#include <stdint.h>
+
+/* The values of the pieces, in centipawns. */
+#define SEE_PAWN_VALUE 100
+#define SEE_KNIGHT_VALUE 300
+#define SEE_BISHOP_VALUE 300
+#define SEE_ROOK_VALUE 500
+#define SEE_QUEEN_VALUE 900
+
+int static_exchange(const uint64_t pieces[12], int side_to_move,
+                    int from, int to, int ep_square);
+Boolean side_in_check(const uint64_t pieces[12], int side);
+Boolean quiet_position(const uint64_t pieces[12], int side_to_move, int ep_square);
+
+#endif	// SEE_H
@@ -0,0 +1,5 @@
+positions 3
+input 179
+output 262
+failed 0
+abandoned 0
@@ -0,0 +1,55 @@
+#!/bin/sh
+# A minimal UCI engine used to test uci-pool.
+# The score for a position is the length of its FEN string,
+# from the point of view of the side to move.
+#
+# The following environment variables select positions on which
+# the engine misbehaves:
+#     STUB_CRASH - exit without replying, the first time only.
+#     STUB_HANG  - stop replying, the first time only.
+#     STUB_FAIL  - always reject the position as NapoleonPP does.
+#     STUB_MATED - report the side to move as checkmated; a list of
+#                  positions separated by |.
+# Whether the first time has passed is recorded in files
+# in the current directory.
+
+echo "uci-stub"
+fen=""
+while read -r command args; do
+    case "$command" in
+        isready)
+            echo "readyok"
+            ;;
+        position)
+            fen="${args#fen }"
+            ;;
+        go)
+            if [ "$fen" = "$STUB_CRASH" ] && [ ! -f uci-stub-crashed ]; then
+                touch uci-stub-crashed
+                exit 1
+            fi
+            if [ "$fen" = "$STUB_HANG" ] && [ ! -f uci-stub-hung ]; then
+                touch uci-stub-hung
+                exec sleep 5
+            fi
+            if [ "$fen" = "$STUB_FAIL" ]; then
+                echo "Position not valid"
+                continue
+            fi
+            case "|$STUB_MATED|" in
+                *"|$fen|"*)
+                    echo "info depth 0 score mate 0"
+                    echo "bestmove (none)"
+                    continue
+                    ;;
+            esac
+            depth="${args#depth }"
+            echo "info depth 1 score cp 0 pv a2a3"
+            echo "info depth $depth score cp ${#fen} pv e2e4 e7e5"
+            echo "bestmove e2e4"
+            ;;
+        quit)
+            exit 0
+            ;;
+    esac
+done
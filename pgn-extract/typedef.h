@@ -40,7 +40,10 @@
 #ifndef TYPEDEF_H
 #define TYPEDEF_H
 
-typedef enum { SOURCE, SAN, EPD, FEN, CM, LALG, HALG, ELALG, XLALG, XOLALG, UCI } OutputFormat;
+typedef enum {
+    SOURCE, SAN, EPD, FEN, CM, LALG, HALG, ELALG, XLALG, XOLALG, UCI,
+    BITBOARDS, PACKED
+} OutputFormat;
 
     /* Define a type to specify whether a move gives check, checkmate,
      * or nocheck.
@@ -119,6 +122,10 @@ typedef struct move {
      * a FEN description. Only relevant if (epd != NULL).
      */
     char *fen_suffix;
+    /* Whether the position after this move is quiet.
+     * Only set if (epd != NULL) and GlobalState.quiet_positions_only.
+     */
+    Boolean quiet;
     /* zobrist hash code of the position after this move has been played.
      * Only set if GlobalState.add_hashcode_comments. 
      */
@@ -286,6 +293,14 @@ typedef struct {
     Boolean keep_checks;
     /* Whether to output an evaluation value after each move. */
     Boolean output_evaluation;
+    /* Whether the input is CSV rows of evaluated positions (--fencsv). */
+    Boolean fen_csv_input;
+    /* Whether the input is lines of a FEN and UCI moves (--ucilines). */
+    Boolean uci_lines_input;
+    /* Whether to output only quiet positions with -Wfen, -Wepd and --fencsv
+     * (--quietpositions).
+     */
+    Boolean quiet_positions_only;
     /* Whether to keep games which have incorrect moves. */
     Boolean keep_broken_games;
     /* Whether to suppress irrelevant ep info in EPD and FEN output. */
@@ -329,6 +344,12 @@ typedef struct {
     int output_ply_limit;
     /* How quiescent the game needs to be for it to be output. */
     unsigned quiescence_threshold;
+    /* Number of processes for --fencsv (--jobs). */
+    unsigned num_jobs;
+    /* Number of principal-variation moves in --fencsv output (--pvdepth). */
+    unsigned pv_depth;
+    /* PACKED_AUGMENT_ bits of the augmentations of --fencsv (--augment). */
+    unsigned augment;
     /* First game number to process. */
     unsigned long first_game_number;
     /* Last game number to process. */
@@ -423,6 +444,12 @@ typedef struct {
     const char *current_input_file;
     /* File of ECO lines. */
     const char *eco_file;
+    /* Binary cache of the table built from eco_file (--ecocache). */
+    const char *eco_cache_file;
+    /* Shared library of position evaluation (--evalplugin). */
+    const char *eval_plugin;
+    /* File recording progress so that a run can be resumed (--checkpoint). */
+    const char *checkpoint_file;
     /* Where to write the extracted games. */
     FILE *outputfile;
     /* Output file name. */
@@ -433,6 +460,12 @@ typedef struct {
     FILE *duplicate_file;
     /* Where to write games that don't match the criteria. */
     FILE *non_matching_file;
+    /* Where to write the held-out split of games or positions (--split). */
+    FILE *split_file;
+    /* The fraction of games or positions written to split_file. */
+    double split_ratio;
+    /* Varies which games or positions are held out (--splitseed). */
+    HashCode split_seed;
     /* Which game numbers to output (matching_game_numbers != NULL) */
     game_number *matching_game_numbers;
     /* Which game number to output next (matching_game_numbers != NULL) */
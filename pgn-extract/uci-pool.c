@@ -0,0 +1,1089 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+/* uci-pool: label a file of FEN positions by running them through
+ * a pool of UCI engine processes.
+ *
+ * Positions are taken from a single shared queue by whichever engine
+ * is idle, so a run of slow positions never leaves the other engines
+ * without work.  Each position has a time limit; an engine that exceeds
+ * it, crashes or reports an error is killed and restarted, and the
+ * position is retried up to a limit.
+ *
+ * The output is CSV in the same form as convert_lichess_dataset.py:
+ *     fen,depth,score[,pv]
+ * with the score in centipawns from White's point of view and
+ * mates reported as +/-MATE_SCORE.
+ * By default rows are written in input order. With -k they are written
+ * as soon as they are available, prefixed by the position's index in
+ * the input (from 0).
+ *
+ * With -c, progress is recorded in a checkpoint file every so many
+ * positions and when the run is interrupted.  Rerunning the same command
+ * resumes after the last position recorded, and the output is the same
+ * as that of an uninterrupted run.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "bool.h"
+#include "mymalloc.h"
+#include "checkpoint.h"
+
+/* The score used for a forced mate; as in convert_lichess_dataset.py. */
+#define MATE_SCORE 3000
+/* How long an engine has to answer isready after being started. */
+#define STARTUP_TIMEOUT 10.0
+/* How many consecutive failures to start an engine are tolerated. */
+#define MAX_START_FAILURES 3
+/* Initial size of the buffer for an engine's partial output line. */
+#define LINE_SPACE 256
+/* Default number of positions between checkpoints. */
+#define CHECKPOINT_INTERVAL 1000
+
+/* The state of an engine process. */
+typedef enum {
+    ENGINE_STARTING, ENGINE_IDLE, ENGINE_SEARCHING
+} EngineStatus;
+
+/* A position to be analysed. */
+typedef struct Job {
+    /* Index of the position in the input, from 0. */
+    unsigned long index;
+    char *fen;
+    /* How many times analysis of this position has failed. */
+    unsigned failures;
+    /* Offset in the input of the end of the position's line. */
+    long input_end;
+    struct Job *next;
+} Job;
+
+typedef struct {
+    /* Number of this engine, for diagnostics. */
+    unsigned id;
+    pid_t pid;
+    /* Pipes to the engine's stdin and from its stdout. */
+    int to_engine, from_engine;
+    EngineStatus status;
+    /* Time by which the engine must respond. */
+    double deadline;
+    unsigned start_failures;
+    /* The job being analysed, if any. */
+    Job *job;
+    /* Incomplete output line read from the engine. */
+    char *line;
+    size_t line_length, line_space;
+    /* Details from the latest info line of the current search. */
+    Boolean have_score;
+    int depth;
+    long score;
+    Boolean mate;
+    char *pv;
+} Engine;
+
+/* The completed row for a position, held until all the
+ * rows before it have been written (ordered output).
+ */
+typedef struct {
+    Boolean done;
+    /* NULL if the position could not be analysed. */
+    char *row;
+    /* The position, if it could not be analysed. */
+    char *failed_fen;
+    long input_end;
+} Result;
+
+/* Settings from the command line. */
+static const char *engine_command = "../NapoleonPP";
+static unsigned num_engines = 1;
+static unsigned search_depth = 10;
+static double position_timeout = 60.0;
+static unsigned max_failures = 2;
+static unsigned pv_depth = 0;
+static Boolean keyed_output = FALSE;
+static Boolean verbose = TRUE;
+/* Commands sent to each engine after it is started. */
+static const char **init_commands = NULL;
+static unsigned num_init_commands = 0;
+
+static FILE *input_file = NULL;
+static FILE *output_file = NULL;
+static FILE *failed_file = NULL;
+
+static const char *checkpoint_filename = NULL;
+static unsigned long checkpoint_interval = CHECKPOINT_INTERVAL;
+/* Offset in the input following the last position written. */
+static long completed_input_end = 0;
+/* Number of positions written at the last checkpoint. */
+static unsigned long last_checkpoint = 0;
+/* Set by SIGINT and SIGTERM. */
+static volatile sig_atomic_t interrupted = 0;
+
+static Engine *engines = NULL;
+
+/* Positions that have failed and are to be retried. */
+static Job *retry_queue = NULL;
+/* Index of the next position to be read from the input. */
+static unsigned long next_input_index = 0;
+static Boolean end_of_input = FALSE;
+
+/* Ordered output: a circular window of results, starting with
+ * the result for next_output_index.
+ */
+static Result *window = NULL;
+static unsigned long window_size = 0;
+static unsigned long next_output_index = 0;
+
+/* Statistics. */
+static unsigned long num_analysed = 0;
+static unsigned long num_failed = 0;
+static unsigned long num_restarts = 0;
+
+static void usage_and_exit(void);
+static double now(void);
+static void start_engine(Engine *engine);
+static void stop_engine(Engine *engine, Boolean kill_it);
+static Boolean send_command(Engine *engine, const char *format, ...);
+static void engine_failed(Engine *engine, const char *reason);
+static void read_from_engine(Engine *engine);
+static void handle_engine_line(Engine *engine, const char *line);
+static void parse_info_line(Engine *engine, const char *line);
+static void complete_job(Engine *engine);
+static Job *next_job(void);
+static void free_job(Job *job);
+static void store_result(const Job *job, char *row);
+static void record_failure(const char *fen);
+static void flush_window(void);
+static void ensure_window_space(unsigned long index);
+static Boolean work_remains(void);
+static void save_checkpoint(void);
+static Boolean resume_from_checkpoint(void);
+static void note_interrupt(int sig);
+
+static void
+usage_and_exit(void)
+{
+    fprintf(stderr,
+            "Usage: uci-pool [options] [positions-file]\n"
+            "Analyse each FEN position in positions-file (default stdin) with a pool of UCI engines.\n"
+            "    -e command  the engine to run (default %s)\n"
+            "    -j N        number of engine processes (default %u)\n"
+            "    -d depth    search depth (default %u)\n"
+            "    -t seconds  time limit for each position (default %.0f)\n"
+            "    -r N        retries of a failed position (default %u)\n"
+            "    -s command  send command to each engine after starting it (repeatable)\n"
+            "    -p N        include the first N moves of the principal variation\n"
+            "    -k          keyed output: prefix rows with the input index; don't wait for order\n"
+            "    -f file     write positions that could not be analysed to file\n"
+            "    -o file     write the output to file (default stdout)\n"
+            "    -c file     record progress in file, and resume from it if it exists\n"
+            "    -C N        positions between checkpoints (default %d)\n"
+            "    -q          no progress report\n",
+            engine_command, num_engines, search_depth, position_timeout, max_failures,
+            CHECKPOINT_INTERVAL);
+    exit(1);
+}
+
+/* Return a monotonic time in seconds. */
+static double
+now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Start engine's process and begin the isready handshake. */
+static void
+start_engine(Engine *engine)
+{
+    int to_engine[2], from_engine[2];
+    pid_t pid;
+    unsigned c;
+
+    if (pipe(to_engine) != 0 || pipe(from_engine) != 0) {
+        perror("uci-pool: pipe");
+        exit(1);
+    }
+    pid = fork();
+    if (pid < 0) {
+        perror("uci-pool: fork");
+        exit(1);
+    }
+    else if (pid == 0) {
+        /* The engine. */
+        char *command = (char *) malloc_or_die(strlen(engine_command) + 6);
+
+        dup2(to_engine[0], STDIN_FILENO);
+        dup2(from_engine[1], STDOUT_FILENO);
+        close(to_engine[0]);
+        close(to_engine[1]);
+        close(from_engine[0]);
+        close(from_engine[1]);
+        /* Use exec so that signals reach the engine rather than the shell. */
+        sprintf(command, "exec %s", engine_command);
+        execl("/bin/sh", "sh", "-c", command, (char *) NULL);
+        _exit(127);
+    }
+    close(to_engine[0]);
+    close(from_engine[1]);
+    /* Don't let later engines inherit these, or end-of-file
+     * would not be seen when this engine dies.
+     */
+    fcntl(to_engine[1], F_SETFD, FD_CLOEXEC);
+    fcntl(from_engine[0], F_SETFD, FD_CLOEXEC);
+
+    engine->pid = pid;
+    engine->to_engine = to_engine[1];
+    engine->from_engine = from_engine[0];
+    engine->status = ENGINE_STARTING;
+    engine->deadline = now() + STARTUP_TIMEOUT;
+    engine->line_length = 0;
+
+    for (c = 0; c < num_init_commands; c++) {
+        (void) send_command(engine, "%s", init_commands[c]);
+    }
+    /* Failure is detected via the deadline or end of file. */
+    (void) send_command(engine, "isready");
+}
+
+/* Stop engine's process, forcibly if kill_it. */
+static void
+stop_engine(Engine *engine, Boolean kill_it)
+{
+    if (engine->pid > 0) {
+        if (kill_it) {
+            kill(engine->pid, SIGKILL);
+        }
+        else {
+            double limit;
+
+            (void) send_command(engine, "quit");
+            close(engine->to_engine);
+            engine->to_engine = -1;
+            /* Allow a little time for a clean exit. */
+            limit = now() + 1.0;
+            while (waitpid(engine->pid, NULL, WNOHANG) == 0) {
+                if (now() > limit) {
+                    kill(engine->pid, SIGKILL);
+                    break;
+                }
+                else {
+                    struct timespec pause = { 0, 10000000 };
+                    nanosleep(&pause, NULL);
+                }
+            }
+        }
+        (void) waitpid(engine->pid, NULL, 0);
+        engine->pid = -1;
+    }
+    if (engine->to_engine >= 0) {
+        close(engine->to_engine);
+        engine->to_engine = -1;
+    }
+    if (engine->from_engine >= 0) {
+        close(engine->from_engine);
+        engine->from_engine = -1;
+    }
+}
+
+/* Send a command line to engine.
+ * Return FALSE if it could not be written.
+ */
+static Boolean
+send_command(Engine *engine, const char *format, ...)
+{
+    char *command;
+    int length;
+    va_list args;
+    Boolean ok = TRUE;
+    size_t written = 0;
+
+    va_start(args, format);
+    length = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    command = (char *) malloc_or_die(length + 2);
+    va_start(args, format);
+    vsprintf(command, format, args);
+    va_end(args);
+    command[length] = '\n';
+    length++;
+
+    while (ok && written < (size_t) length) {
+        ssize_t n = write(engine->to_engine, command + written, length - written);
+        if (n > 0) {
+            written += n;
+        }
+        else if (n < 0 && errno == EINTR) {
+        }
+        else {
+            ok = FALSE;
+        }
+    }
+    (void) free((void *) command);
+    return ok;
+}
+
+/* The engine has failed: restart it and requeue or abandon its job. */
+static void
+engine_failed(Engine *engine, const char *reason)
+{
+    Job *job = engine->job;
+
+    stop_engine(engine, TRUE);
+    engine->job = NULL;
+    if (job != NULL) {
+        job->failures++;
+        if (verbose) {
+            fprintf(stderr, "uci-pool: engine %u %s on position %lu: %s\n",
+                    engine->id, reason, job->index + 1, job->fen);
+        }
+        if (job->failures > max_failures) {
+            /* Give up on this one. */
+            store_result(job, NULL);
+            free_job(job);
+        }
+        else {
+            /* Retry it as soon as possible. */
+            job->next = retry_queue;
+            retry_queue = job;
+        }
+    }
+    else {
+        if (verbose) {
+            fprintf(stderr, "uci-pool: engine %u %s\n", engine->id, reason);
+        }
+        if (engine->status == ENGINE_STARTING) {
+            engine->start_failures++;
+            if (engine->start_failures >= MAX_START_FAILURES) {
+                fprintf(stderr, "uci-pool: unable to start %s\n", engine_command);
+                exit(1);
+            }
+        }
+    }
+    num_restarts++;
+    start_engine(engine);
+}
+
+/* Read what is available from engine and handle each complete line. */
+static void
+read_from_engine(Engine *engine)
+{
+    char buffer[4096];
+    ssize_t n = read(engine->from_engine, buffer, sizeof (buffer));
+
+    if (n < 0 && errno == EINTR) {
+    }
+    else if (n <= 0) {
+        engine_failed(engine, "exited");
+    }
+    else {
+        /* Stop if the engine is restarted part way through. */
+        pid_t pid = engine->pid;
+        ssize_t ix;
+
+        for (ix = 0; ix < n && engine->pid == pid; ix++) {
+            char ch = buffer[ix];
+            if (ch == '\n') {
+                /* Allow for CRLF line endings. */
+                if (engine->line_length > 0 &&
+                        engine->line[engine->line_length - 1] == '\r') {
+                    engine->line_length--;
+                }
+                engine->line[engine->line_length] = '\0';
+                engine->line_length = 0;
+                handle_engine_line(engine, engine->line);
+            }
+            else {
+                if (engine->line_length + 1 >= engine->line_space) {
+                    engine->line_space *= 2;
+                    engine->line = (char *) realloc_or_die(engine->line,
+                            engine->line_space);
+                }
+                engine->line[engine->line_length] = ch;
+                engine->line_length++;
+            }
+        }
+    }
+}
+
+/* Act on a line of output from engine. */
+static void
+handle_engine_line(Engine *engine, const char *line)
+{
+    switch (engine->status) {
+        case ENGINE_STARTING:
+            if (strncmp(line, "readyok", 7) == 0) {
+                engine->status = ENGINE_IDLE;
+                engine->start_failures = 0;
+            }
+            break;
+        case ENGINE_SEARCHING:
+            if (strncmp(line, "info ", 5) == 0) {
+                parse_info_line(engine, line);
+            }
+            else if (strncmp(line, "bestmove", 8) == 0) {
+                complete_job(engine);
+            }
+            else if (strncmp(line, "Position", 8) == 0) {
+                /* NapoleonPP's report of a position that it cannot handle. */
+                engine_failed(engine, "rejected the position");
+            }
+            break;
+        case ENGINE_IDLE:
+            break;
+    }
+}
+
+/* Extract the depth, score and principal variation from
+ * an info line.  Lines reporting bounds or secondary variations
+ * are ignored.
+ */
+static void
+parse_info_line(Engine *engine, const char *line)
+{
+    char *copy = copy_string(line);
+    char *saveptr = NULL;
+    char *token = strtok_r(copy, " \t", &saveptr);
+    int depth = -1;
+    long score = 0;
+    Boolean have_score = FALSE, mate = FALSE, usable = TRUE;
+    const char *pv = NULL;
+
+    while (token != NULL && usable && pv == NULL) {
+        if (strcmp(token, "string") == 0) {
+            /* Free text. */
+            usable = FALSE;
+        }
+        else if (strcmp(token, "lowerbound") == 0 || strcmp(token, "upperbound") == 0) {
+            usable = FALSE;
+        }
+        else if (strcmp(token, "pv") == 0) {
+            /* The moves are the rest of the line. */
+            pv = saveptr;
+        }
+        else if (strcmp(token, "depth") == 0) {
+            token = strtok_r(NULL, " \t", &saveptr);
+            if (token != NULL) {
+                depth = atoi(token);
+            }
+        }
+        else if (strcmp(token, "multipv") == 0) {
+            token = strtok_r(NULL, " \t", &saveptr);
+            if (token != NULL && atoi(token) != 1) {
+                usable = FALSE;
+            }
+        }
+        else if (strcmp(token, "score") == 0) {
+            token = strtok_r(NULL, " \t", &saveptr);
+            if (token != NULL &&
+                    (strcmp(token, "cp") == 0 || strcmp(token, "mate") == 0)) {
+                mate = strcmp(token, "mate") == 0;
+                token = strtok_r(NULL, " \t", &saveptr);
+                if (token != NULL) {
+                    score = atol(token);
+                    have_score = TRUE;
+                }
+            }
+        }
+        if (token != NULL && pv == NULL) {
+            token = strtok_r(NULL, " \t", &saveptr);
+        }
+    }
+    if (usable && have_score) {
+        engine->have_score = TRUE;
+        engine->score = score;
+        engine->mate = mate;
+        if (depth >= 0) {
+            engine->depth = depth;
+        }
+        if (engine->pv != NULL) {
+            (void) free((void *) engine->pv);
+            engine->pv = NULL;
+        }
+        if (pv != NULL) {
+            engine->pv = copy_string(pv);
+        }
+    }
+    (void) free((void *) copy);
+}
+
+/* The engine has finished its search: build the output row. */
+static void
+complete_job(Engine *engine)
+{
+    Job *job = engine->job;
+
+    if (!engine->have_score) {
+        engine_failed(engine, "gave no score");
+    }
+    else {
+        const char *side = strchr(job->fen, ' ');
+        Boolean black_to_move = side != NULL && side[1] == 'b';
+        long score = engine->score;
+        size_t space = strlen(job->fen) + 64 + 5 * pv_depth;
+        char *row = (char *) malloc_or_die(space);
+        int length;
+
+        if (engine->mate) {
+            /* As for the lichess conversion, the distance is ignored.
+             * Mate in 0 means that the side to move has been mated.
+             */
+            score = score <= 0 ? -MATE_SCORE : MATE_SCORE;
+        }
+        /* UCI scores are relative to the side to move. */
+        if (black_to_move) {
+            score = -score;
+        }
+        length = sprintf(row, "%s,%d,%ld", job->fen, engine->depth, score);
+        if (pv_depth > 0) {
+            /* The first pv_depth moves, padded with null moves. */
+            char *saveptr = NULL;
+            char *move = engine->pv != NULL ?
+                    strtok_r(engine->pv, " \t", &saveptr) : NULL;
+            unsigned m;
+
+            row[length++] = ',';
+            for (m = 0; m < pv_depth; m++) {
+                const char *text = move != NULL ? move : "0000";
+                if (m > 0) {
+                    row[length++] = ' ';
+                }
+                if (length + strlen(text) + 2 > space) {
+                    space = 2 * space + strlen(text);
+                    row = (char *) realloc_or_die(row, space);
+                }
+                strcpy(&row[length], text);
+                length += strlen(text);
+                if (move != NULL) {
+                    move = strtok_r(NULL, " \t", &saveptr);
+                }
+            }
+            row[length] = '\0';
+        }
+        num_analysed++;
+        engine->job = NULL;
+        engine->status = ENGINE_IDLE;
+        store_result(job, row);
+        free_job(job);
+    }
+}
+
+/* Return the next position to be analysed, or NULL if there is none. */
+static Job *
+next_job(void)
+{
+    Job *job = NULL;
+
+    if (retry_queue != NULL) {
+        job = retry_queue;
+        retry_queue = job->next;
+        job->next = NULL;
+    }
+    else {
+        char *line = NULL;
+        size_t space = 0;
+        ssize_t length;
+
+        while (job == NULL && !end_of_input &&
+                (length = getline(&line, &space, input_file)) >= 0) {
+            /* Trim the line ending and surrounding white space. */
+            char *start = line;
+            while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r' ||
+                    line[length - 1] == ' ' || line[length - 1] == '\t')) {
+                length--;
+            }
+            line[length] = '\0';
+            while (*start == ' ' || *start == '\t') {
+                start++;
+            }
+            if (*start != '\0') {
+                job = (Job *) malloc_or_die(sizeof (*job));
+                job->index = next_input_index++;
+                job->fen = copy_string(start);
+                job->failures = 0;
+                job->input_end = ftell(input_file);
+                job->next = NULL;
+            }
+        }
+        if (job == NULL) {
+            end_of_input = TRUE;
+        }
+        (void) free((void *) line);
+    }
+    if (job != NULL && !keyed_output) {
+        ensure_window_space(job->index);
+    }
+    return job;
+}
+
+static void
+free_job(Job *job)
+{
+    (void) free((void *) job->fen);
+    (void) free((void *) job);
+}
+
+/* Make sure that the result window can hold the result for index. */
+static void
+ensure_window_space(unsigned long index)
+{
+    if (index >= next_output_index + window_size) {
+        unsigned long new_size = window_size == 0 ? 64 : window_size;
+        Result *new_window;
+        unsigned long i;
+
+        while (index >= next_output_index + new_size) {
+            new_size *= 2;
+        }
+        new_window = (Result *) malloc_or_die(new_size * sizeof (*new_window));
+        for (i = 0; i < new_size; i++) {
+            new_window[i].done = FALSE;
+            new_window[i].row = NULL;
+            new_window[i].failed_fen = NULL;
+        }
+        for (i = next_output_index; i < next_output_index + window_size; i++) {
+            new_window[i % new_size] = window[i % window_size];
+        }
+        (void) free((void *) window);
+        window = new_window;
+        window_size = new_size;
+    }
+}
+
+/* Save the row for position index, or write it immediately
+ * if output order does not matter.
+ */
+static void
+store_result(const Job *job, char *row)
+{
+    if (keyed_output) {
+        if (row != NULL) {
+            fprintf(output_file, "%lu,%s\n", job->index, row);
+            (void) free((void *) row);
+        }
+        else {
+            record_failure(job->fen);
+        }
+    }
+    else {
+        Result *result = &window[job->index % window_size];
+        result->done = TRUE;
+        result->row = row;
+        result->failed_fen = row == NULL ? copy_string(job->fen) : NULL;
+        result->input_end = job->input_end;
+        flush_window();
+    }
+}
+
+/* Note a position that could not be analysed. */
+static void
+record_failure(const char *fen)
+{
+    num_failed++;
+    if (failed_file != NULL) {
+        fprintf(failed_file, "%s\n", fen);
+    }
+}
+
+/* Write the rows that are now in order. */
+static void
+flush_window(void)
+{
+    while (window_size > 0 && window[next_output_index % window_size].done) {
+        Result *result = &window[next_output_index % window_size];
+        if (result->row != NULL) {
+            fprintf(output_file, "%s\n", result->row);
+            (void) free((void *) result->row);
+        }
+        else {
+            record_failure(result->failed_fen);
+            (void) free((void *) result->failed_fen);
+        }
+        completed_input_end = result->input_end;
+        result->done = FALSE;
+        result->row = NULL;
+        result->failed_fen = NULL;
+        next_output_index++;
+    }
+    if (checkpoint_filename != NULL &&
+            next_output_index - last_checkpoint >= checkpoint_interval) {
+        save_checkpoint();
+    }
+}
+
+/* Record how far the run has got.
+ * All the rows so far must be on disk before the checkpoint is.
+ */
+static void
+save_checkpoint(void)
+{
+    CheckpointField fields[] = {
+        { "positions", 0 },
+        { "input", 0 },
+        { "output", 0 },
+        { "failed", 0 },
+        { "abandoned", 0 },
+    };
+
+    fields[0].value = next_output_index;
+    fields[1].value = completed_input_end;
+    if (!sync_file(output_file) ||
+            (failed_file != NULL && !sync_file(failed_file))) {
+        fprintf(stderr, "uci-pool: unable to write the output.\n");
+        exit(1);
+    }
+    fields[2].value = ftell(output_file);
+    fields[3].value = failed_file != NULL ? ftell(failed_file) : 0;
+    fields[4].value = num_failed;
+    if (!write_checkpoint(checkpoint_filename, fields,
+            sizeof (fields) / sizeof (fields[0]))) {
+        fprintf(stderr, "uci-pool: unable to write checkpoint %s\n",
+                checkpoint_filename);
+        exit(1);
+    }
+    last_checkpoint = next_output_index;
+}
+
+/* If there is a checkpoint, skip the input that has been dealt with
+ * and discard any output written after the checkpoint.
+ * Return TRUE if the run is being resumed.
+ */
+static Boolean
+resume_from_checkpoint(void)
+{
+    CheckpointField fields[] = {
+        { "positions", 0 },
+        { "input", 0 },
+        { "output", 0 },
+        { "failed", 0 },
+        { "abandoned", 0 },
+    };
+
+    switch (read_checkpoint(checkpoint_filename, fields,
+            sizeof (fields) / sizeof (fields[0]))) {
+        case CHECKPOINT_ABSENT:
+            return FALSE;
+        case CHECKPOINT_INVALID:
+            fprintf(stderr, "uci-pool: %s is not a valid checkpoint.\n",
+                    checkpoint_filename);
+            exit(1);
+        case CHECKPOINT_READ:
+            break;
+    }
+    if (!truncate_file(output_file, fields[2].value)) {
+        fprintf(stderr, "uci-pool: the output does not match checkpoint %s\n",
+                checkpoint_filename);
+        exit(1);
+    }
+    if (failed_file != NULL && !truncate_file(failed_file, fields[3].value)) {
+        fprintf(stderr, "uci-pool: the failed positions do not match checkpoint %s\n",
+                checkpoint_filename);
+        exit(1);
+    }
+    if (fseek(input_file, (long) fields[1].value, SEEK_SET) != 0) {
+        /* Not seekable, so skip the positions already dealt with. */
+        char *line = NULL;
+        size_t space = 0;
+        unsigned long skipped = 0;
+        ssize_t length;
+
+        while (skipped < fields[0].value &&
+                (length = getline(&line, &space, input_file)) >= 0) {
+            if (strspn(line, " \t\r\n") < (size_t) length) {
+                skipped++;
+            }
+        }
+        (void) free((void *) line);
+    }
+    next_input_index = next_output_index = last_checkpoint = fields[0].value;
+    completed_input_end = fields[1].value;
+    num_failed = fields[4].value;
+    return TRUE;
+}
+
+static void
+note_interrupt(int sig)
+{
+    (void) sig;
+    interrupted = 1;
+}
+
+/* Return TRUE if there are positions still to be analysed. */
+static Boolean
+work_remains(void)
+{
+    unsigned e;
+
+    if (!end_of_input || retry_queue != NULL) {
+        return TRUE;
+    }
+    for (e = 0; e < num_engines; e++) {
+        if (engines[e].job != NULL) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+int
+main(int argc, char *argv[])
+{
+    int opt;
+    const char *output_filename = NULL;
+    const char *failed_filename = NULL;
+    struct pollfd *fds;
+    unsigned e;
+
+    while ((opt = getopt(argc, argv, "e:j:d:t:r:s:p:kf:o:qc:C:")) != -1) {
+        switch (opt) {
+            case 'e':
+                engine_command = optarg;
+                break;
+            case 'j':
+                if (sscanf(optarg, "%u", &num_engines) != 1 || num_engines == 0) {
+                    usage_and_exit();
+                }
+                break;
+            case 'd':
+                if (sscanf(optarg, "%u", &search_depth) != 1 || search_depth == 0) {
+                    usage_and_exit();
+                }
+                break;
+            case 't':
+                if (sscanf(optarg, "%lf", &position_timeout) != 1 || position_timeout <= 0) {
+                    usage_and_exit();
+                }
+                break;
+            case 'r':
+                if (sscanf(optarg, "%u", &max_failures) != 1) {
+                    usage_and_exit();
+                }
+                break;
+            case 's':
+                init_commands = (const char **) realloc_or_die((void *) init_commands,
+                        (num_init_commands + 1) * sizeof (*init_commands));
+                init_commands[num_init_commands++] = optarg;
+                break;
+            case 'p':
+                if (sscanf(optarg, "%u", &pv_depth) != 1) {
+                    usage_and_exit();
+                }
+                break;
+            case 'k':
+                keyed_output = TRUE;
+                break;
+            case 'f':
+                failed_filename = optarg;
+                break;
+            case 'o':
+                output_filename = optarg;
+                break;
+            case 'q':
+                verbose = FALSE;
+                break;
+            case 'c':
+                checkpoint_filename = optarg;
+                break;
+            case 'C':
+                if (sscanf(optarg, "%lu", &checkpoint_interval) != 1 ||
+                        checkpoint_interval == 0) {
+                    usage_and_exit();
+                }
+                break;
+            default:
+                usage_and_exit();
+        }
+    }
+    if (optind + 1 < argc) {
+        usage_and_exit();
+    }
+    if (checkpoint_filename != NULL && (keyed_output || output_filename == NULL)) {
+        fprintf(stderr, "uci-pool: -c requires -o and cannot be used with -k\n");
+        exit(1);
+    }
+    else if (optind < argc) {
+        input_file = fopen(argv[optind], "r");
+        if (input_file == NULL) {
+            fprintf(stderr, "uci-pool: unable to open %s\n", argv[optind]);
+            exit(1);
+        }
+    }
+    else {
+        input_file = stdin;
+    }
+    if (output_filename != NULL) {
+        /* Existing output is kept for a checkpoint to be resumed. */
+        output_file = fopen(output_filename, checkpoint_filename != NULL ? "a+" : "w");
+        if (output_file == NULL) {
+            fprintf(stderr, "uci-pool: unable to open %s\n", output_filename);
+            exit(1);
+        }
+    }
+    else {
+        output_file = stdout;
+    }
+    if (failed_filename != NULL) {
+        failed_file = fopen(failed_filename, checkpoint_filename != NULL ? "a+" : "w");
+        if (failed_file == NULL) {
+            fprintf(stderr, "uci-pool: unable to open %s\n", failed_filename);
+            exit(1);
+        }
+    }
+
+    /* A dead engine is detected by the failed write. */
+    signal(SIGPIPE, SIG_IGN);
+
+    if (checkpoint_filename == NULL || !resume_from_checkpoint()) {
+        if (checkpoint_filename != NULL) {
+            /* Start afresh. */
+            (void) truncate_file(output_file, 0);
+            if (failed_file != NULL) {
+                (void) truncate_file(failed_file, 0);
+            }
+        }
+        fprintf(output_file, "%sfen,depth,score%s\n",
+                keyed_output ? "index," : "", pv_depth > 0 ? ",pv" : "");
+    }
+    if (checkpoint_filename != NULL) {
+        /* Stop cleanly, with a checkpoint. */
+        struct sigaction action;
+        memset(&action, 0, sizeof (action));
+        action.sa_handler = note_interrupt;
+        sigaction(SIGINT, &action, NULL);
+        sigaction(SIGTERM, &action, NULL);
+    }
+
+    engines = (Engine *) malloc_or_die(num_engines * sizeof (*engines));
+    fds = (struct pollfd *) malloc_or_die(num_engines * sizeof (*fds));
+    for (e = 0; e < num_engines; e++) {
+        Engine *engine = &engines[e];
+        engine->id = e + 1;
+        engine->pid = -1;
+        engine->to_engine = engine->from_engine = -1;
+        engine->start_failures = 0;
+        engine->job = NULL;
+        engine->line_space = LINE_SPACE;
+        engine->line = (char *) malloc_or_die(engine->line_space);
+        engine->have_score = FALSE;
+        engine->pv = NULL;
+        start_engine(engine);
+    }
+
+    while (work_remains() && !interrupted) {
+        double time_now = now();
+        double next_deadline = time_now + position_timeout;
+        int timeout_ms;
+
+        /* Give work to idle engines. */
+        for (e = 0; e < num_engines; e++) {
+            Engine *engine = &engines[e];
+            if (engine->status == ENGINE_IDLE && engine->job == NULL) {
+                Job *job = next_job();
+                if (job != NULL) {
+                    engine->job = job;
+                    engine->status = ENGINE_SEARCHING;
+                    engine->deadline = time_now + position_timeout;
+                    engine->have_score = FALSE;
+                    engine->depth = 0;
+                    if (engine->pv != NULL) {
+                        (void) free((void *) engine->pv);
+                        engine->pv = NULL;
+                    }
+                    if (!send_command(engine, "position fen %s", job->fen) ||
+                            !send_command(engine, "go depth %u", search_depth)) {
+                        engine_failed(engine, "stopped accepting commands");
+                    }
+                }
+            }
+        }
+
+        /* Wait for output or the nearest deadline. */
+        for (e = 0; e < num_engines; e++) {
+            fds[e].fd = engines[e].from_engine;
+            fds[e].events = POLLIN;
+            fds[e].revents = 0;
+            if (engines[e].status != ENGINE_IDLE && engines[e].deadline < next_deadline) {
+                next_deadline = engines[e].deadline;
+            }
+        }
+        timeout_ms = (int) ((next_deadline - time_now) * 1000) + 1;
+        if (timeout_ms < 0) {
+            timeout_ms = 0;
+        }
+        if (poll(fds, num_engines, timeout_ms) < 0 && errno != EINTR) {
+            perror("uci-pool: poll");
+            exit(1);
+        }
+        for (e = 0; e < num_engines; e++) {
+            if (fds[e].revents & (POLLIN | POLLHUP | POLLERR)) {
+                read_from_engine(&engines[e]);
+            }
+        }
+
+        /* Deal with engines that have not responded in time. */
+        time_now = now();
+        for (e = 0; e < num_engines; e++) {
+            Engine *engine = &engines[e];
+            if (engine->status != ENGINE_IDLE && engine->deadline < time_now) {
+                engine_failed(engine, engine->status == ENGINE_STARTING ?
+                        "did not become ready" : "timed out");
+            }
+        }
+    }
+
+    for (e = 0; e < num_engines; e++) {
+        stop_engine(&engines[e], interrupted);
+    }
+    if (checkpoint_filename != NULL) {
+        save_checkpoint();
+    }
+    if (interrupted) {
+        fprintf(stderr, "uci-pool: interrupted after %lu positions; rerun to resume.\n",
+                next_output_index);
+        exit(1);
+    }
+    if (verbose) {
+        fprintf(stderr, "uci-pool: %lu position%s analysed, %lu failed, %lu engine restart%s.\n",
+                num_analysed, num_analysed == 1 ? "" : "s",
+                num_failed, num_restarts, num_restarts == 1 ? "" : "s");
+    }
+    if (output_file != stdout) {
+        (void) fclose(output_file);
+    }
+    if (failed_file != NULL) {
+        (void) fclose(failed_file);
+    }
+    return num_failed == 0 ? 0 : 2;
+}
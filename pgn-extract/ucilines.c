@@ -0,0 +1,261 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+/* Input of FEN and UCI move lines (--ucilines); see ucilines.h.
+ * Moves of four coordinate characters, the large majority, are
+ * turned into Move structures directly, leaving their details to the
+ * long algebraic fast path of determine_move_details.  Anything else,
+ * such as a promotion or a null move (0000), goes through decode_move.
+ * As with --fencsv, a regular input file is split at line boundaries
+ * into --jobs ranges that are handled by separate processes; see
+ * linejobs.h.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "bool.h"
+#include "mymalloc.h"
+#include "defs.h"
+#include "typedef.h"
+#include "tokens.h"
+#include "taglist.h"
+#include "lex.h"
+#include "decode.h"
+#include "grammar.h"
+#include "linejobs.h"
+#include "ucilines.h"
+
+typedef struct {
+    unsigned long games_processed;
+    unsigned long games_matched;
+} LineCounts;
+
+/* Whether further games are wanted; see deal_with_constructed_game. */
+static Boolean more_wanted = TRUE;
+
+/* Return the Move for the UCI move text, or NULL if it is malformed. */
+static Move *
+uci_move(const char *text, size_t length)
+{
+    if (length == 4 &&
+            text[0] >= 'a' && text[0] <= 'h' && text[1] >= '1' && text[1] <= '8' &&
+            text[2] >= 'a' && text[2] <= 'h' && text[3] >= '1' && text[3] <= '8') {
+        Move *move = new_move_structure();
+
+        memcpy(move->move, text, length);
+        move->move[length] = '\0';
+        /* The class that decode_move gives to coordinates. */
+        move->class = PAWN_MOVE;
+        move->from_col = text[0];
+        move->from_rank = text[1];
+        move->to_col = text[2];
+        move->to_rank = text[3];
+        return move;
+    }
+    else if (length == 4 && strncmp(text, "0000", length) == 0) {
+        return decode_move((const unsigned char *) NULL_MOVE_STRING);
+    }
+    else if (length == 5 && strchr("qrbn", text[4]) != NULL) {
+        unsigned char promotion[6];
+
+        memcpy(promotion, text, length);
+        promotion[length] = '\0';
+        return decode_move(promotion);
+    }
+    else {
+        return NULL;
+    }
+}
+
+/* Process the null-terminated line of the given length as a game.
+ * Return FALSE if no further games are wanted.
+ */
+static Boolean
+process_line(char *line, size_t length, unsigned long line_number)
+{
+    char *separator = memchr(line, ';', length);
+    char *end = line + length;
+    Move *moves = NULL, *last_move = NULL;
+    char *text;
+
+    set_line_number(line_number);
+    if (separator != NULL) {
+        *separator = '\0';
+        text = separator + 1;
+    }
+    else {
+        text = end;
+    }
+    while (*line == ' ' || *line == '\t') {
+        line++;
+    }
+    if (*line == '\0') {
+        /* Blank. */
+        return TRUE;
+    }
+    while (text < end) {
+        size_t move_length;
+
+        text += strspn(text, " \t");
+        move_length = strcspn(text, " \t");
+        if (move_length > 0) {
+            Move *move = uci_move(text, move_length);
+
+            if (move == NULL) {
+                fprintf(GlobalState.logfile,
+                        "Skipping line %lu of %s: invalid move %.*s.\n",
+                        line_number, GlobalState.current_input_file,
+                        (int) move_length, text);
+                free_move_list(moves);
+                return TRUE;
+            }
+            if (last_move == NULL) {
+                moves = move;
+            }
+            else {
+                last_move->next = move;
+                move->prev = last_move;
+            }
+            last_move = move;
+        }
+        text += move_length;
+    }
+    return deal_with_constructed_game(line, moves, line_number);
+}
+
+/* Process a line, counting its games in counts; see LineJob. */
+static Boolean
+handle_line(char *line, size_t length, unsigned long line_number,
+            FILE *outputs[], void *counts)
+{
+    LineCounts *line_counts = (LineCounts *) counts;
+    unsigned long processed = GlobalState.num_games_processed;
+    unsigned long matched = GlobalState.num_games_matched;
+
+    (void) outputs;
+    more_wanted = process_line(line, length, line_number);
+    line_counts->games_processed += GlobalState.num_games_processed - processed;
+    line_counts->games_matched += GlobalState.num_games_matched - matched;
+    return more_wanted;
+}
+
+/* Direct the games of a --jobs worker to its output and count
+ * them from zero.
+ */
+static void
+start_worker(FILE *outputs[])
+{
+    GlobalState.outputfile = outputs[0];
+    GlobalState.num_games_processed = 0;
+    GlobalState.num_games_matched = 0;
+}
+
+static const LineJob game_line_job = {
+    handle_line, start_worker, 1, sizeof(LineCounts)
+};
+
+/* Process the lines of fpin in the current process. */
+static void
+process_stream(FILE *fpin, const char *name)
+{
+    LineCounts counts = { 0, 0 };
+
+    if (!process_line_range(fpin, 0, -1, &game_line_job,
+                            &GlobalState.outputfile, &counts)) {
+        fprintf(GlobalState.logfile, "Error reading %s.\n", name);
+        exit(1);
+    }
+}
+
+/* Process filename, of the given size, with GlobalState.num_jobs
+ * worker processes.
+ * Line numbers in diagnostics are relative to the start of each
+ * worker's range, as the workers do not read the lines before it.
+ */
+static void
+process_file_in_parallel(const char *filename, off_t size)
+{
+    FILE *outputs[1];
+    LineCounts counts = { 0, 0 };
+
+    outputs[0] = GlobalState.outputfile;
+    if (!process_lines_in_parallel(filename, size, &game_line_job,
+                                   outputs, &counts)) {
+        fprintf(GlobalState.logfile, "Failed to process %s.\n", filename);
+        exit(1);
+    }
+    GlobalState.num_games_processed += counts.games_processed;
+    GlobalState.num_games_matched += counts.games_matched;
+}
+
+/* Process each of the input files, or standard input if there are none,
+ * as lines of a FEN and UCI moves.
+ */
+void
+process_uci_line_files(void)
+{
+    unsigned file_number;
+    const char *filename;
+
+    GlobalState.current_file_type = NORMALFILE;
+    if (input_file_name(0) == NULL) {
+        GlobalState.current_input_file = "stdin";
+        process_stream(stdin, "stdin");
+    }
+    for (file_number = 0;
+            more_wanted && (filename = input_file_name(file_number)) != NULL;
+            file_number++) {
+        struct stat status;
+
+        GlobalState.current_input_file = filename;
+        if (GlobalState.verbosity > 1) {
+            fprintf(GlobalState.logfile, "Processing %s\n", filename);
+        }
+        if (stat(filename, &status) != 0) {
+            fprintf(GlobalState.logfile, "Unable to open the file: %s\n",
+                    filename);
+            exit(1);
+        }
+        else if (GlobalState.num_jobs > 1 && S_ISREG(status.st_mode)) {
+            process_file_in_parallel(filename, status.st_size);
+        }
+        else {
+            FILE *fpin = fopen(filename, "rb");
+
+            if (fpin == NULL) {
+                fprintf(GlobalState.logfile, "Unable to open the file: %s\n",
+                        filename);
+                exit(1);
+            }
+            process_stream(fpin, filename);
+            (void) fclose(fpin);
+        }
+    }
+    if (fflush(GlobalState.outputfile) != 0 || ferror(GlobalState.outputfile)) {
+        fprintf(GlobalState.logfile, "Error writing the output.\n");
+        exit(1);
+    }
+}
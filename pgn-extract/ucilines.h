@@ -0,0 +1,35 @@
+/*
+ *  This file is part of pgn-extract: a Portable Game Notation (PGN) extractor.
+ *  Copyright (C) 1994-2025 David J. Barnes
+ *
+ *  pgn-extract is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pgn-extract is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pgn-extract. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  David J. Barnes may be contacted as d.j.barnes@kent.ac.uk
+ *  https://www.cs.kent.ac.uk/people/staff/djb/
+ */
+
+/* Input of positions as a FEN string followed by a line of moves
+ * (--ucilines), such as the principal variations of engine output:
+ *     fen;e2e4 e7e5 g1f3
+ * Each line is treated as a game from the FEN position, so it is
+ * matched and output in the same way as a game read from PGN;
+ * with -Wfen, for instance, every position of the line is output.
+ */
+
+#ifndef UCILINES_H
+#define UCILINES_H
+
+void process_uci_line_files(void);
+
+#endif	// UCILINES_H